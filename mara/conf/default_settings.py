@@ -8,6 +8,7 @@ SystemConfig["clibs"]   =  "-lreadline -lncurses"
 SystemConfig["cc"]      =  "cc"
 SystemConfig["cxx"]     =  "c++"
 SystemConfig["mpi"]     =  False
+SystemConfig["openmp"]  =  False
 SystemConfig["nogl"]    =  False
 SystemConfig["hdf5"]    =  "/usr"
 SystemConfig["fftw"]    =  "/usr"
@@ -44,6 +44,20 @@ int Advect::PrimToCons(const double *P, double *U) const
   U[0] = P[0];
   return 0;
 }
+int Advect::ConsToPrimBatch(const double *U, double *P, int nzones,
+                            int *fail) const
+{
+  for (int n=0; n<nzones; ++n) P[n] = U[n];
+  if (fail) for (int n=0; n<nzones; ++n) fail[n] = 0;
+  return 0;
+}
+int Advect::PrimToConsBatch(const double *P, double *U, int nzones,
+                            int *fail) const
+{
+  for (int n=0; n<nzones; ++n) U[n] = P[n];
+  if (fail) for (int n=0; n<nzones; ++n) fail[n] = 0;
+  return 0;
+}
 void Advect::FluxAndEigenvalues(const double *U,
                                 const double *P, double *F,
                                 double *ap, double *am, int dimension) const
@@ -23,6 +23,10 @@ public:
   virtual ~ScalarAdvection() { }
   virtual int ConsToPrim(const double *U, double *P) const;
   virtual int PrimToCons(const double *P, double *U) const;
+  virtual int ConsToPrimBatch(const double *U, double *P, int nzones,
+                              int *fail) const;
+  virtual int PrimToConsBatch(const double *P, double *U, int nzones,
+                              int *fail) const;
 
   void FluxAndEigenvalues(const double *U,
 			  const double *P, double *F,
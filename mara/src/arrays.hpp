@@ -2,6 +2,9 @@
 #ifndef __ArrayTools_HEADER__
 #define __ArrayTools_HEADER__
 
+#include <cstdlib>
+#include <new>
+
 // i0: first index, which can be negative
 // ni: number of elements in i-direction
 
@@ -129,4 +132,41 @@ template <class T> void delete_array_4d(T ****p4, int i0, int j0, int k0, int l0
   delete [] p4;
 }
 
+
+
+// AlignedPlanes: a structure-of-arrays buffer of np planes, each holding n
+// elements and starting on a 64-byte (cache line) boundary. The buffer is only
+// re-allocated when its shape changes.
+template <class T> class AlignedPlanes
+{
+public:
+  AlignedPlanes() : data(NULL), np(0), n(0), pitch(0) { }
+  ~AlignedPlanes() { free(data); }
+
+  void resize(int np_, int n_)
+  {
+    if (np_ == np && n_ == n) return;
+    const int per_line = 64 / sizeof(T);
+    const int pitch_ = ((n_ + per_line - 1) / per_line) * per_line;
+    void *p = NULL;
+    if (posix_memalign(&p, 64, size_t(np_)*pitch_*sizeof(T)) != 0) {
+      throw std::bad_alloc(); // leaves the old buffer and shape in place
+    }
+    free(data);
+    data = static_cast<T*>(p);
+    np = np_;
+    n = n_;
+    pitch = pitch_;
+  }
+  T *operator[](int q) { return data + q*pitch; }
+  const T *operator[](int q) const { return data + q*pitch; }
+  int get_pitch() const { return pitch; }
+
+private:
+  AlignedPlanes(const AlignedPlanes &);
+  AlignedPlanes &operator=(const AlignedPlanes &);
+  T *data;
+  int np, n, pitch;
+} ;
+
 #endif // __ArrayTools_HEADER__
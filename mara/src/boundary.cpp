@@ -14,7 +14,7 @@
 #include "valman.hpp"
 
 
-void OutflowBoundary::ApplyBoundaries(std::valarray<double> &U) const
+BoundaryConditions *OutflowBoundary::new_boundary() const
 {
   BoundaryConditions *boundary=NULL;
   switch (Mara->domain->get_Nd()) {
@@ -22,17 +22,32 @@ void OutflowBoundary::ApplyBoundaries(std::valarray<double> &U) const
   case 2: boundary = new OutflowBoundary2d; break;
   case 3: boundary = new OutflowBoundary3d; break;
   }
+  return boundary;
+}
+void OutflowBoundary::ApplyBoundaries(std::valarray<double> &U) const
+{
+  BoundaryConditions *boundary = new_boundary();
   boundary->ApplyBoundaries(U);
   delete boundary;
 }
+void OutflowBoundary::BeginApplyBoundaries(std::valarray<double> &U) const
+{
+  BoundaryConditions *boundary = new_boundary();
+  boundary->BeginApplyBoundaries(U);
+  delete boundary;
+}
+void OutflowBoundary::EndApplyBoundaries(std::valarray<double> &U) const
+{
+  BoundaryConditions *boundary = new_boundary();
+  boundary->EndApplyBoundaries(U);
+  delete boundary;
+}
 
 
 // OutflowBoundary1d
 // -----------------------------------------------------------------------------
-void OutflowBoundary1d::ApplyBoundaries(std::valarray<double> &U) const
+void OutflowBoundary1d::ApplyWalls(std::valarray<double> &U) const
 {
-  Mara->domain->Synchronize(U);
-
   if (Mara->domain->GetSubgridIndex(0) == 0)
     set_bc_x0_wall(U);
   if (Mara->domain->GetSubgridIndex(0) == Mara->domain->GetSubgridSizes(0)-1)
@@ -63,10 +78,8 @@ void OutflowBoundary1d::set_bc_x1_wall(std::valarray<double> &U) const
 
 // OutflowBoundary2d
 // -----------------------------------------------------------------------------
-void OutflowBoundary2d::ApplyBoundaries(std::valarray<double> &U) const
+void OutflowBoundary2d::ApplyWalls(std::valarray<double> &U) const
 {
-  Mara->domain->Synchronize(U);
-
   if (Mara->domain->GetSubgridIndex(0) == 0)
     set_bc_x0_wall(U);
   if (Mara->domain->GetSubgridIndex(0) == Mara->domain->GetSubgridSizes(0)-1)
@@ -132,10 +145,8 @@ void OutflowBoundary2d::set_bc_y1_wall(std::valarray<double> &U) const
 
 // PeriodicXOutflowY2d
 // -----------------------------------------------------------------------------
-void PeriodicXOutflowY2d::ApplyBoundaries(std::valarray<double> &U) const
+void PeriodicXOutflowY2d::ApplyWalls(std::valarray<double> &U) const
 {
-  Mara->domain->Synchronize(U);
-
   if (Mara->domain->GetSubgridIndex(0) == 0)
     set_bc_x0_wall(U);
   if (Mara->domain->GetSubgridIndex(0) == Mara->domain->GetSubgridSizes(0)-1)
@@ -184,10 +195,8 @@ void PeriodicXOutflowY2d::set_bc_y1_wall(std::valarray<double> &U) const
 
 // OutflowBoundary3d
 // -----------------------------------------------------------------------------
-void OutflowBoundary3d::ApplyBoundaries(std::valarray<double> &U) const
+void OutflowBoundary3d::ApplyWalls(std::valarray<double> &U) const
 {
-  Mara->domain->Synchronize(U);
-
   if (Mara->domain->GetSubgridIndex(0) == 0)
     set_bc_x0_wall(U);
   if (Mara->domain->GetSubgridIndex(0) == Mara->domain->GetSubgridSizes(0)-1)
@@ -300,10 +309,8 @@ ReflectingBoundary2d::ReflectingBoundary2d(int IndexReverseX, int IndexReverseY)
 {
 
 }
-void ReflectingBoundary2d::ApplyBoundaries(std::valarray<double> &U) const
+void ReflectingBoundary2d::ApplyWalls(std::valarray<double> &U) const
 {
-  Mara->domain->Synchronize(U);
-
   if (Mara->domain->GetSubgridIndex(0) == 0)
     set_bc_x0_wall(U);
   if (Mara->domain->GetSubgridIndex(0) == Mara->domain->GetSubgridSizes(0)-1)
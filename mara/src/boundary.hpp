@@ -17,14 +17,42 @@
 #include "hydro.hpp"
 
 
-// OutflowBoundary1d
+// SynchronizedBoundary
+// -----------------------------------------------------------------------------
+// Synchronizes the guard zones with the neighboring subgrids, and then sets
+// those lying on the physical walls of the domain with ApplyWalls. The
+// split-phase form lets the exchange proceed while the caller reads the
+// interior, setting the walls once it has completed.
 // -----------------------------------------------------------------------------
-class OutflowBoundary1d : public BoundaryConditions
+class SynchronizedBoundary : public BoundaryConditions
 {
 public:
-  void ApplyBoundaries(std::valarray<double> &U) const;
+  void ApplyBoundaries(std::valarray<double> &U) const
+  {
+    Mara->domain->Synchronize(U);
+    ApplyWalls(U);
+  }
+  void BeginApplyBoundaries(std::valarray<double> &U) const
+  {
+    Mara->domain->BeginSynchronize(U);
+  }
+  void EndApplyBoundaries(std::valarray<double> &U) const
+  {
+    Mara->domain->EndSynchronize(U);
+    ApplyWalls(U);
+  }
+
+protected:
+  virtual void ApplyWalls(std::valarray<double> &U) const = 0;
+} ;
 
+
+// OutflowBoundary1d
+// -----------------------------------------------------------------------------
+class OutflowBoundary1d : public SynchronizedBoundary
+{
 protected:
+  void ApplyWalls(std::valarray<double> &U) const;
   void set_bc_x0_wall(std::valarray<double> &U) const;
   void set_bc_x1_wall(std::valarray<double> &U) const;
 } ;
@@ -32,12 +60,10 @@ protected:
 
 // OutflowBoundary2d
 // -----------------------------------------------------------------------------
-class OutflowBoundary2d : public BoundaryConditions
+class OutflowBoundary2d : public SynchronizedBoundary
 {
-public:
-  void ApplyBoundaries(std::valarray<double> &U) const;
-
 private:
+  void ApplyWalls(std::valarray<double> &U) const;
   void set_bc_x0_wall(std::valarray<double> &U) const;
   void set_bc_x1_wall(std::valarray<double> &U) const;
   void set_bc_y0_wall(std::valarray<double> &U) const;
@@ -47,12 +73,10 @@ private:
 
 // PeriodicXOutflowY2d
 // -----------------------------------------------------------------------------
-class PeriodicXOutflowY2d : public BoundaryConditions
+class PeriodicXOutflowY2d : public SynchronizedBoundary
 {
-public:
-  void ApplyBoundaries(std::valarray<double> &U) const;
-
 private:
+  void ApplyWalls(std::valarray<double> &U) const;
   void set_bc_x0_wall(std::valarray<double> &U) const;
   void set_bc_x1_wall(std::valarray<double> &U) const;
   void set_bc_y0_wall(std::valarray<double> &U) const;
@@ -62,12 +86,10 @@ private:
 
 // OutflowBoundary3d
 // -----------------------------------------------------------------------------
-class OutflowBoundary3d : public BoundaryConditions
+class OutflowBoundary3d : public SynchronizedBoundary
 {
-public:
-  void ApplyBoundaries(std::valarray<double> &U) const;
-
 private:
+  void ApplyWalls(std::valarray<double> &U) const;
   void set_bc_x0_wall(std::valarray<double> &U) const;
   void set_bc_x1_wall(std::valarray<double> &U) const;
   void set_bc_y0_wall(std::valarray<double> &U) const;
@@ -81,18 +103,23 @@ class OutflowBoundary : public BoundaryConditions
 {
 public:
   void ApplyBoundaries(std::valarray<double> &U) const;
+  void BeginApplyBoundaries(std::valarray<double> &U) const;
+  void EndApplyBoundaries(std::valarray<double> &U) const;
+
+private:
+  BoundaryConditions *new_boundary() const;
 } ;
 
 
 // ReflectingBoundary2d
 // -----------------------------------------------------------------------------
-class ReflectingBoundary2d : public BoundaryConditions
+class ReflectingBoundary2d : public SynchronizedBoundary
 {
 public:
   ReflectingBoundary2d(int IndexReverseX, int IndexReverseY);
-  void ApplyBoundaries(std::valarray<double> &U) const;
 
 protected:
+  void ApplyWalls(std::valarray<double> &U) const;
   int IndexReverseX, IndexReverseY;
 
   void set_bc_x0_wall(std::valarray<double> &U) const;
@@ -101,13 +128,10 @@ protected:
   void set_bc_y1_wall(std::valarray<double> &U) const;
 } ;
 
-class PeriodicBoundary : public BoundaryConditions
+class PeriodicBoundary : public SynchronizedBoundary
 {
-public:
-  void ApplyBoundaries(std::valarray<double> &U) const
-  {
-    Mara->domain->Synchronize(U);
-  }
+protected:
+  void ApplyWalls(std::valarray<double> &U) const { }
 } ;
 
 #endif // __Boundary_HEADER__
@@ -5,6 +5,7 @@
 #include "eulers.hpp"
 #include "srhd.hpp"
 #include "rmhd.hpp"
+#include "profile.hpp"
 
 
 
@@ -20,6 +21,7 @@ CoolingModuleT4::CoolingModuleT4(double Tref, double t0)
 
 void CoolingModuleT4::Cool(std::valarray<double> &P, double dt)
 {
+  Profile::Scope timer(Profile::TIMER_COOLING);
   const int Nq = Mara->domain->get_Nq();
   const double dx = Mara->domain->get_dx(1);
   const double dy = Mara->domain->get_dx(2);
@@ -29,16 +31,24 @@ void CoolingModuleT4::Cool(std::valarray<double> &P, double dt)
   double *U0 = new double[Nq];
   double *U1 = new double[Nq];
 
+  // The temperatures are inverted together, starting from those of the last
+  // step, and the cooled ones are kept for the next.
+  // ---------------------------------------------------------------------------
+  std::valarray<double> &T = Mara->TemperatureArray;
+  Mara->eos->Temperatures(P, Nq, T);
+
   for (size_t i=0; i<P.size()/Nq; ++i) {
 
     std::slice m(i*Nq, Nq, 1);
     std::valarray<double> P0 = P[m];
 
-    const double T0 = Mara->eos->TemperatureMeV(P0[rho], P0[pre]);
+    const double T0 = Mara->eos->TemperatureArbToMeV(P0[rho], T[i]);
     const double T1 = T0 - dt * (Tref/t0) * pow(T0/Tref, 4);
 
+    T[i] = Mara->eos->TemperatureArb(P0[rho], T1);
+
     Mara->fluid->PrimToCons(&P0[0], &U0[0]);
-    P0[pre] = Mara->eos->Pressure(P0[rho], Mara->eos->TemperatureArb(P0[rho], T1));
+    P0[pre] = Mara->eos->Pressure(P0[rho], T[i]);
     Mara->fluid->PrimToCons(&P0[0], &U1[0]);
 
     energy_removed += (U0[tau] - U1[tau])*dV;
@@ -66,6 +76,7 @@ CoolingModuleE4::CoolingModuleE4(double eref, double t0)
 
 void CoolingModuleE4::Cool(std::valarray<double> &P, double dt)
 {
+  Profile::Scope timer(Profile::TIMER_COOLING);
   const int Nq = Mara->domain->get_Nq();
   const double dx = Mara->domain->get_dx(1);
   const double dy = Mara->domain->get_dx(2);
@@ -75,19 +86,32 @@ void CoolingModuleE4::Cool(std::valarray<double> &P, double dt)
   double *U0 = new double[Nq];
   double *U1 = new double[Nq];
 
-  for (size_t i=0; i<P.size()/Nq; ++i) {
+  // Both inversions are done in batches, each starting from the temperatures
+  // found before it, and the cooled ones are kept for the next step.
+  // ---------------------------------------------------------------------------
+  const size_t N = P.size()/Nq;
+  std::valarray<double> &T = Mara->TemperatureArray;
+  std::valarray<double> D1(N), u1(N);
+  Mara->eos->Temperatures(P, Nq, T);
 
-    std::slice m(i*Nq, Nq, 1);
-    std::valarray<double> P0 = P[m];
+  for (size_t i=0; i<N; ++i) {
+    const double e0 = Mara->eos->Internal(P[i*Nq + rho], T[i]) / P[i*Nq + rho];
+    const double e1 = e0 - dt * (eref/t0) * pow(e0/eref, 4);
+    D1[i] = P[i*Nq + rho];
+    u1[i] = P[i*Nq + rho]*e1;
+  }
 
-    const double T0 = Mara->eos->Temperature_p(P0[rho], P0[pre]);
-    const double e0 = Mara->eos->Internal(P0[rho], T0) / P0[rho];
+  if (N > 0) {
+    Mara->eos->TemperatureBatch_u(&D1[0], &u1[0], &T[0], N, 1, true);
+  }
 
-    const double e1 = e0 - dt * (eref/t0) * pow(e0/eref, 4);
-    const double T1 = Mara->eos->Temperature_u(P0[rho], P0[rho]*e1);
+  for (size_t i=0; i<N; ++i) {
+
+    std::slice m(i*Nq, Nq, 1);
+    std::valarray<double> P0 = P[m];
 
     Mara->fluid->PrimToCons(&P0[0], &U0[0]);
-    P0[pre] = Mara->eos->Pressure(P0[rho], T1);
+    P0[pre] = Mara->eos->Pressure(P0[rho], T[i]);
     Mara->fluid->PrimToCons(&P0[0], &U1[0]);
 
     energy_removed += (U0[tau] - U1[tau])*dV;
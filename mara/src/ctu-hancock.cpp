@@ -1,9 +1,11 @@
 
 #include <iostream>
 #include <cstring>
+#include <algorithm>
 #include "ctu-hancock.hpp"
 #include "logging.hpp"
 #include "mara_mpi.h"
+#include "profile.hpp"
 
 
 #define MAXNQ 8 // Used for static array initialization
@@ -17,6 +19,11 @@ static int DoNotTolerateFailures = 1;
  * Private inline functions
  *
  */
+static inline bool abort_on_failure()
+// In repair mode failures fall back on the zone centers, as when tolerated
+{
+  return DoNotTolerateFailures && !GodunovOperator::repair_failures;
+}
 static inline double sign(double x)
 {
   return (x>0)-(x<0);
@@ -50,24 +57,31 @@ void Deriv::SetSafetyLevel(int level)
     DoNotTolerateFailures = 0;
   }
 }
-std::valarray<double> Deriv::dUdt(const std::valarray<double> &Uin)
+void Deriv::dUdt(std::valarray<double> &Uin, std::valarray<double> &L)
 {
   this->prepare_integration();
 
-  std::valarray<double> U = Uin;
-  std::valarray<double> L(U.size());
   std::valarray<double> &P = Mara->PrimitiveArray;
 
   try {
-    this->ConsToPrim(U, P);
+    // -------------------------------------------------------------------------
+    // Equivalent to ConsToPrim, but zones outside the guard layer are inverted
+    // while the guard zones are exchanged.
+    // -------------------------------------------------------------------------
+    this->begin_cons_to_prim(Uin, P);
+    if (this->end_cons_to_prim(Uin, P) && repair_failures) {
+      if (Mara_mpi_int_sum(RepairFailures(Uin, P)) != 0) {
+        throw IntermediateFailure();
+      }
+    }
   }
   catch (const ConsToPrimFailure &e) {
     throw;
   }
 
-  this->ctu_hancock(&P[0], &U[0], &L[0], TimeStepDt);
-
-  return L;
+  Profile::Scope timer(Profile::TIMER_FLUX_SWEEP);
+  Profile::Count(Profile::COUNT_FACES_SWEPT, ND*stride[0]/NQ);
+  this->ctu_hancock(&P[0], &Uin[0], &L[0], TimeStepDt);
 }
 void Deriv::reconstruct_plm(const double *P0, double *Pl, double *Pr, int S)
 {
@@ -78,7 +92,189 @@ void Deriv::reconstruct_plm(const double *P0, double *Pl, double *Pr, int S)
   }
 }
 
+void Deriv::invert_predictor(const double *P, const std::vector<int> &runs)
+// -----------------------------------------------------------------------------
+// Recovers the primitive predictor states Px, Py, Pz of the zones in runs. A
+// zone whose inversion fails keeps the input primitives, and either has its
+// fail flag set or, if failures are tolerated, is recorded in repair_zones
+// along with the axis, to be reverted to the input conserved state.
+// -----------------------------------------------------------------------------
+{
+  FluidEquations &fluid = *Mara->fluid;
+  std::valarray<double> *Ud[4] = { NULL, &Ux, &Uy, &Uz };
+  std::valarray<double> *Pd[4] = { NULL, &Px, &Py, &Pz };
+
+  for (size_t r=0; r<runs.size(); r+=2) {
+    for (int i=runs[r]*NQ; i<runs[r+1]*NQ; i+=NQ) {
+      for (int d=1; d<=ND; ++d) {
+        std::memcpy(&(*Pd[d])[i], &P[i], NQ*sizeof(double));
+        if (fluid.ConsToPrim(&(*Ud[d])[i], &(*Pd[d])[i])) {
+          // -------------------------------------------------------------------
+          // Unless we are tolerating errors, set the fail flag for this zone.
+          // -------------------------------------------------------------------
+          if (abort_on_failure()) {
+            Mara->FailureMask[i/NQ] += 1;
+          }
+          else {
+            repair_zones.push_back(i);
+            repair_zones.push_back(d);
+          }
+        }
+      }
+    }
+  }
+}
+
+int Deriv::Box::index(int a, int b, int c) const
+{
+  return ((a-lo[0])*(hi[1]-lo[1]) + (b-lo[1]))*(hi[2]-lo[2]) + (c-lo[2]);
+}
+int Deriv::Box::size() const
+{
+  return (hi[0]-lo[0])*(hi[1]-lo[1])*(hi[2]-lo[2]);
+}
+bool Deriv::Box::contains(int a, int b, int c) const
+{
+  return (lo[0] <= a && a < hi[0] &&
+          lo[1] <= b && b < hi[1] &&
+          lo[2] <= c && c < hi[2]);
+}
+
+int Deriv::zone_index(int a, int b, int c) const
+// -----------------------------------------------------------------------------
+// Index of the zone at (a,b,c). Coordinates one past either end of an axis
+// wrap onto the neighboring row, just as offsetting a memory index by a stride
+// does, so that boxes extending past the domain see what the full-grid passes
+// used to.
+// -----------------------------------------------------------------------------
+{
+  return (a*stride[1] + b*stride[2] + c*stride[3]) / NQ;
+}
+void Deriv::compute_slopes(const double *P, const Box &B)
+// -----------------------------------------------------------------------------
+// Computes the PLM slopes of P along each axis, over the zones of B. Slopes are
+// zero outside [sx, stride[0]-sx), where the full-grid pass left them unset.
+// -----------------------------------------------------------------------------
+{
+  slope_box = B;
+  const int sx = stride[1];
+
+  for (int d=0; d<ND; ++d) {
+    const int S = stride[d+1];
+    if (tile_slope[d].size() < size_t(B.size()*NQ)) {
+      tile_slope[d].resize(B.size()*NQ);
+    }
+    for (int a=B.lo[0]; a<B.hi[0]; ++a) {
+      for (int b=B.lo[1]; b<B.hi[1]; ++b) {
+        for (int c=B.lo[2]; c<B.hi[2]; ++c) {
+          const int i = zone_index(a, b, c) * NQ;
+          double *dP = &tile_slope[d][B.index(a, b, c)*NQ];
+          if (i >= sx && i < stride[0]-sx) {
+            for (int q=0; q<NQ; ++q) {
+              dP[q] = plm_minmod(P[i-S+q], P[i+q], P[i+S+q]);
+            }
+          }
+          else {
+            for (int q=0; q<NQ; ++q) dP[q] = 0.0;
+          }
+        }
+      }
+    }
+  }
+}
+const double *Deriv::slope(int d, int a, int b, int c) const
+{
+  return &tile_slope[d][slope_box.index(a, b, c)*NQ];
+}
+void Deriv::face_flux(const double *Q, const double *P, int d, int a, int b,
+                      int c, double *F, bool own)
+// -----------------------------------------------------------------------------
+// Writes to F the Godunov flux through the face of zone (a,b,c) facing +d. The
+// states on either side are those of Q, reconstructed with the slopes of P. If
+// they are unphysical, then the face either fails, which is only recorded if
+// the face is owned by the current tile, or falls back on the zone-centered
+// primitives P. The slopes of both zones must be in the slope box.
+// -----------------------------------------------------------------------------
+{
+  const int S = stride[d+1];
+  const int i = zone_index(a, b, c) * NQ;
+  const double *dl = slope(d, a, b, c);
+  const double *dr = slope(d, a+(d==0), b+(d==1), c+(d==2));
+  double Pl[MAXNQ], Pr[MAXNQ];
+
+  for (int j=0; j<NQ; ++j) {
+    Pr[j] = Q[i+S+j] - 0.5*dr[j];
+    Pl[j] = Q[i  +j] + 0.5*dl[j];
+  }
+  if (Mara->fluid->PrimCheck(Pl) || Mara->fluid->PrimCheck(Pr)) {
+    // -------------------------------------------------------------------------
+    // If the reconstructed primitive state was unphysical,
+    // DoNotTolerateFailures=1 will set the fail flag for this zone, triggering
+    // an abort for this integration. DoNotTolerateFailures=0 indicates that the
+    // the zone-centered primitives will be used instead.
+    // -------------------------------------------------------------------------
+    if (abort_on_failure()) {
+      if (own) Mara->FailureMask[i/NQ] += 1;
+    }
+    else {
+      Mara->riemann->IntercellFlux(&P[i], &P[i+S], 0, F, 0.0, d+1);
+    }
+  }
+  else {
+    Mara->riemann->IntercellFlux(Pl, Pr, 0, F, 0.0, d+1);
+  }
+}
+void Deriv::predictor_fluxes(const double *P, const Box &T)
+// -----------------------------------------------------------------------------
+// Computes the fluxes through the faces the Hancock predictor of tile T needs:
+// those of its own zones, and of the zones just below it along each axis. The
+// latter are also computed by the tiles owning them, which alone record their
+// failures. Faces outside of [sx, stride[0]-sx) are taken from the global
+// fluxes, which hold what the full-grid pass would have seen there.
+// -----------------------------------------------------------------------------
+{
+  const std::valarray<double> *Fglb[3] = { &F, &G, &H };
+  const int sx = stride[1];
+
+  for (int d=0; d<ND; ++d) {
+    Box &B = flux_box[d];
+    B = T;
+    B.lo[d] -= 1;
+    if (tile_flux[d].size() < size_t(B.size()*NQ)) {
+      tile_flux[d].resize(B.size()*NQ);
+    }
+    for (int a=B.lo[0]; a<B.hi[0]; ++a) {
+      for (int b=B.lo[1]; b<B.hi[1]; ++b) {
+        for (int c=B.lo[2]; c<B.hi[2]; ++c) {
+          const int i = zone_index(a, b, c) * NQ;
+          double *Fd = &tile_flux[d][B.index(a, b, c)*NQ];
+          if (i < sx || i >= stride[0]-sx) {
+            std::memcpy(Fd, &(*Fglb[d])[i], NQ*sizeof(double));
+          }
+          else {
+            face_flux(P, P, d, a, b, c, Fd, T.contains(a, b, c));
+          }
+        }
+      }
+    }
+  }
+}
+const double *Deriv::tile_flux_at(int d, int a, int b, int c) const
+{
+  return &tile_flux[d][flux_box[d].index(a, b, c)*NQ];
+}
+
 void Deriv::ctu_hancock(const double *P, const double *U, double *L, double dt)
+// -----------------------------------------------------------------------------
+// The predictor is computed over cache-sized tiles of zones. For each tile, the
+// slopes and the Godunov fluxes it needs are computed into tile-sized buffers,
+// recomputing those on the faces shared with the neighboring tiles, and only
+// the predictor states are written to the global arrays. The predictor states
+// are then exchanged, after which the corrector fluxes are computed over tiles
+// in the same way and written to the global arrays, where constrained
+// transport operates on them. Every face and zone is computed with the same
+// arithmetic as in one full-grid pass per stage, so the result is the same.
+// -----------------------------------------------------------------------------
 {
   const int num_dims=ND;
   const int D1=(num_dims>=1);
@@ -89,245 +285,185 @@ void Deriv::ctu_hancock(const double *P, const double *U, double *L, double dt)
   const int N3=stride[0]*D3;
 
   FluidEquations     &fluid    = *Mara->fluid;
-  RiemannSolver      &riemann  = *Mara->riemann;
   BoundaryConditions &boundary = *Mara->boundary;
 
-  std::valarray<double> F(N1), G(N2), H(N3);
-  std::valarray<double> Ux(N1), Uy(N2), Uz(N3);
-  std::valarray<double> Px(N1), Py(N2), Pz(N3);
-  std::valarray<double> dPdx(N1), dPdy(N2), dPdz(N3);
+  // The work arrays are members, so they are only (re-)allocated when the
+  // domain changes. Entries which are never written remain zero.
+  // ---------------------------------------------------------------------------
+  std::valarray<double> *work[9] = { &F , &G , &H ,
+                                     &Ux, &Uy, &Uz,
+                                     &Px, &Py, &Pz };
+  for (int n=0; n<9; ++n) {
+    const size_t Nw = (n%3 == 0) ? N1 : (n%3 == 1) ? N2 : N3;
+    if (work[n]->size() != Nw) work[n]->resize(Nw);
+  }
 
   const int sx=stride[1], sy=stride[2], sz=stride[3];
+  int shape[3], tile[3];
+  for (int d=0; d<3; ++d) {
+    shape[d] = stride[d] / stride[d+1];
+    tile [d] = (d < ND) ? TILE : 1;
+  }
 
   Mara->FailureMask = 0;
+  predictor_fails.clear();
 
   /* Step 1
      ---------------------------------------------------------------------------
-     Compute the slopes of primitive quantities in each direction.
+     Compute the slopes of primitive quantities in each direction, and apply the
+     Godunov operator to the faces of the first plane of zones.
 
-     Note: These derivatives, computed at the beginning of the time step, are
-     used for the reconstructed values in the Hancock and Godunov operators for
-     both the predictor and corrector steps.
+     Notes:
+
+     1) The slopes of P, taken at the beginning of the time step, are used for
+     the reconstructed values in the Hancock and Godunov operators for both the
+     predictor and corrector steps. They are recomputed for each tile.
+
+     2) The fluxes through the faces of the first plane are not needed by the
+     predictor of any zone, but those along x are used by the corrector of the
+     second plane, so they are written to the global arrays.
      ---------------------------------------------------------------------------
   */
-  for (int i=sx; i<stride[0]-sx; ++i) {
-    if(D1) dPdx[i] = plm_minmod(P[i-sx], P[i], P[i+sx]);
-    if(D2) dPdy[i] = plm_minmod(P[i-sy], P[i], P[i+sy]);
-    if(D3) dPdz[i] = plm_minmod(P[i-sz], P[i], P[i+sz]);
+  {
+    Box B = { { 0, 0, 0 }, { 2, shape[1] + D2, shape[2] + D3 } };
+    std::valarray<double> *Fglb[3] = { &F, &G, &H };
+    compute_slopes(P, B);
+
+    for (int b=0; b<shape[1]; ++b) {
+      for (int c=0; c<shape[2]; ++c) {
+        const int i = zone_index(0, b, c) * NQ;
+        for (int d=0; d<ND; ++d) {
+          face_flux(P, P, d, 0, b, c, &(*Fglb[d])[i], true);
+        }
+      }
+    }
   }
 
   /* Step 2
      ---------------------------------------------------------------------------
-     Apply the Godunov operator to each face in all directions.
+     Apply the Godunov operator to the faces of each tile and the Hancock
+     operators to its zones, completing the predictor step.
 
      Notes:
 
-     1) The whole array of intercell fluxes is computed at once, rather than one
-     cell at a time. This avoids redundant evaluations of the Godunov operator
-     by computing only one solution to the Riemann problem per face.
-
-     2) For the predictor step along a given axis, only the intercell fluxes in
+     1) For the predictor step along a given axis, only the intercell fluxes in
      the transverse directions are used. The Hancock operator is applied along
      the longitudinal direction.
-     ---------------------------------------------------------------------------
-  */
-  for (int i=0; i<stride[0]-sx; i+=NQ) {
-    double Pl[MAXNQ], Pr[MAXNQ];
 
-    if (D1) {
-      for (int j=0; j<NQ; ++j) {
-        Pr[j] = P[i+sx+j] - 0.5*dPdx[i+sx+j];
-        Pl[j] = P[i   +j] + 0.5*dPdx[i   +j];
-      }
-      if (fluid.PrimCheck(Pl) || fluid.PrimCheck(Pr)) {
-        // ---------------------------------------------------------------------
-        // If the reconstructed primitive state was unphysical,
-        // DoNotTolerateFailures=1 will set the fail flag for this zone,
-        // triggering an abort for this integration. DoNotTolerateFailures=0
-        // indicates that the the zone-centered primitives will be used instead.
-        // ---------------------------------------------------------------------
-        if (DoNotTolerateFailures) {
-          Mara->FailureMask[i/NQ] += 1;
-        }
-        else {
-          riemann.IntercellFlux(&P[i], &P[i+sx], 0, &F[i], 0.0, 1);
-        }
-      }
-      else {
-        riemann.IntercellFlux(Pl, Pr, 0, &F[i], 0.0, 1);
-      }
-    }
+     2) The Hancock operator is evaluated by summing the fluxes on the inner
+     walls of the local cell, so there is no danger of redundant calculations.
 
-    if (D2) {
-      for (int j=0; j<NQ; ++j) {
-        Pr[j] = P[i+sy+j] - 0.5*dPdy[i+sy+j];
-        Pl[j] = P[i   +j] + 0.5*dPdy[i   +j];
-      }
-      if (fluid.PrimCheck(Pl) || fluid.PrimCheck(Pr)) {
-        // ---------------------------------------------------------------------
-        // If the reconstructed primitive state was unphysical,
-        // DoNotTolerateFailures=1 will set the fail flag for this zone,
-        // triggering an abort for this integration. DoNotTolerateFailures=0
-        // indicates that the the zone-centered primitives will be used instead.
-        // ---------------------------------------------------------------------
-        if (DoNotTolerateFailures) {
-          Mara->FailureMask[i/NQ] += 1;
-        }
-        else {
-          riemann.IntercellFlux(&P[i], &P[i+sy], 0, &G[i], 0.0, 2);
+     3) A failed predictor is only recorded once the Godunov fluxes of every
+     tile have succeeded, since the full-grid pass aborted in between.
+     ---------------------------------------------------------------------------
+  */
+  for (int a0=1; a0<shape[0]; a0+=tile[0]) {
+  for (int b0=0; b0<shape[1]; b0+=tile[1]) {
+  for (int c0=0; c0<shape[2]; c0+=tile[2]) {
+
+    const Box T = { { a0, b0, c0 },
+                    { std::min(a0+tile[0], shape[0]),
+                      std::min(b0+tile[1], shape[1]),
+                      std::min(c0+tile[2], shape[2]) } };
+    const Box S = { { T.lo[0]-D1, T.lo[1]-D2, T.lo[2]-D3 },
+                    { T.hi[0]+D1, T.hi[1]+D2, T.hi[2]+D3 } };
+
+    compute_slopes(P, S);
+    predictor_fluxes(P, T);
+
+    for (int a=T.lo[0]; a<T.hi[0]; ++a) {
+    for (int b=T.lo[1]; b<T.hi[1]; ++b) {
+    for (int c=T.lo[2]; c<T.hi[2]; ++c) {
+
+      const int i = zone_index(a, b, c) * NQ;
+      double PL[MAXNQ], PR[MAXNQ]; // Capital L/R refers to left and right interior walls of
+      double UL[MAXNQ], UR[MAXNQ]; // the local cell, whereas lower-case l/r refer to i_{+-1/2}
+
+      double FH[3][2][MAXNQ]; // Hancock fluxes on the inner walls, by axis
+
+      for (int d=0; d<ND; ++d) {
+        const double *dP = slope(d, a, b, c);
+        for (int j=0; j<NQ; ++j) {
+          PL[j] = P[i+j] - 0.5*dP[j]; // Primitive states on the inner walls
+          PR[j] = P[i+j] + 0.5*dP[j]; // of the local cell facing d.
         }
-      }
-      else {
-        riemann.IntercellFlux(Pl, Pr, 0, &G[i], 0.0, 2);
-      }
-    }
-
-    if (D3) {
-      for (int j=0; j<NQ; ++j) {
-        Pr[j] = P[i+sz+j] - 0.5*dPdz[i+sz+j];
-        Pl[j] = P[i   +j] + 0.5*dPdz[i   +j];
-      }
-      if (fluid.PrimCheck(Pl) || fluid.PrimCheck(Pr)) {
-        // ---------------------------------------------------------------------
-        // If the reconstructed primitive state was unphysical,
-        // DoNotTolerateFailures=1 will set the fail flag for this zone,
-        // triggering an abort for this integration. DoNotTolerateFailures=0
-        // indicates that the the zone-centered primitives will be used instead.
-        // ---------------------------------------------------------------------
-        if (DoNotTolerateFailures) {
-          Mara->FailureMask[i/NQ] += 1;
+        if (fluid.PrimCheck(PL) || fluid.PrimCheck(PR)) {
+          if (abort_on_failure()) {
+            predictor_fails.push_back(i/NQ);
+          }
+          else {
+            fluid.FluxAndEigenvalues(&U[i], &P[i], FH[d][0], 0, 0, d+1);
+            fluid.FluxAndEigenvalues(&U[i], &P[i], FH[d][1], 0, 0, d+1);
+          }
         }
         else {
-          riemann.IntercellFlux(&P[i], &P[i+sz], 0, &H[i], 0.0, 3);
+          fluid.PrimToCons(PL, UL); // Corresponding conserved quantities and
+          fluid.PrimToCons(PR, UR); // fluxes in the d-direction.
+          fluid.FluxAndEigenvalues(UL, PL, FH[d][0], 0, 0, d+1);
+          fluid.FluxAndEigenvalues(UR, PR, FH[d][1], 0, 0, d+1);
         }
       }
-      else {
-        riemann.IntercellFlux(Pl, Pr, 0, &H[i], 0.0, 3);
-      }
-    }
-  }
-  // ***************************************************************************
-  // ABORT POINT
-  if (Mara_mpi_int_sum(Mara->FailureMask.sum()))    throw IntermediateFailure();
-  // ***************************************************************************
 
+      const double *FL = FH[0][0], *FR = FH[0][1];
+      const double *GL = FH[1][0], *GR = FH[1][1];
+      const double *HL = FH[2][0], *HR = FH[2][1];
 
-  /* Step 3
-     ---------------------------------------------------------------------------
-     Apply the Hancock operators and complete the corrector step.
-
-     Notes: This update occurs for a given cell all at once. The Hancock
-     operator is evaluated by summing the fluxes on the inner walls of the local
-     cell, so there is no danger of redundant calculations.
-     ---------------------------------------------------------------------------
-  */
-  for (int i=sx; i<stride[0]; i+=NQ) {
-    double PL[MAXNQ], PR[MAXNQ]; // Capital L/R refers to left and right interior walls of
-    double UL[MAXNQ], UR[MAXNQ]; // the local cell, whereas lower-case l/r refer to i_{+-1/2}
-
-    double FL[MAXNQ], FR[MAXNQ];
-    double GL[MAXNQ], GR[MAXNQ];
-    double HL[MAXNQ], HR[MAXNQ];
-
-    if (D1) {
-      for (int j=0; j<NQ; ++j) {
-        PL[j] = P[i+j] - 0.5*dPdx[i+j]; // Primitive states on the inner x-facing
-        PR[j] = P[i+j] + 0.5*dPdx[i+j]; // walls of the local cell.
-      }
-      if (fluid.PrimCheck(PL) || fluid.PrimCheck(PR)) {
-        if (DoNotTolerateFailures) {
-          Mara->FailureMask[i/NQ] += 1;
-        }
-        else {
-          fluid.FluxAndEigenvalues(&U[i], &P[i], FL, 0, 0, 1);
-          fluid.FluxAndEigenvalues(&U[i], &P[i], FR, 0, 0, 1);
+      switch (num_dims) {
+      case 1:                    /**** 1D ****/
+        for (int j=0; j<NQ; ++j) {
+          //                   Hancock (normal)
+          // ==========================================
+          Ux[i+j] = U[i+j] - ((FR[j]-FL[j])/dx)*0.5*dt;
+          // ==========================================
         }
-      }
-      else {
-        fluid.PrimToCons(PL, UL); // Corresponding conserved quantities and fluxes
-        fluid.PrimToCons(PR, UR); // in the x-direction.
-        fluid.FluxAndEigenvalues(UL, PL, FL, 0, 0, 1);
-        fluid.FluxAndEigenvalues(UR, PR, FR, 0, 0, 1);
-      }
-    }
-
-    if (D2) {
-      for (int j=0; j<NQ; ++j) {
-        PL[j] = P[i+j] - 0.5*dPdy[i+j]; // Primitive states on the inner y-facing
-        PR[j] = P[i+j] + 0.5*dPdy[i+j]; // walls of the local cell.
-      }
-      if (fluid.PrimCheck(PL) || fluid.PrimCheck(PR)) {
-        if (DoNotTolerateFailures) {
-          Mara->FailureMask[i/NQ] += 1;
+        break;
+      case 2:                    /**** 2D ****/
+        {
+          const double *F0 = tile_flux_at(0, a, b, c), *F1 = tile_flux_at(0, a-1, b, c);
+          const double *G0 = tile_flux_at(1, a, b, c), *G1 = tile_flux_at(1, a, b-1, c);
+          for (int j=0; j<NQ; ++j) {
+            //                   Hancock (normal)      Godunov (transverse)
+            // ==========================================================
+            Ux[i+j] = U[i+j] - ((FR[j]-FL[j])/dx + (G0[j]-G1[j])/dy)*0.5*dt;
+            Uy[i+j] = U[i+j] - ((GR[j]-GL[j])/dy + (F0[j]-F1[j])/dx)*0.5*dt;
+            // ==========================================================
+          }
         }
-        else {
-          fluid.FluxAndEigenvalues(&U[i], &P[i], GL, 0, 0, 2);
-          fluid.FluxAndEigenvalues(&U[i], &P[i], GR, 0, 0, 2);
+        break;
+      case 3:                    /**** 3D ****/
+        {
+          const double *F0 = tile_flux_at(0, a, b, c), *F1 = tile_flux_at(0, a-1, b, c);
+          const double *G0 = tile_flux_at(1, a, b, c), *G1 = tile_flux_at(1, a, b-1, c);
+          const double *H0 = tile_flux_at(2, a, b, c), *H1 = tile_flux_at(2, a, b, c-1);
+          for (int j=0; j<NQ; ++j) {
+            //                   Hancock (normal)      Godunov (transverse)
+            // ================================================================================
+            Ux[i+j] = U[i+j] - ((FR[j]-FL[j])/dx + (G0[j]-G1[j])/dy + (H0[j]-H1[j])/dz)*0.5*dt;
+            Uy[i+j] = U[i+j] - ((GR[j]-GL[j])/dy + (H0[j]-H1[j])/dz + (F0[j]-F1[j])/dx)*0.5*dt;
+            Uz[i+j] = U[i+j] - ((HR[j]-HL[j])/dz + (F0[j]-F1[j])/dx + (G0[j]-G1[j])/dy)*0.5*dt;
+            // ================================================================================
+          }
         }
-      }
-      else {
-        fluid.PrimToCons(PL, UL); // Corresponding conserved quantities and fluxes
-        fluid.PrimToCons(PR, UR); // in the y-direction.
-        fluid.FluxAndEigenvalues(UL, PL, GL, 0, 0, 2);
-        fluid.FluxAndEigenvalues(UR, PR, GR, 0, 0, 2);
+        break;
       }
     }
-
-    if (D3) {
-      for (int j=0; j<NQ; ++j) {
-        PL[j] = P[i+j] - 0.5*dPdz[i+j]; // Primitive states on the inner z-facing
-        PR[j] = P[i+j] + 0.5*dPdz[i+j]; // walls of the local cell.
-      }
-      if (fluid.PrimCheck(PL) || fluid.PrimCheck(PR)) {
-        if (DoNotTolerateFailures) {
-          Mara->FailureMask[i/NQ] += 1;
-        }
-        else {
-          fluid.FluxAndEigenvalues(&U[i], &P[i], HL, 0, 0, 3);
-          fluid.FluxAndEigenvalues(&U[i], &P[i], HR, 0, 0, 3);
-        }
-      }
-      else {
-        fluid.PrimToCons(PL, UL); // Corresponding conserved quantities and fluxes
-        fluid.PrimToCons(PR, UR); // in the z-direction.
-        fluid.FluxAndEigenvalues(UL, PL, HL, 0, 0, 3);
-        fluid.FluxAndEigenvalues(UR, PR, HR, 0, 0, 3);
-      }
     }
-
-    switch (num_dims) {
-    case 1:                    /**** 1D ****/
-      for (int j=0; j<NQ; ++j) {
-        //                   Hancock (normal)
-        // ==========================================
-        Ux[i+j] = U[i+j] - ((FR[j]-FL[j])/dx)*0.5*dt;
-        // ==========================================
-      }
-      break;
-    case 2:                    /**** 2D ****/
-      for (int j=0; j<NQ; ++j) {
-        //                   Hancock (normal)            Godunov (transverse)
-        // ==================================================================
-        Ux[i+j] = U[i+j] - ((FR[j]-FL[j])/dx + (G[i+j]-G[i-sy+j])/dy)*0.5*dt;
-        Uy[i+j] = U[i+j] - ((GR[j]-GL[j])/dy + (F[i+j]-F[i-sx+j])/dx)*0.5*dt;
-        // ==================================================================
-      }
-      break;
-    case 3:                    /**** 3D ****/
-      for (int j=0; j<NQ; ++j) {
-        //                   Hancock (normal)            Godunov (transverse)
-        // ==========================================================================================
-        Ux[i+j] = U[i+j] - ((FR[j]-FL[j])/dx + (G[i+j]-G[i-sy+j])/dy + (H[i+j]-H[i-sz+j])/dz)*0.5*dt;
-        Uy[i+j] = U[i+j] - ((GR[j]-GL[j])/dy + (H[i+j]-H[i-sz+j])/dz + (F[i+j]-F[i-sx+j])/dx)*0.5*dt;
-        Uz[i+j] = U[i+j] - ((HR[j]-HL[j])/dz + (F[i+j]-F[i-sx+j])/dx + (G[i+j]-G[i-sy+j])/dy)*0.5*dt;
-        // ==========================================================================================
-      }
-      break;
     }
   }
+  }
+  }
+  // ***************************************************************************
+  // ABORT POINT
+  if (abort_on_failure() &&
+      Mara_mpi_int_sum(Mara->FailureMask.sum()))    throw IntermediateFailure();
+  // ***************************************************************************
+  for (size_t n=0; n<predictor_fails.size(); ++n) {
+    Mara->FailureMask[predictor_fails[n]] += 1;
+  }
   // ***************************************************************************
   // ABORT POINT
-  if (Mara_mpi_int_sum(Mara->FailureMask.sum()))    throw IntermediateFailure();
+  if (abort_on_failure() &&
+      Mara_mpi_int_sum(Mara->FailureMask.sum()))    throw IntermediateFailure();
   // ***************************************************************************
 
 
@@ -339,58 +475,38 @@ void Deriv::ctu_hancock(const double *P, const double *U, double *L, double dt)
   // the ConsToPrim call if it fails.
   // ---------------------------------------------------------------------------
 
-  if (D1) boundary.ApplyBoundaries(Ux);
-  if (D2) boundary.ApplyBoundaries(Uy);
-  if (D3) boundary.ApplyBoundaries(Uz);
+  if (D1) boundary.BeginApplyBoundaries(Ux);
+  if (D2) boundary.BeginApplyBoundaries(Uy);
+  if (D3) boundary.BeginApplyBoundaries(Uz);
 
+  // The predictor states outside the guard layer are inverted while the guard
+  // zones are exchanged, and the remaining ones once they have arrived.
+  // ---------------------------------------------------------------------------
+  interior_runs(0, overlap_runs);
+  complement_runs(overlap_runs, 0, stride[0]/NQ, overlap_shell);
+  repair_zones.clear();
 
-  for (int i=0; i<stride[0]; i+=NQ) {
-    if (D1) {
-      std::memcpy(&Px[i], &P[i], NQ*sizeof(double));
-      if (fluid.ConsToPrim(&Ux[i], &Px[i])) {
-        // ---------------------------------------------------------------------
-        // Unless we are tolerating errors, set the fail flag for this zone.
-        // ---------------------------------------------------------------------
-        if (DoNotTolerateFailures) {
-          Mara->FailureMask[i/NQ] += 1;
-        }
-        else {
-          std::memcpy(&Ux[i], &U[i], NQ*sizeof(double));
-        }
-      }
-    }
-    if (D2) {
-      std::memcpy(&Py[i], &P[i], NQ*sizeof(double));
-      if (fluid.ConsToPrim(&Uy[i], &Py[i])) {
-        // ---------------------------------------------------------------------
-        // Unless we are tolerating errors, set the fail flag for this zone.
-        // ---------------------------------------------------------------------
-        if (DoNotTolerateFailures) {
-          Mara->FailureMask[i/NQ] += 1;
-        }
-        else {
-          std::memcpy(&Uy[i], &U[i], NQ*sizeof(double));
-        }
-      }
-    }
-    if (D3) {
-      std::memcpy(&Pz[i], &P[i], NQ*sizeof(double));
-      if (fluid.ConsToPrim(&Uz[i], &Pz[i])) {
-        // ---------------------------------------------------------------------
-        // Unless we are tolerating errors, set the fail flag for this zone.
-        // ---------------------------------------------------------------------
-        if (DoNotTolerateFailures) {
-          Mara->FailureMask[i/NQ] += 1;
-        }
-        else {
-          std::memcpy(&Uz[i], &U[i], NQ*sizeof(double));
-        }
-      }
-    }
+  invert_predictor(P, overlap_runs);
+
+  if (D1) boundary.EndApplyBoundaries(Ux);
+  if (D2) boundary.EndApplyBoundaries(Uy);
+  if (D3) boundary.EndApplyBoundaries(Uz);
+
+  invert_predictor(P, overlap_shell);
+
+  // Zones reverted to the input state are only written once the exchange is
+  // over, since the interior of the predictor states is being sent meanwhile.
+  // ---------------------------------------------------------------------------
+  for (size_t n=0; n<repair_zones.size(); n+=2) {
+    const int i = repair_zones[n];
+    std::valarray<double> &Ud = (repair_zones[n+1] == 1) ? Ux :
+                                (repair_zones[n+1] == 2) ? Uy : Uz;
+    std::memcpy(&Ud[i], &U[i], NQ*sizeof(double));
   }
   // ***************************************************************************
   // ABORT POINT
-  if (Mara_mpi_int_sum(Mara->FailureMask.sum()))    throw IntermediateFailure();
+  if (abort_on_failure() &&
+      Mara_mpi_int_sum(Mara->FailureMask.sum()))    throw IntermediateFailure();
   // ***************************************************************************
 
 
@@ -406,68 +522,40 @@ void Deriv::ctu_hancock(const double *P, const double *U, double *L, double dt)
      ---------------------------------------------------------------------------
   */
 
-  for (int i=sx; i<stride[0]-sx; i+=NQ) {
-    double Pl[MAXNQ], Pr[MAXNQ];
-
-    if (D1) {
-      for (int j=0; j<NQ; ++j) {
-        Pr[j] = Px[i+sx+j] - 0.5*dPdx[i+sx+j];
-        Pl[j] = Px[i   +j] + 0.5*dPdx[i   +j];
-      }
-      if (fluid.PrimCheck(Pl) || fluid.PrimCheck(Pr)) {
-	if (DoNotTolerateFailures) {
-          Mara->FailureMask[i/NQ] += 1;
+  for (int a0=1; a0<shape[0]-1; a0+=tile[0]) {
+  for (int b0=0; b0<shape[1]; b0+=tile[1]) {
+  for (int c0=0; c0<shape[2]; c0+=tile[2]) {
+
+    const Box T = { { a0, b0, c0 },
+                    { std::min(a0+tile[0], shape[0]-1),
+                      std::min(b0+tile[1], shape[1]),
+                      std::min(c0+tile[2], shape[2]) } };
+    const Box S = { { T.lo[0], T.lo[1], T.lo[2] },
+                    { T.hi[0]+D1, T.hi[1]+D2, T.hi[2]+D3 } };
+    const double *Pd[3] = { &Px[0], D2 ? &Py[0] : NULL, D3 ? &Pz[0] : NULL };
+    std::valarray<double> *Fglb[3] = { &F, &G, &H };
+
+    compute_slopes(P, S);
+
+    for (int a=T.lo[0]; a<T.hi[0]; ++a) {
+      for (int b=T.lo[1]; b<T.hi[1]; ++b) {
+        for (int c=T.lo[2]; c<T.hi[2]; ++c) {
+          const int i = zone_index(a, b, c) * NQ;
+          for (int d=0; d<ND; ++d) {
+            face_flux(Pd[d], P, d, a, b, c, &(*Fglb[d])[i], true);
+          }
         }
-	else {
-	  riemann.IntercellFlux(&P[i], &P[i+sx], 0, &F[i], 0.0, 1);
-	}
-      }
-      else {
-        riemann.IntercellFlux(Pl, Pr, 0, &F[i], 0.0, 1);
-      }
-    }
-
-    if (D2) {
-      for (int j=0; j<NQ; ++j) {
-        Pr[j] = Py[i+sy+j] - 0.5*dPdy[i+sy+j];
-        Pl[j] = Py[i   +j] + 0.5*dPdy[i   +j];
-      }
-      if (fluid.PrimCheck(Pl) || fluid.PrimCheck(Pr)) {
-	if (DoNotTolerateFailures) {
-          Mara->FailureMask[i/NQ] += 1;
-        }
-	else {
-	  riemann.IntercellFlux(&P[i], &P[i+sy], 0, &G[i], 0.0, 2);
-	}
-      }
-      else {
-        riemann.IntercellFlux(Pl, Pr, 0, &G[i], 0.0, 2);
-      }
-    }
-
-    if (D3) {
-      for (int j=0; j<NQ; ++j) {
-        Pr[j] = Pz[i+sz+j] - 0.5*dPdz[i+sz+j];
-        Pl[j] = Pz[i   +j] + 0.5*dPdz[i   +j];
-      }
-      if (fluid.PrimCheck(Pl) || fluid.PrimCheck(Pr)) {
-	if (DoNotTolerateFailures) {
-          Mara->FailureMask[i/NQ] += 1;
-        }
-	else {
-	  riemann.IntercellFlux(&P[i], &P[i+sz], 0, &H[i], 0.0, 3);
-	}
-      }
-      else {
-        riemann.IntercellFlux(Pl, Pr, 0, &H[i], 0.0, 3);
       }
     }
   }
+  }
+  }
 
   switch (num_dims) {
     /*---------------------------------- 1D ----------------------------------*/
   case 1:
     // No constrained transport
+    for (int i=0; i<sx; ++i) L[i] = 0.0;
     for (int i=sx; i<stride[0]; ++i) {
       L[i] = -((F[i]-F[i-sx])/dx);
     }
@@ -475,6 +563,7 @@ void Deriv::ctu_hancock(const double *P, const double *U, double *L, double dt)
     /*---------------------------------- 2D ----------------------------------*/
   case 2:
     fluid.ConstrainedTransport2d(&F[0], &G[0], stride);
+    for (int i=0; i<sx; ++i) L[i] = 0.0;
     for (int i=sx; i<stride[0]; ++i) {
       L[i] = -((F[i]-F[i-sx])/dx + (G[i]-G[i-sy])/dy);
     }
@@ -482,6 +571,7 @@ void Deriv::ctu_hancock(const double *P, const double *U, double *L, double dt)
     /*---------------------------------- 3D ----------------------------------*/
   case 3:
     fluid.ConstrainedTransport3d(&F[0], &G[0], &H[0], stride);
+    for (int i=0; i<sx; ++i) L[i] = 0.0;
     for (int i=sx; i<stride[0]; ++i) {
       L[i] = -((F[i]-F[i-sx])/dx + (G[i]-G[i-sy])/dy + (H[i]-H[i-sz])/dz);
     }
@@ -489,6 +579,7 @@ void Deriv::ctu_hancock(const double *P, const double *U, double *L, double dt)
   }
   // ***************************************************************************
   // ABORT POINT
-  if (Mara_mpi_int_sum(Mara->FailureMask.sum()))    throw IntermediateFailure();
+  if (abort_on_failure() &&
+      Mara_mpi_int_sum(Mara->FailureMask.sum()))    throw IntermediateFailure();
   // ***************************************************************************
 }
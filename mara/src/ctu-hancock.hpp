@@ -8,12 +8,43 @@
 class PlmCtuHancockOperator : public GodunovOperator
 {
 private:
+  std::valarray<double> F, G, H;            // Godunov intercell fluxes
+  std::valarray<double> Ux, Uy, Uz;         // Hancock predictor states
+  std::valarray<double> Px, Py, Pz;         // " " primitive
+  std::vector<int> repair_zones;            // (index, axis) of failed predictors
+  std::vector<int> predictor_fails;         // zones with unphysical Hancock states
+
+  // ---------------------------------------------------------------------------
+  // Boxes of zones [lo, hi) along each axis, and the tile-sized buffers for the
+  // PLM slopes along each axis and the fluxes through the faces facing +d.
+  // ---------------------------------------------------------------------------
+  enum { TILE = 16 };                       // zones per side of a tile
+  struct Box
+  {
+    int lo[3], hi[3];
+    int index(int a, int b, int c) const;
+    int size() const;
+    bool contains(int a, int b, int c) const;
+  } ;
+  Box slope_box, flux_box[3];
+  std::vector<double> tile_slope[3];
+  std::vector<double> tile_flux[3];
+
+  int zone_index(int a, int b, int c) const;
+  void compute_slopes(const double *P, const Box &B);
+  const double *slope(int d, int a, int b, int c) const;
+  const double *tile_flux_at(int d, int a, int b, int c) const;
+  void face_flux(const double *Q, const double *P, int d, int a, int b, int c,
+                 double *F, bool own);
+  void predictor_fluxes(const double *P, const Box &T);
+
   void reconstruct_plm(const double *P0, double *Pl, double *Pr, int S);
+  void invert_predictor(const double *P, const std::vector<int> &runs);
   void ctu_hancock(const double *P, const double *U, double *L, double dt);
   double TimeStepDt;
 
 public:
-  std::valarray<double> dUdt(const std::valarray<double> &Uin);
+  void dUdt(std::valarray<double> &Uin, std::valarray<double> &L);
   void SetTimeStepDt(double dt) { TimeStepDt = dt; }
   void SetPlmTheta(double plm);
   void SetSafetyLevel(int level);
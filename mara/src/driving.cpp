@@ -8,6 +8,7 @@
 #include "rmhd.hpp"
 #include "eos.hpp"
 #include "mara_mpi.h"
+#include "profile.hpp"
 
 
 DrivingProcedure::DrivingProcedure(StochasticVectorField *field)
@@ -85,6 +86,7 @@ void DrivingProcedure::ResampleField()
 
 void DrivingProcedure::Drive(std::valarray<double> &P, double dt)
 {
+  Profile::Scope timer(Profile::TIMER_DRIVING);
   if (typeid(*Mara->fluid) == typeid(AdiabaticIdealEulers)) {
     Drive_eulers(P, dt);
   }
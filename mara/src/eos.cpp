@@ -1,9 +1,44 @@
 
 
 #include "eos.hpp"
+#include "mara_mpi.h"
 static const double Kelvin_to_MeV = 8.621738e-11;
 
 
+bool EosTableStorage::node_shared = false;
+
+EosTableStorage::~EosTableStorage()
+{
+  Mara_mpi_shared_del(shared);
+}
+
+double *EosTableStorage::Allocate(size_t n, bool share)
+{
+  Mara_mpi_shared_del(shared);
+  shared = NULL;
+  local.clear();
+
+  if (share) {
+    shared = Mara_mpi_shared_new(n);
+    writer = Mara_mpi_shared_writer(shared);
+    data = Mara_mpi_shared_data(shared);
+  }
+  else {
+    local.resize(n);
+    writer = true;
+    data = &local[0];
+  }
+  return data;
+}
+
+void EosTableStorage::Publish()
+{
+  if (shared) {
+    Mara_mpi_shared_sync(shared);
+  }
+}
+
+
 AdiabaticEos::AdiabaticEos(double Gamma) : Gamma(Gamma) { }
 
 double AdiabaticEos::Pressure(double rho, double T) const
@@ -4,6 +4,8 @@
 
 #include "hydro.hpp"
 
+struct Mara_mpi_shared;
+
 
 
 // -----------------------------------------------------------------------------
@@ -96,6 +98,35 @@ public:
 
 
 
+class EosTableStorage
+// -----------------------------------------------------------------------------
+// One block of doubles holding all the arrays of a tabulated EOS. A shared
+// block is allocated once per node and written by a single rank, the Writer,
+// after which Publish makes it readable to the rest of the node; both calls
+// are then collective. A block which is not shared is owned by each rank.
+// -----------------------------------------------------------------------------
+{
+public:
+  static bool node_shared; // whether set_eos builds tables as shared blocks
+
+  EosTableStorage() : shared(NULL), writer(true), data(NULL) { }
+  ~EosTableStorage();
+
+  double *Allocate(size_t n, bool share);
+  void Publish();
+  bool Writer() const { return writer; }
+  const double *Data() const { return data; }
+
+private:
+  EosTableStorage(const EosTableStorage &other);
+  EosTableStorage &operator=(const EosTableStorage &other);
+
+  std::vector<double> local;
+  Mara_mpi_shared *shared;
+  bool writer;
+  double *data;
+} ;
+
 struct TabulatedEos
 {
   std::vector<double> logD_values;
@@ -112,9 +143,11 @@ public:
   static bool verbose;
   static TabulatedEos LoadTable(const char *fname, double YpExtract,
                                 const double *TempRange, const double *DensRange);
+  static void WriteBinaryTable(const char *fname, const TabulatedEos &tab);
 
-  ShenTabulatedNuclearEos(const TabulatedEos &tab);
-  ~ShenTabulatedNuclearEos() { }
+  ShenTabulatedNuclearEos(const TabulatedEos &tab, bool node_shared=false);
+  ShenTabulatedNuclearEos(const char *binary_fname); // maps the table read-only
+  ~ShenTabulatedNuclearEos();
 
   // Public interface
   // ---------------------------------------------------------------------------
@@ -128,16 +161,33 @@ public:
   double Temperature_p (double D, double p) const;
   double TemperatureMeV(double D, double p) const;
   double TemperatureArb(double D, double T_MeV) const;
+  double TemperatureArbToMeV(double D, double T) const;
+
+  void TemperatureBatch_p(const double *D, const double *p, double *T,
+                          int n, int stride, bool warm) const;
+  void TemperatureBatch_u(const double *D, const double *u, double *T,
+                          int n, int stride, bool warm) const;
 
   double Derivatives_u(double D, double T, double *J) const;
   double Derivatives_p(double D, double T, double *J) const;
+  void Derivatives_pu(double D, double T, double *p, double *u,
+                      double *Jp, double *Ju) const;
 
   double DensLower() const; // returns lower/upper bound on D in code units
   double DensUpper() const;
 
   double TempLower() const; // returns lower/upper bound on T in code units
   double TempUpper() const;
+  bool IsTabulated() const { return true; }
+
 
+  // Quantities stored together at each (D,T) sample of the table. SampleAll
+  // receives logD and logT in table units, and writes 3*NumSampled values: for
+  // each quantity its value (log10 for p, s, u), then its derivatives with
+  // respect to logD and logT.
+  // ---------------------------------------------------------------------------
+  enum SampledQuantity { SampleP, SampleS, SampleU, SampleCs2, NumSampled } ;
+  void SampleAll(double logD, double logT, double *out) const;
 
 
   // Unit self-tests
@@ -153,15 +203,11 @@ public:
   // ---------------------------------------------------------------------------
   class UnableToLoadTable : public std::exception {
   public: virtual const char *what() const throw() {
-    return "The ASCII table for Shen nuclear EOS could not be loaded."; } } ;
-
-  class SampledOutOfRangeDensity : public std::exception {
-  public: virtual const char *what() const throw() {
-    return "Sampled the density out of the table's domain."; } } ;
+    return "The table for Shen nuclear EOS could not be loaded."; } } ;
 
-  class SampledOutOfRangeTemperature : public std::exception {
+  class UnableToWriteTable : public std::exception {
   public: virtual const char *what() const throw() {
-    return "Sampled the temperature out of the table's domain."; } } ;
+    return "The binary table for Shen nuclear EOS could not be written."; } } ;
 
   class SampledNegativePressure : public std::exception {
   public: virtual const char *what() const throw() {
@@ -181,32 +227,47 @@ private:
 
 
   //  void load_from_table();
-  void tabulate_derivatives();
+  ShenTabulatedNuclearEos(const ShenTabulatedNuclearEos &other);
+  ShenTabulatedNuclearEos &operator=(const ShenTabulatedNuclearEos &other);
+
+  void attach_arrays(const double *base);
+  void tabulate_derivatives(double *table) const;
   int find_upper_index_D(double logD) const;
   int find_upper_index_T(double logT) const;
-  double sample_EOS(const std::vector<double> &EOS,
+  double sample_EOS(int q, double logD, double logT, double *J=NULL) const;
+  double approx_EOS(int q, double logD, double logT, double *J=NULL) const;
+  double tabled_EOS(int q, int Di, int Tj,
                     double logD, double logT, double *J=NULL) const;
-  double approx_EOS(const std::vector<double> &EOS,
-                    double logD, double logT, double *J=NULL) const;
-  double tabled_EOS(const std::vector<double> &EOS,
-                    double logD, double logT, double *J=NULL) const;
-  double inverse_lookup_T(const std::vector<double> &EOS,
-                          double logD, double logF) const;
+  double inverse_lookup_T(int q, double logD, double logF) const;
+  double inverse_lookup_T_near(int q, double logD, double logF,
+                               double logT_guess) const;
+  double entry(int q, int i, int j) const { return EOS_table[NumSampled*(i + j*ND) + q]; }
 
 
-  // Private member data
+  // Private member data. The arrays below point into a single block laid out
+  // as logD, logT, then the table, which is either held in Table or is a
+  // read-only mapping of a binary table file.
   // ---------------------------------------------------------------------------
-  std::vector<double> logD_values; // in code units
-  std::vector<double> logT_values;
-
-
-  // All values are in log10
+  int ND, NT;
+  EosTableStorage Table;
+  void *mapping;
+  size_t mapping_size;
+
+  const double *logD_values; // in code units
+  const double *logT_values;
+  double dlogD_inv, dlogT_inv; // inverse spacing of the uniform grids
+
+
+  // The quantities p, s, u, cs2 interleaved at each sample (i,j), which are in
+  // Fortran order, so that entry q of sample (i,j) is at NumSampled*(i + j*ND)
+  // + q. All but cs2 are in log10.
+  //
+  // p   : gas pressure    (MeV/fm^3)
+  // s   : entropy per particle (kB)
+  // u   : energy density  (MeV/fm^3) not including rest mass
+  // cs2 : sound speed squared (units of light speed)
   // ---------------------------------------------------------------------------
-  std::vector<double> EOS_p; // gas pressure    (MeV/fm^3)
-  std::vector<double> EOS_s; // entropy per particle (kB)
-  std::vector<double> EOS_u; // energy density  (MeV/fm^3) not including rest mass
-
-  std::vector<double> EOS_cs2; // sound speed squared
+  const double *EOS_table;
 } ;
 
 
@@ -222,7 +283,8 @@ public:
 		      std::vector<double> &T_values,
 		      std::vector<double> &p,
                       std::vector<double> &u,
-                      std::vector<double> &c);
+                      std::vector<double> &c,
+                      bool node_shared=false);
   ~GenericTabulatedEos() { }
 
   // Public interface
@@ -236,17 +298,16 @@ public:
   double Temperature_p (double D, double p) const;
   double TemperatureMeV(double D, double p) const;
   double TemperatureArb(double D, double T_MeV) const;
+  double TemperatureArbToMeV(double D, double T) const;
+  void TemperatureBatch_p(const double *D, const double *p, double *T,
+                          int n, int stride, bool warm) const;
+  void TemperatureBatch_u(const double *D, const double *u, double *T,
+                          int n, int stride, bool warm) const;
 
   double Derivatives_u(double D, double T, double *J) const;
   double Derivatives_p(double D, double T, double *J) const;
+  bool IsTabulated() const { return true; }
 
-  class SampledOutOfRangeDensity : public std::exception {
-  public: virtual const char *what() const throw() {
-    return "Sampled the density out of the table's domain."; } } ;
-
-  class SampledOutOfRangeTemperature : public std::exception {
-  public: virtual const char *what() const throw() {
-    return "Sampled the temperature out of the table's domain."; } } ;
 
 private:
 
@@ -254,26 +315,31 @@ private:
   // ---------------------------------------------------------------------------
   int find_upper_index_D(double D) const;
   int find_upper_index_T(double T) const;
-  double sample_EOS(const std::vector<double> &EOS,
+  double sample_EOS(const double *EOS,
                     double D, double T, double *J=NULL) const;
-  double approx_EOS(const std::vector<double> &EOS,
+  double approx_EOS(const double *EOS,
                     double D, double T, double *J=NULL) const;
-  double tabled_EOS(const std::vector<double> &EOS,
+  double tabled_EOS(const double *EOS, int Di, int Tj,
                     double D, double T, double *J=NULL) const;
-  double inverse_lookup_T(const std::vector<double> &EOS,
+  double inverse_lookup_T(const double *EOS,
                           double D, double F) const;
+  double inverse_lookup_T_near(const double *EOS,
+                               double D, double F, double T_guess) const;
 
 
-  // Private member data
+  // Private member data. The arrays point into Table, laid out as D, T, p, u, c.
   // ---------------------------------------------------------------------------
-  const std::vector<double> D_values; // in code units
-  const std::vector<double> T_values;
+  const int ND, NT;
+  EosTableStorage Table;
+
+  const double *D_values; // in code units
+  const double *T_values;
 
   // EOS variables
   // ---------------------------------------------------------------------------
-  const std::vector<double> EOS_p; // gas pressure    (MeV/fm^3)
-  const std::vector<double> EOS_u; // energy density  (MeV/fm^3) no rest mass
-  const std::vector<double> EOS_c; // sound speed     (units of light-speed)
+  const double *EOS_p; // gas pressure    (MeV/fm^3)
+  const double *EOS_u; // energy density  (MeV/fm^3) no rest mass
+  const double *EOS_c; // sound speed     (units of light-speed)
 } ;
 
 #endif // __EquationOfStates_HEADER__
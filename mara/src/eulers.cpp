@@ -86,6 +86,74 @@ int Eulers::PrimToCons(const double *P, double *U) const
 
   return 0;
 }
+int Eulers::ConsToPrimBatch(const double *U, double *P, int nzones,
+                            int *fail) const
+// -----------------------------------------------------------------------------
+// Same arithmetic as ConsToPrim, over nzones zones. The first loop has no
+// branches or calls, so it may be vectorized. Zones are checked for failure in
+// a second pass, and bad ones are reported just as ConsToPrim reports them.
+// -----------------------------------------------------------------------------
+{
+  const double gm1 = Mara->GetEos<AdiabaticEos>().Gamma - 1.0;
+  int ttl_error = 0;
+
+  for (int n=0; n<nzones; ++n) {
+    const double *u = &U[5*n];
+    double *p = &P[5*n];
+    const double D = u[rho], E = u[nrg];
+    const double Mx = u[px], My = u[py], Mz = u[pz];
+
+    p[rho] = D;
+    p[pre] =(E - 0.5*(Mx*Mx + My*My + Mz*Mz)/D)*gm1;
+    p[vx ] = Mx / D;
+    p[vy ] = My / D;
+    p[vz ] = Mz / D;
+  }
+
+  for (int n=0; n<nzones; ++n) {
+    const double *u = &U[5*n];
+    const double *p = &P[5*n];
+    const char *msg = NULL;
+
+    if      (p[rho] < 0.0) msg = "Got negative density.";
+    else if (p[pre] < 0.0) msg = "Got negative pressure.";
+    else if (u[nrg] < 0.0) msg = "Got negative energy.";
+
+    if (msg) {
+#pragma omp critical (debuglog)
+      {
+        DebugLog.Error("ConsToPrim") << msg << std::endl;
+        DebugLog.Error() << PrintPrim(p) << std::endl
+                         << PrintCons(u) << std::endl;
+      }
+      ++ttl_error;
+    }
+    if (fail) fail[n] = (msg != NULL);
+  }
+
+  return ttl_error;
+}
+int Eulers::PrimToConsBatch(const double *P, double *U, int nzones,
+                            int *fail) const
+{
+  const double gm1 = Mara->GetEos<AdiabaticEos>().Gamma - 1.0;
+
+  for (int n=0; n<nzones; ++n) {
+    const double *p = &P[5*n];
+    double *u = &U[5*n];
+    const double D = p[rho], pg = p[pre];
+    const double Vx = p[vx], Vy = p[vy], Vz = p[vz];
+
+    u[rho] = D;
+    u[px]  = D * Vx;
+    u[py]  = D * Vy;
+    u[pz]  = D * Vz;
+    u[nrg] = D * 0.5*(Vx*Vx + Vy*Vy + Vz*Vz) + pg/gm1;
+  }
+  if (fail) for (int n=0; n<nzones; ++n) fail[n] = 0;
+
+  return 0;
+}
 void Eulers::FluxAndEigenvalues(const double *U,
                                 const double *P, double *F,
                                 double *ap, double *am, int dimension) const
@@ -132,6 +200,47 @@ void Eulers::FluxAndEigenvalues(const double *U,
     break;
   }
 }
+void Eulers::FluxAndEigenvaluesBatch(const double *U,
+                                     const double *P, double *F,
+                                     double *ap, double *am, int nzones,
+                                     int dimension) const
+// -----------------------------------------------------------------------------
+// Same arithmetic as FluxAndEigenvalues, over nzones zones. The axis is chosen
+// once, outside the loops, which then have no branches or calls.
+// -----------------------------------------------------------------------------
+{
+  int p1=px, p2=py, p3=pz; // Conserved momenta, and the velocity along the axis
+  switch (dimension) {
+  case 1: p1=px; p2=py; p3=pz; break;
+  case 2: p1=py; p2=pz; p3=px; break;
+  case 3: p1=pz; p2=px; p3=py; break;
+  }
+  const int v1 = p1 - px + vx;
+
+  for (int n=0; n<nzones; ++n) {
+    const double *u = &U[5*n];
+    const double *p = &P[5*n];
+    double *f = &F[5*n];
+    const double v = p[v1], pg = p[pre];
+
+    f[rho] =  u[rho] * v;
+    f[nrg] = (u[nrg] + pg)*v;
+    f[p1 ] =  u[p1 ] * v + pg;
+    f[p2 ] =  u[p2 ] * v;
+    f[p3 ] =  u[p3 ] * v;
+  }
+  if (ap == 0 || am == 0) return; // User may skip eigenvalue calculation
+
+  const double gm = Mara->GetEos<AdiabaticEos>().Gamma;
+
+  for (int n=0; n<nzones; ++n) {
+    const double *u = &U[5*n];
+    const double *p = &P[5*n];
+    const double cs = sqrt(gm*p[pre] / u[rho]);
+    ap[n] = p[v1] + cs;
+    am[n] = p[v1] - cs;
+  }
+}
 
 #define EIGEN2
 
@@ -320,3 +429,21 @@ void Eulers::Eigensystem(const double *U, const double *P_,
   lam[4] = u;
 }
 #endif
+void Eulers::EigensystemBatch(const double *U, const double *P,
+                              double *L, double *R, double *lam, int nzones,
+                              int dim) const
+// Same as FluidEquations::EigensystemBatch, without a virtual call per zone
+{
+  double Lf[25], Rf[25], lamf[5];
+
+  for (int n=0; n<nzones; ++n) {
+    this->Eulers::Eigensystem(&U[n*5], &P[n*5], Lf, Rf, lamf, dim);
+    for (int m=0; m<25; ++m) {
+      L[m*nzones + n] = Lf[m];
+      R[m*nzones + n] = Rf[m];
+    }
+    for (int q=0; q<5; ++q) {
+      lam[q*nzones + n] = lamf[q];
+    }
+  }
+}
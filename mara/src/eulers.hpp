@@ -24,12 +24,21 @@ public:
   ~AdiabaticIdealEulers() { }
   int ConsToPrim(const double *U, double *P) const;
   int PrimToCons(const double *P, double *U) const;
+  int ConsToPrimBatch(const double *U, double *P, int nzones, int *fail) const;
+  int PrimToConsBatch(const double *P, double *U, int nzones, int *fail) const;
 
   void FluxAndEigenvalues(const double *U,
 			  const double *P, double *F,
 			  double *ap, double *am, int dimension) const;
+  void FluxAndEigenvaluesBatch(const double *U,
+                               const double *P, double *F,
+                               double *ap, double *am, int nzones,
+                               int dimension) const;
   void Eigensystem(const double *U, const double *P,
 		   double *L, double *R, double *lam, int dim) const;
+  void EigensystemBatch(const double *U, const double *P,
+                        double *L, double *R, double *lam, int nzones,
+                        int dim) const;
 
   int GetNq() const { return 5; }
   std::vector<std::string> GetPrimNames() const;
@@ -37,4 +46,20 @@ public:
   std::string PrintCons(const double *P) const;
 } ;
 
+template <> struct FluidBatchCalls<AdiabaticIdealEulers>
+{
+  static int PrimToCons(const AdiabaticIdealEulers &f, const double *P, double *U,
+                        int nzones, int nq, int *fail)
+  {
+    return f.AdiabaticIdealEulers::PrimToConsBatch(P, U, nzones, fail);
+  }
+  static void FluxAndEigenvalues(const AdiabaticIdealEulers &f, const double *U,
+                                 const double *P, double *F,
+                                 double *ap, double *am, int nzones, int nq,
+                                 int dim)
+  {
+    f.AdiabaticIdealEulers::FluxAndEigenvaluesBatch(U, P, F, ap, am, nzones, dim);
+  }
+} ;
+
 #endif // __AdiabaticIdealEulers_HEADER__
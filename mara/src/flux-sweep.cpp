@@ -0,0 +1,278 @@
+/*------------------------------------------------------------------------------
+ * FILE: flux-sweep.cpp
+ *
+ * PURPOSE: Intercell flux sweeps specialized at compile time on the fluid, the
+ *   Riemann solver, the reconstruction method and the number of components.
+ *   The choice is made once by BuildFluxSweep, after which the inner loops
+ *   contain no switches on the reconstruction and no virtual calls into either
+ *   the Riemann solver or the fluid.
+ *
+ *------------------------------------------------------------------------------
+ */
+
+#include "flux-sweep.hpp"
+#include "eulers.hpp"
+#include "srhd.hpp"
+#include "rmhd.hpp"
+#include "advect.hpp"
+#include "riemann_hll.hpp"
+#include "riemann_hllc.hpp"
+#include "riemann_hlld-rmhd.hpp"
+#include "riemann_exact-eulers.hpp"
+#include "weno-kernels.h"
+#include "logging.hpp"
+
+
+static void report_first_order_fallback(int error)
+{
+#pragma omp critical (debuglog)
+  {
+    DebugLog.Warning(__FUNCTION__) << "Reverting to first order at zone interface... ";
+    if (!error) DebugLog.Warning() << "Success!" << std::endl;
+    else        DebugLog.Warning() << "Still failed!" << std::endl;
+  }
+}
+
+
+// -----------------------------------------------------------------------------
+// Reconstruction of the left and right states at the face between the zone at
+// p and the one at p+S, for one component. The kernels are the inline ones of
+// weno.c, applied to the strided stencil in place, with the parameters read
+// once per sweep.
+// -----------------------------------------------------------------------------
+template <int Recon>
+static inline void reconstruct_face(const double *p, int S,
+                                    const ReconstructParams &rp,
+                                    double &l, double &r);
+
+template <>
+inline void reconstruct_face<GodunovOperator::RECONSTRUCT_PCM>
+(const double *p, int S, const ReconstructParams &rp, double &l, double &r)
+{
+  l = p[0];
+  r = p[S];
+}
+template <>
+inline void reconstruct_face<GodunovOperator::RECONSTRUCT_PLM>
+(const double *p, int S, const ReconstructParams &rp, double &l, double &r)
+{
+  l = weno_plm(p  , S, +1.0, rp.plm_theta);
+  r = weno_plm(p+S, S, -1.0, rp.plm_theta);
+}
+template <>
+inline void reconstruct_face<GodunovOperator::RECONSTRUCT_WENO5>
+(const double *p, int S, const ReconstructParams &rp, double &l, double &r)
+{
+  l = weno_weno5(p  , S, CeesC2R_FV, DeesC2R_FV, rp.IS, rp.shenzha10_A);
+  r = weno_weno5(p+S, S, CeesC2L_FV, DeesC2L_FV, rp.IS, rp.shenzha10_A);
+}
+
+
+// -----------------------------------------------------------------------------
+// Calls into a Riemann solver whose type is known at compile time. The call is
+// qualified, so it does not go through the vtable. The HLL solver is generic
+// over the fluid, so it is given the fluid type as well. Solvers without a
+// batch kernel of their own are batched here by looping over the single-face
+// call, which reports its own wavespeed. The index of the first face in the
+// batch is passed along for solvers which keep state on each face, and Prepare
+// is called with the number of zones before the threads start.
+// -----------------------------------------------------------------------------
+template <class Fluid, class Riemann, int NQ>
+struct RiemannCalls
+{
+  static void Prepare(Riemann &riemann, int nzones) { }
+  static int Flux(Riemann &riemann, const Fluid &fluid,
+                  const double *Pl, const double *Pr, double *F, int dim)
+  {
+    return riemann.Riemann::IntercellFlux(Pl, Pr, 0, F, 0.0, dim);
+  }
+  static double FluxBatch(Riemann &riemann, const Fluid &fluid,
+                          const double *Pl, const double *Pr, double *F,
+                          int n0, int n, int dim, int *fail)
+  {
+    for (int k=0; k<n; ++k) {
+      fail[k] = Flux(riemann, fluid, &Pl[k*NQ], &Pr[k*NQ], &F[k*NQ], dim);
+    }
+    return 0.0;
+  }
+} ;
+template <class Fluid, class Riemann, int NQ>
+struct BatchRiemannCalls
+{
+  static void Prepare(Riemann &riemann, int nzones) { }
+  static int Flux(Riemann &riemann, const Fluid &fluid,
+                  const double *Pl, const double *Pr, double *F, int dim)
+  {
+    return riemann.Riemann::IntercellFlux(Pl, Pr, 0, F, 0.0, dim);
+  }
+  static double FluxBatch(Riemann &riemann, const Fluid &fluid,
+                          const double *Pl, const double *Pr, double *F,
+                          int n0, int n, int dim, int *fail)
+  {
+    return riemann.Riemann::IntercellFluxBatch(Pl, Pr, F, n, dim, fail);
+  }
+} ;
+template <class Fluid, int NQ>
+struct RiemannCalls<Fluid, HllRiemannSolver, NQ>
+{
+  static void Prepare(HllRiemannSolver &riemann, int nzones) { }
+  static int Flux(HllRiemannSolver &riemann, const Fluid &fluid,
+                  const double *Pl, const double *Pr, double *F, int dim)
+  {
+    return riemann.IntercellFlux<Fluid, NQ>(fluid, Pl, Pr, 0, F, 0.0, dim);
+  }
+  static double FluxBatch(HllRiemannSolver &riemann, const Fluid &fluid,
+                          const double *Pl, const double *Pr, double *F,
+                          int n0, int n, int dim, int *fail)
+  {
+    return riemann.IntercellFluxBatch<Fluid, NQ>(fluid, Pl, Pr, F, n, dim, fail);
+  }
+} ;
+template <class Fluid, int NQ>
+struct RiemannCalls<Fluid, ExactEulersRiemannSolver, NQ>
+{
+  static void Prepare(ExactEulersRiemannSolver &riemann, int nzones)
+  {
+    riemann.PrepareStarCache(nzones);
+  }
+  static int Flux(ExactEulersRiemannSolver &riemann, const Fluid &fluid,
+                  const double *Pl, const double *Pr, double *F, int dim)
+  {
+    return riemann.ExactEulersRiemannSolver::IntercellFlux(Pl, Pr, 0, F, 0.0,
+                                                           dim);
+  }
+  static double FluxBatch(ExactEulersRiemannSolver &riemann, const Fluid &fluid,
+                          const double *Pl, const double *Pr, double *F,
+                          int n0, int n, int dim, int *fail)
+  {
+    for (int k=0; k<n; ++k) {
+      fail[k] = riemann.IntercellFluxAtFace(&Pl[k*NQ], &Pr[k*NQ], &F[k*NQ],
+                                            dim, n0+k);
+    }
+    return 0.0;
+  }
+} ;
+template <class Fluid, int NQ>
+struct RiemannCalls<Fluid, HllcEulersRiemannSolver, NQ>
+  : BatchRiemannCalls<Fluid, HllcEulersRiemannSolver, NQ> { } ;
+template <class Fluid, int NQ>
+struct RiemannCalls<Fluid, HllcSrhdRiemannSolver, NQ>
+  : BatchRiemannCalls<Fluid, HllcSrhdRiemannSolver, NQ> { } ;
+
+
+template <class Fluid, class Riemann, int Recon, int NQ>
+class FluxSweep : public IntercellFluxSweep
+// -----------------------------------------------------------------------------
+// Equivalent to MethodOfLinesSplit::intercell_flux_sweep, and bit-identical to
+// it, for one combination of fluid, solver and reconstruction. The faces of a
+// run are reconstructed and solved a pencil of BATCH_SIZE at a time.
+// -----------------------------------------------------------------------------
+{
+private:
+  const Fluid &fluid;
+  Riemann &riemann;
+  typedef RiemannCalls<Fluid, Riemann, NQ> Calls;
+
+public:
+  FluxSweep(const Fluid &fluid, Riemann &riemann)
+    : fluid(fluid), riemann(riemann) { }
+
+  void Sweep(const double *P, double *F, const int *stride, int dim,
+             const std::vector<int> &runs)
+  {
+    enum { B = RiemannSolver::BATCH_SIZE };
+    const int S = stride[dim];
+    ReconstructParams rp;
+
+    reconstruct_get_params(&rp);
+    Calls::Prepare(riemann, stride[0]/NQ);
+
+#pragma omp parallel num_threads(GodunovOperator::num_threads)
+    for (size_t r=0; r<runs.size(); r+=2) {
+#pragma omp for schedule(static) nowait
+      for (int n0=runs[r]; n0<runs[r+1]; n0+=B) {
+        const int m = (runs[r+1]-n0 < B) ? runs[r+1]-n0 : B;
+        double Pl[B*NQ], Pr[B*NQ];
+        int fail[B];
+
+        for (int k=0; k<m; ++k) {
+          const int i = (n0+k)*NQ;
+          for (int q=0; q<NQ; ++q) {
+            reconstruct_face<Recon>(&P[i+q], S, rp, Pl[k*NQ+q], Pr[k*NQ+q]);
+          }
+        }
+        const double ml = Calls::FluxBatch(riemann, fluid, Pl, Pr, &F[n0*NQ],
+                                           n0, m, dim, fail);
+        RiemannSolver::UpdateMaxLambda(ml);
+
+        for (int k=0; k<m; ++k) {
+          if (fail[k]) {
+            const int i = (n0+k)*NQ;
+            int error = Calls::Flux(riemann, fluid, &P[i], &P[i+S], &F[i], dim);
+            report_first_order_fallback(error);
+          }
+        }
+      }
+    }
+  }
+} ;
+
+
+template <class Fluid, class Riemann, int NQ>
+static IntercellFluxSweep *build(const FluidEquations &fluid,
+                                 RiemannSolver &riemann,
+                                 GodunovOperator::ReconstructMethod recon)
+{
+  const Fluid &f = static_cast<const Fluid&>(fluid);
+  Riemann &r = static_cast<Riemann&>(riemann);
+
+  switch (recon) {
+  case GodunovOperator::RECONSTRUCT_PCM:
+    return new FluxSweep<Fluid, Riemann, GodunovOperator::RECONSTRUCT_PCM, NQ>(f, r);
+  case GodunovOperator::RECONSTRUCT_PLM:
+    return new FluxSweep<Fluid, Riemann, GodunovOperator::RECONSTRUCT_PLM, NQ>(f, r);
+  case GodunovOperator::RECONSTRUCT_WENO5:
+    return new FluxSweep<Fluid, Riemann, GodunovOperator::RECONSTRUCT_WENO5, NQ>(f, r);
+  }
+  return NULL;
+}
+
+IntercellFluxSweep *BuildFluxSweep(const FluidEquations &fluid,
+                                   RiemannSolver &riemann,
+                                   GodunovOperator::ReconstructMethod recon)
+{
+  typedef AdiabaticIdealEulers Eulers;
+  typedef AdiabaticIdealSrhd Srhd;
+  typedef AdiabaticIdealRmhd Rmhd;
+  typedef ScalarAdvection Advect;
+
+  const std::type_info &F = typeid(fluid);
+  const std::type_info &R = typeid(riemann);
+
+  if (R == typeid(HllRiemannSolver)) {
+    if (F == typeid(Eulers)) return build<Eulers, HllRiemannSolver, 5>(fluid, riemann, recon);
+    if (F == typeid(Srhd  )) return build<Srhd  , HllRiemannSolver, 5>(fluid, riemann, recon);
+    if (F == typeid(Rmhd  )) return build<Rmhd  , HllRiemannSolver, 8>(fluid, riemann, recon);
+    if (F == typeid(Advect)) return build<Advect, HllRiemannSolver, 1>(fluid, riemann, recon);
+  }
+  else if (R == typeid(HllcRiemannSolver)) {
+    HllcRiemannSolver &hllc = static_cast<HllcRiemannSolver&>(riemann);
+    if (F == typeid(Eulers)) {
+      return build<Eulers, HllcEulersRiemannSolver, 5>(fluid, hllc.SolverFor(fluid), recon);
+    }
+    if (F == typeid(Srhd)) {
+      return build<Srhd, HllcSrhdRiemannSolver, 5>(fluid, hllc.SolverFor(fluid), recon);
+    }
+    if (F == typeid(Rmhd)) {
+      return build<Rmhd, HllcRmhdRiemannSolver, 8>(fluid, hllc.SolverFor(fluid), recon);
+    }
+  }
+  else if (R == typeid(HlldRmhdRiemannSolver)) {
+    if (F == typeid(Rmhd)) return build<Rmhd, HlldRmhdRiemannSolver, 8>(fluid, riemann, recon);
+  }
+  else if (R == typeid(ExactEulersRiemannSolver)) {
+    if (F == typeid(Eulers)) return build<Eulers, ExactEulersRiemannSolver, 5>(fluid, riemann, recon);
+  }
+
+  return NULL;
+}
@@ -0,0 +1,32 @@
+
+#ifndef __FluxSweep_HEADER__
+#define __FluxSweep_HEADER__
+
+#include "hydro.hpp"
+
+class IntercellFluxSweep
+// -----------------------------------------------------------------------------
+// Computes the intercell fluxes along one axis of a zone-major primitive array,
+// writing the flux through the right face of zone n to F[n*NQ]. Only the zones
+// in runs are visited, given as ranges [runs[2r], runs[2r+1]) of zone indices.
+// Implementations are compile-time specializations on the fluid, Riemann
+// solver, reconstruction and number of components, and are obtained from
+// BuildFluxSweep.
+// -----------------------------------------------------------------------------
+{
+public:
+  virtual ~IntercellFluxSweep() { }
+  virtual void Sweep(const double *P, double *F, const int *stride, int dim,
+                     const std::vector<int> &runs) = 0;
+} ;
+
+// -----------------------------------------------------------------------------
+// Returns a new sweep specialized for the given fluid, Riemann solver and
+// reconstruction, or NULL if that combination has not been instantiated. The
+// sweep refers to fluid and riemann, which must outlive it.
+// -----------------------------------------------------------------------------
+IntercellFluxSweep *BuildFluxSweep(const FluidEquations &fluid,
+                                   RiemannSolver &riemann,
+                                   GodunovOperator::ReconstructMethod recon);
+
+#endif // __FluxSweep_HEADER__
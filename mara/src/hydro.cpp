@@ -10,9 +10,17 @@
  */
 
 #include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <cmath>
+#include <algorithm>
 #include "mara.hpp"
+#include "profile.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
+#define MAXNQ 8 // Used for static array initialization
 
 MaraApplication *HydroModule::Mara;
 
@@ -28,6 +36,8 @@ MaraApplication::MaraApplication()
   advance  = NULL;
   driving  = NULL;
   cooling  = NULL;
+  timestep = new TimestepController;
+  state    = new StateBuffers;
 }
 
 MaraApplication::~MaraApplication()
@@ -42,6 +52,102 @@ MaraApplication::~MaraApplication()
   if (advance)  delete advance;
   if (driving)  delete driving;
   if (cooling)  delete cooling;
+  if (timestep) delete timestep;
+  if (state)    delete state;
+}
+
+
+
+// -----------------------------------------------------------------------------
+// FluidEquations
+// -----------------------------------------------------------------------------
+// The batched functions operate on nzones contiguous zone-major states. If
+// fail is not NULL, fail[n] is set to 1 for each zone which could not be
+// inverted and 0 otherwise. The return value is the number of failed zones.
+// Fluids with inexpensive kernels override these to hoist the per-zone setup
+// out of the loop; the fallback here calls the single-zone versions.
+// -----------------------------------------------------------------------------
+int FluidEquations::PrimToConsBatch(const double *P, double *U, int nzones,
+                                    int *fail) const
+{
+  const int nq = this->GetNq();
+  int ttl_error = 0;
+
+  for (int n=0; n<nzones; ++n) {
+    const int error = (this->PrimToCons(&P[n*nq], &U[n*nq]) != 0);
+    if (fail) fail[n] = error;
+    ttl_error += error;
+  }
+  return ttl_error;
+}
+int FluidEquations::ConsToPrimBatch(const double *U, double *P, int nzones,
+                                    int *fail) const
+{
+  const int nq = this->GetNq();
+  int ttl_error = 0;
+
+  for (int n=0; n<nzones; ++n) {
+    const int error = (this->ConsToPrim(&U[n*nq], &P[n*nq]) != 0);
+    if (fail) fail[n] = error;
+    ttl_error += error;
+  }
+  return ttl_error;
+}
+void FluidEquations::FluxAndEigenvaluesBatch(const double *U,
+                                             const double *P, double *F,
+                                             double *ap, double *am,
+                                             int nzones, int dim) const
+{
+  const int nq = this->GetNq();
+
+  for (int n=0; n<nzones; ++n) {
+    this->FluxAndEigenvalues(&U[n*nq], &P[n*nq], &F[n*nq],
+                             ap ? &ap[n] : NULL, am ? &am[n] : NULL, dim);
+  }
+}
+void FluidEquations::Eigensystem(const double *U, const double *P,
+                                 double *L, double *R, double *lam, int dim) const
+// -----------------------------------------------------------------------------
+// Fallback for fluids without a characteristic decomposition, which makes the
+// characteristic schemes component-wise. L and R are the identity, and every
+// field travels with the fastest signal speed, with its sign.
+// -----------------------------------------------------------------------------
+{
+  const int nq = this->GetNq();
+  double F[MAXNQ], ap, am;
+
+  this->FluxAndEigenvalues(U, P, F, &ap, &am, dim);
+  const double a = (fabs(ap) > fabs(am)) ? ap : am;
+
+  for (int i=0; i<nq; ++i) {
+    for (int j=0; j<nq; ++j) {
+      L[i*nq + j] = R[i*nq + j] = (i == j);
+    }
+    lam[i] = a;
+  }
+}
+void FluidEquations::EigensystemBatch(const double *U, const double *P,
+                                      double *L, double *R, double *lam,
+                                      int nzones, int dim) const
+// -----------------------------------------------------------------------------
+// Eigensystems of nzones contiguous zone-major states, written one plane per
+// entry: entry m of zone n's L and R is at L[m*nzones + n], and its eigenvalue q
+// at lam[q*nzones + n]. The generic version calls Eigensystem for each zone.
+// -----------------------------------------------------------------------------
+{
+  const int nq = this->GetNq();
+  double Lf[MAXNQ*MAXNQ], Rf[MAXNQ*MAXNQ], lamf[MAXNQ];
+
+  for (int n=0; n<nzones; ++n) {
+    this->Eigensystem(&U[n*nq], &P[n*nq], Lf, Rf, lamf, dim);
+    for (int m=0; m<nq*nq; ++m) {
+      L[m*nzones + n] = Lf[m];
+      R[m*nzones + n] = Rf[m];
+    }
+    for (int q=0; q<nq; ++q) {
+      lam[q*nzones + n] = lamf[q];
+    }
+  }
 }
 
 
@@ -49,15 +155,174 @@ MaraApplication::~MaraApplication()
 // -----------------------------------------------------------------------------
 // RiemannSolver
 // -----------------------------------------------------------------------------
+// Each thread records the largest wavespeed it has seen in its own cache line,
+// and GetMaxLambda reduces over the threads. The maximum does not depend on the
+// order in which faces were visited, so the result is deterministic.
+// -----------------------------------------------------------------------------
+struct PaddedMaxLambda
+{
+  double value;
+  char pad[64 - sizeof(double)];
+} ;
+static PaddedMaxLambda ThreadMaxLambda[MARA_MAX_THREADS];
+
 double RiemannSolver::GetMaxLambda()
 {
-  return MaxLambda;
+  double ml = 0.0;
+  for (int n=0; n<MARA_MAX_THREADS; ++n) {
+    if (ml < ThreadMaxLambda[n].value) ml = ThreadMaxLambda[n].value;
+  }
+  return ml;
 }
 void RiemannSolver::ResetMaxLambda()
 {
-  MaxLambda = 0;
+  for (int n=0; n<MARA_MAX_THREADS; ++n) {
+    ThreadMaxLambda[n].value = 0.0;
+  }
+}
+void RiemannSolver::UpdateMaxLambda(double ml)
+{
+#ifdef _OPENMP
+  double &MaxLambda = ThreadMaxLambda[omp_get_thread_num()].value;
+#else
+  double &MaxLambda = ThreadMaxLambda[0].value;
+#endif
+  if (MaxLambda < ml) MaxLambda = ml;
 }
-double RiemannSolver::MaxLambda;
+struct PaddedStatistics
+{
+  long count[RiemannSolver::NUM_STATISTICS];
+  char pad[64];
+} ;
+static PaddedStatistics ThreadStatistics[MARA_MAX_THREADS];
+
+void RiemannSolver::ResetStatistics()
+{
+  for (int n=0; n<MARA_MAX_THREADS; ++n) {
+    for (int s=0; s<NUM_STATISTICS; ++s) {
+      ThreadStatistics[n].count[s] = 0;
+    }
+  }
+}
+long RiemannSolver::GetStatistic(Statistic s)
+{
+  long count = 0;
+  for (int n=0; n<MARA_MAX_THREADS; ++n) {
+    count += ThreadStatistics[n].count[s];
+  }
+  return count;
+}
+const char *RiemannSolver::StatisticName(Statistic s)
+{
+  switch (s) {
+  case STAT_HLLD            : return "hlld";
+  case STAT_HLLC            : return "hllc";
+  case STAT_HLL             : return "hll";
+  case STAT_HLLD_FAILED     : return "hlld_failed";
+  case STAT_HLLD_ITERATIONS : return "hlld_iterations";
+  case STAT_EXACT           : return "exact";
+  case STAT_EXACT_CACHED    : return "exact_cached";
+  case STAT_EXACT_ITERATIONS: return "exact_iterations";
+  default: return "";
+  }
+}
+void RiemannSolver::CountStatistic(Statistic s, long n)
+{
+#ifdef _OPENMP
+  ThreadStatistics[omp_get_thread_num()].count[s] += n;
+#else
+  ThreadStatistics[0].count[s] += n;
+#endif
+}
+void EquationOfState::TemperatureBatch_p(const double *D, const double *p,
+                                         double *T, int n, int stride,
+                                         bool warm) const
+{
+  for (int i=0; i<n; ++i) {
+    T[i] = Temperature_p(D[i*stride], p[i*stride]);
+  }
+}
+void EquationOfState::TemperatureBatch_u(const double *D, const double *u,
+                                         double *T, int n, int stride,
+                                         bool warm) const
+{
+  for (int i=0; i<n; ++i) {
+    T[i] = Temperature_u(D[i*stride], u[i*stride]);
+  }
+}
+void EquationOfState::Temperatures(const std::valarray<double> &P, int Nq,
+                                   std::valarray<double> &T) const
+// -----------------------------------------------------------------------------
+// Fills T with the temperature of each state in the primitive array P. If T
+// already has one entry per state, as the cache Mara->TemperatureArray does
+// after the first call, those entries are used as the starting guesses.
+// -----------------------------------------------------------------------------
+{
+  const int n = P.size() / Nq;
+  const bool warm = int(T.size()) == n;
+
+  if (!warm) T.resize(n);
+  if (n == 0) return;
+
+  TemperatureBatch_p(&P[0], &P[1], &T[0], n, Nq, warm); // rho=0, pre=1
+}
+struct PaddedOffTable
+{
+  long count[EquationOfState::NUM_OFF_TABLE];
+  char pad[64];
+} ;
+static PaddedOffTable ThreadOffTable[MARA_MAX_THREADS];
+
+void EquationOfState::ResetOffTable()
+{
+  for (int n=0; n<MARA_MAX_THREADS; ++n) {
+    for (int s=0; s<NUM_OFF_TABLE; ++s) {
+      ThreadOffTable[n].count[s] = 0;
+    }
+  }
+}
+long EquationOfState::GetOffTable(OffTable s)
+{
+  long count = 0;
+  for (int n=0; n<MARA_MAX_THREADS; ++n) {
+    count += ThreadOffTable[n].count[s];
+  }
+  return count;
+}
+void EquationOfState::CountOffTable(OffTable s)
+{
+#ifdef _OPENMP
+  ++ThreadOffTable[omp_get_thread_num()].count[s];
+#else
+  ++ThreadOffTable[0].count[s];
+#endif
+}
+double RiemannSolver::IntercellFluxBatch(const double *PL, const double *PR,
+                                         double *F, int n, int dim, int *fail)
+// -----------------------------------------------------------------------------
+// Computes the fluxes through a pencil of n faces, with the left and right
+// states of face k at PL[k*NQ] and PR[k*NQ], into F[k*NQ]. Faces whose states
+// are unphysical have fail[k] set to 1 and their fluxes left unset. Returns the
+// largest wavespeed over the pencil, which the caller reports once with
+// UpdateMaxLambda. This fallback calls IntercellFlux for each face, which
+// reports its own wavespeed, and returns zero.
+// -----------------------------------------------------------------------------
+{
+  const int nq = Mara->fluid->GetNq();
+
+  for (int k=0; k<n; ++k) {
+    fail[k] = (IntercellFlux(&PL[k*nq], &PR[k*nq], 0, &F[k*nq], 0.0, dim) != 0);
+  }
+  return 0.0;
+}
+
+
+
+// -----------------------------------------------------------------------------
+// PhysicalDomain
+// -----------------------------------------------------------------------------
+PhysicalDomain::ExchangeMethod PhysicalDomain::exchange_method =
+  PhysicalDomain::EXCHANGE_DATATYPE;
 
 
 
@@ -68,6 +333,15 @@ GodunovOperator::ReconstructMethod GodunovOperator::reconstruct_method =
   GodunovOperator::RECONSTRUCT_PLM;
 GodunovOperator::FluxSplittingMethod GodunovOperator::fluxsplit_method =
   GodunovOperator::FLUXSPLIT_LOCAL_LAX_FRIEDRICHS;
+GodunovOperator::DataLayout GodunovOperator::data_layout =
+  GodunovOperator::LAYOUT_AOS;
+int GodunovOperator::num_threads = 1;
+int GodunovOperator::repair_failures = 0;
+int GodunovOperator::repair_passes = 4;
+double GodunovOperator::repair_diffusion = 0.5;
+int GodunovOperator::lazy_c2p = 0;
+double GodunovOperator::lazy_tolerance = 0.0;
+int GodunovOperator::lazy_generation = 0;
 
 void GodunovOperator::prepare_integration()
 {
@@ -101,13 +375,38 @@ void GodunovOperator::prepare_integration()
   dz = (x1[3]-x0[3]) / (N[3]-2*N[0]);
 }
 
+void GodunovOperator::thread_tile(int N, int &n0, int &n1)
+// -----------------------------------------------------------------------------
+// Gives the calling thread its contiguous share [n0, n1) of N items. The tiles
+// depend only on the thread count, and every item is computed the same way
+// whichever thread owns it, so results are bit-identical for any thread count.
+// -----------------------------------------------------------------------------
+{
+#ifdef _OPENMP
+  const long t = omp_get_thread_num();
+  const long T = omp_get_num_threads();
+#else
+  const long t = 0;
+  const long T = 1;
+#endif
+  n0 = (N *  t   ) / T;
+  n1 = (N * (t+1)) / T;
+}
+
 int GodunovOperator::PrimToCons(const std::valarray<double> &P, std::valarray<double> &U)
 {
   this->prepare_integration();
   Mara->boundary->ApplyBoundaries(const_cast<std::valarray<double> &>(P));
 
-  for (int i=0; i<stride[0]; i+=NQ) {
-    Mara->fluid->PrimToCons(&P[i], &U[i]);
+  const int Nz = stride[0] / NQ;
+
+#pragma omp parallel num_threads(num_threads)
+  {
+    int n0, n1;
+    thread_tile(Nz, n0, n1);
+    if (n1 > n0) {
+      Mara->fluid->PrimToConsBatch(&P[n0*NQ], &U[n0*NQ], n1-n0, NULL);
+    }
   }
   return 0;
 }
@@ -115,19 +414,271 @@ int GodunovOperator::PrimToCons(const std::valarray<double> &P, std::valarray<do
 int GodunovOperator::ConsToPrim(const std::valarray<double> &U, std::valarray<double> &P)
 {
   this->prepare_integration();
-  if (&P != &Mara->PrimitiveArray) P = Mara->PrimitiveArray; // don't copy it to itself
+  this->begin_seeding(P);
   Mara->boundary->ApplyBoundaries(const_cast<std::valarray<double> &>(U));
 
-  int ttl_error=0;
-
-  for (int i=0; i<stride[0]; i+=NQ) {
-    int error = (Mara->fluid->ConsToPrim(&U[i], &P[i]) != 0);
-    ttl_error += error;
-    Mara->FailureMask[i/NQ] = error;
+  const int Nz = stride[0] / NQ;
+  int ttl_error=0, skipped=0;
+  {
+    Profile::Scope timer(Profile::TIMER_CONS_TO_PRIM);
+    prepare_lazy_c2p();
+
+#pragma omp parallel num_threads(num_threads) reduction(+:ttl_error,skipped)
+    {
+      int n0, n1;
+      thread_tile(Nz, n0, n1);
+      if (n1 > n0) {
+        ttl_error += cons_to_prim_range(U, P, n0, n1, skipped);
+      }
+    }
+    Profile::Count(Profile::COUNT_ZONES_INVERTED, Nz - skipped);
+    Profile::Count(Profile::COUNT_ZONES_SKIPPED, skipped);
   }
+  this->end_seeding(P);
 
   return Mara_mpi_int_sum(ttl_error);
 }
+void GodunovOperator::begin_seeding(std::valarray<double> &P)
+// -----------------------------------------------------------------------------
+// Chooses the primitives the inversion into P starts from: those at the start
+// of the step while it has not yet inverted into PrimitiveArray, or else those
+// in PrimitiveArray if P is another array. They are copied into P a block at a
+// time by cons_to_prim_range, just ahead of inverting it, rather than in a
+// separate pass over the whole state.
+// -----------------------------------------------------------------------------
+{
+  const std::valarray<double> *front = Mara->state->Seed();
+
+  if (front != NULL) {
+    c2p_seed = &(*front)[0];
+  }
+  else if (&P != &Mara->PrimitiveArray) {
+    c2p_seed = &Mara->PrimitiveArray[0];
+  }
+  else {
+    c2p_seed = NULL;
+  }
+  if (c2p_seed != NULL && P.size() != size_t(stride[0])) P.resize(stride[0]);
+}
+void GodunovOperator::end_seeding(const std::valarray<double> &P)
+{
+  c2p_seed = NULL;
+  if (&P == &Mara->PrimitiveArray) Mara->state->Seeded();
+}
+
+void GodunovOperator::interior_runs(int dim, std::vector<int> &runs) const
+// -----------------------------------------------------------------------------
+// For dim=0, lists the zones outside the guard layer. For dim=1,2,3, lists the
+// zones whose right face along dim has a reconstruction stencil, two zones to
+// the left and three to the right, lying entirely outside the guard layer.
+// Those are what may be computed while the guard zones are being exchanged.
+// -----------------------------------------------------------------------------
+{
+  const int Ng = Mara->domain->get_Ng();
+  int lo[4], hi[4];
+
+  for (int d=1; d<=3; ++d) {
+    const int N = stride[d-1] / stride[d];
+    lo[d] = (d <= ND) ? Ng     : 0;
+    hi[d] = (d <= ND) ? N - Ng : N;
+  }
+  if (dim != 0) {
+    lo[dim] += 2;
+    hi[dim] -= 3;
+  }
+
+  runs.clear();
+  if (lo[1] >= hi[1] || lo[2] >= hi[2] || lo[3] >= hi[3]) return;
+
+  const int s1 = stride[1] / NQ;
+  const int s2 = stride[2] / NQ;
+
+  for (int a=lo[1]; a<hi[1]; ++a) {
+    for (int b=lo[2]; b<hi[2]; ++b) {
+      const int n0 = a*s1 + b*s2 + lo[3];
+      const int n1 = a*s1 + b*s2 + hi[3];
+      if (!runs.empty() && runs.back() == n0) {
+        runs.back() = n1;
+      }
+      else {
+        runs.push_back(n0);
+        runs.push_back(n1);
+      }
+    }
+  }
+}
+void GodunovOperator::complement_runs(const std::vector<int> &runs, int n0, int n1,
+                                      std::vector<int> &comp)
+// -----------------------------------------------------------------------------
+// Lists the zones in [n0, n1) which are not in runs.
+// -----------------------------------------------------------------------------
+{
+  comp.clear();
+  int n = n0;
+  for (size_t r=0; r<runs.size(); r+=2) {
+    if (runs[r] > n) {
+      comp.push_back(n);
+      comp.push_back(runs[r]);
+    }
+    n = runs[r+1];
+  }
+  if (n1 > n) {
+    comp.push_back(n);
+    comp.push_back(n1);
+  }
+}
+int GodunovOperator::cons_to_prim_runs(const std::valarray<double> &U,
+                                       std::valarray<double> &P,
+                                       const std::vector<int> &runs)
+{
+  const int Nr = runs.size() / 2;
+  int ttl_error=0, skipped=0, zones=0;
+
+  Profile::Scope timer(Profile::TIMER_CONS_TO_PRIM);
+  for (int r=0; r<Nr; ++r) {
+    zones += runs[2*r+1] - runs[2*r];
+  }
+  prepare_lazy_c2p();
+
+#pragma omp parallel for num_threads(num_threads) reduction(+:ttl_error,skipped) schedule(static)
+  for (int r=0; r<Nr; ++r) {
+    const int n0 = runs[2*r], n1 = runs[2*r+1];
+    ttl_error += cons_to_prim_range(U, P, n0, n1, skipped);
+  }
+  Profile::Count(Profile::COUNT_ZONES_INVERTED, zones - skipped);
+  Profile::Count(Profile::COUNT_ZONES_SKIPPED, skipped);
+  return ttl_error;
+}
+void GodunovOperator::prepare_lazy_c2p()
+// -----------------------------------------------------------------------------
+// Forgets every remembered inversion when the grid size or lazy_generation has
+// changed, or when lazy_c2p is off, so that turning it on starts afresh.
+// -----------------------------------------------------------------------------
+{
+  const size_t Nz = stride[0] / NQ;
+
+  if (!lazy_c2p) {
+    if (!LazyValid.empty()) {
+      LazyU.resize(0);
+      LazySeed.resize(0);
+      LazyP.resize(0);
+      LazyValid.clear();
+    }
+    return;
+  }
+  if (LazyValid.size() != Nz || lazy_seen != lazy_generation) {
+    LazyU.resize(Nz*NQ);
+    LazySeed.resize(Nz*NQ);
+    LazyP.resize(Nz*NQ);
+    LazyValid.assign(Nz, 0);
+    lazy_seen = lazy_generation;
+  }
+}
+bool GodunovOperator::lazy_block_clean(const std::valarray<double> &U,
+                                       const std::valarray<double> &P,
+                                       int n0, int n1) const
+// -----------------------------------------------------------------------------
+// Whether every zone in [n0, n1) is valid and its conserved state differs from
+// the remembered one by no more than lazy_tolerance relative to it. With a
+// tolerance of zero the conserved states must be equal, and so must the
+// primitives in P that the inversion would be seeded with.
+// -----------------------------------------------------------------------------
+{
+  for (int n=n0; n<n1; ++n) {
+    if (!LazyValid[n]) return false;
+  }
+  if (lazy_tolerance == 0.0) {
+    for (int i=n0*NQ; i<n1*NQ; ++i) {
+      if (U[i] != LazyU[i] || P[i] != LazySeed[i]) return false;
+    }
+  }
+  else {
+    for (int i=n0*NQ; i<n1*NQ; ++i) {
+      if (fabs(U[i] - LazyU[i]) > lazy_tolerance * fabs(LazyU[i])) return false;
+    }
+  }
+  return true;
+}
+int GodunovOperator::cons_to_prim_range(const std::valarray<double> &U,
+                                        std::valarray<double> &P,
+                                        int n0, int n1, int &skipped)
+// -----------------------------------------------------------------------------
+// Inverts the zones [n0, n1) with the fluid's batch inversion. With lazy_c2p,
+// the range is taken in blocks aligned to LAZY_BLOCK zones, and a block whose
+// conserved state has not changed since it was last inverted is given the
+// primitives found then instead, and counted in skipped. The ranges of
+// different threads must not overlap. Returns the number of failed zones.
+// When c2p_seed is set, each block of P is first copied from it, and that is
+// what the inversion starts from.
+//
+// With lazy_tolerance zero a block is skipped only if its seed primitives are
+// also unchanged, so the primitives it is given are exactly those its
+// inversion would find again.
+// -----------------------------------------------------------------------------
+{
+  int *fail = &Mara->FailureMask[0];
+
+  if (!lazy_c2p && c2p_seed == NULL) {
+    return Mara->fluid->ConsToPrimBatch(&U[n0*NQ], &P[n0*NQ], n1-n0, &fail[n0]);
+  }
+
+  int ttl_error = 0;
+  int b1;
+  for (int b0=n0; b0<n1; b0=b1) {
+    b1 = std::min((b0/LAZY_BLOCK + 1)*LAZY_BLOCK, n1);
+    const size_t bytes = (b1-b0)*NQ*sizeof(double);
+
+    if (c2p_seed != NULL) {
+      std::memcpy(&P[b0*NQ], &c2p_seed[b0*NQ], bytes);
+    }
+    if (!lazy_c2p) {
+      ttl_error += Mara->fluid->ConsToPrimBatch(&U[b0*NQ], &P[b0*NQ], b1-b0,
+                                                &fail[b0]);
+    }
+    else if (lazy_block_clean(U, P, b0, b1)) {
+      std::memcpy(&P[b0*NQ], &LazyP[b0*NQ], bytes);
+      for (int n=b0; n<b1; ++n) fail[n] = 0;
+      skipped += b1-b0;
+    }
+    else {
+      std::memcpy(&LazySeed[b0*NQ], &P[b0*NQ], bytes);
+      ttl_error += Mara->fluid->ConsToPrimBatch(&U[b0*NQ], &P[b0*NQ], b1-b0,
+                                                &fail[b0]);
+      std::memcpy(&LazyU[b0*NQ], &U[b0*NQ], bytes);
+      std::memcpy(&LazyP[b0*NQ], &P[b0*NQ], bytes);
+      for (int n=b0; n<b1; ++n) LazyValid[n] = (fail[n] == 0);
+    }
+  }
+  return ttl_error;
+}
+void GodunovOperator::begin_cons_to_prim(const std::valarray<double> &U,
+                                         std::valarray<double> &P)
+// -----------------------------------------------------------------------------
+// Split-phase form of ConsToPrim. This begins applying the boundary conditions
+// to U and inverts the zones outside the guard layer while they are applied.
+// The caller may do other work on the interior before calling
+// end_cons_to_prim, which finishes the guard zones and returns what ConsToPrim
+// would have.
+// -----------------------------------------------------------------------------
+{
+  this->prepare_integration();
+  this->begin_seeding(P);
+  Mara->boundary->BeginApplyBoundaries(const_cast<std::valarray<double> &>(U));
+
+  interior_runs(0, overlap_runs);
+  overlap_error = cons_to_prim_runs(U, P, overlap_runs);
+}
+int GodunovOperator::end_cons_to_prim(const std::valarray<double> &U,
+                                      std::valarray<double> &P)
+{
+  Mara->boundary->EndApplyBoundaries(const_cast<std::valarray<double> &>(U));
+
+  complement_runs(overlap_runs, 0, stride[0] / NQ, overlap_shell);
+  overlap_error += cons_to_prim_runs(U, P, overlap_shell);
+  this->end_seeding(P);
+
+  return Mara_mpi_int_sum(overlap_error);
+}
 
 std::valarray<double> GodunovOperator::LaxDiffusion(const std::valarray<double> &U, double r)
 {
@@ -209,4 +760,114 @@ std::valarray<double> GodunovOperator::LaxDiffusion(const std::valarray<double>
   return L;
 }
 
+bool GodunovOperator::zone_is_owned(int n) const
+// -----------------------------------------------------------------------------
+// Whether zone n lies outside the guard layer, so that this rank owns it
+// -----------------------------------------------------------------------------
+{
+  const int Ng = Mara->domain->get_Ng();
+  const int i = n*NQ;
 
+  for (int d=1; d<=ND; ++d) {
+    const int N = stride[d-1] / stride[d];
+    const int c = (i % stride[d-1]) / stride[d];
+    if (c < Ng || c >= N - Ng) return false;
+  }
+  return true;
+}
+int GodunovOperator::RepairFailures(std::valarray<double> &U, std::valarray<double> &P)
+// -----------------------------------------------------------------------------
+// Repairs the zones flagged in FailureMask, rather than having the whole step
+// abandoned on every rank. Each pass diffuses U across the faces of the
+// flagged zones this rank owns, as LaxDiffusion does with r=repair_diffusion,
+// which is first order and conservative, and re-inverts the zones on either
+// side of those faces, which are the only zones whose U changed. Up to
+// repair_passes passes are made. The work is confined to those faces and
+// zones, so that it does not grow with the grid.
+//
+// Only faces between two owned zones are diffused, so that no flux crosses to
+// another rank and each face is diffused by exactly one rank. Once the passes
+// are done the boundary conditions are applied to U, so that the guard zones
+// hold their owners' repaired states before the caller computes fluxes from
+// them, and the guard zones are inverted again. This must therefore be called
+// on all ranks at once, as it is whenever the failures summed over the ranks
+// are not zero. Under constrained transport the magnetic field, the last three
+// conserved quantities, is not diffused, which would need the CT sweep over
+// the whole grid; it is left as it was, with its divergence.
+//
+// Returns the number of zones on this rank which still fail. Those are not
+// reduced over the ranks here, which is left to the caller.
+// -----------------------------------------------------------------------------
+{
+  this->prepare_integration();
+
+  std::valarray<int> &FM = Mara->FailureMask;
+  const int Nz = stride[0] / NQ;
+  const int Nd = Mara->fluid->UsesConstrainedTransport() ? NQ - 3 : NQ;
+  const double c = repair_diffusion * (ND == 1 ? 0.5 : ND == 2 ? 0.25 : 1.0/6.0);
+
+  std::vector<int> failed;
+  for (int n=0; n<Nz; ++n) {
+    if (FM[n] && zone_is_owned(n)) failed.push_back(n);
+  }
+
+  for (int pass=0; pass<repair_passes && !failed.empty(); ++pass) {
+
+    Profile::Count(Profile::COUNT_ZONES_REPAIRED, failed.size());
+
+    // Lists the faces between a failed zone and an owned neighbor, each as
+    // 4*(zone on its left) + (axis), and the zones on either side.
+    // -------------------------------------------------------------------------
+    std::vector<long> faces;
+    std::vector<int> zones(failed);
+    for (size_t m=0; m<failed.size(); ++m) {
+      const int n = failed[m];
+      for (int d=1; d<=ND; ++d) {
+        const int s = stride[d] / NQ;
+        if (zone_is_owned(n-s)) { faces.push_back(4L*(n-s) + d); zones.push_back(n-s); }
+        if (zone_is_owned(n+s)) { faces.push_back(4L*(n  ) + d); zones.push_back(n+s); }
+      }
+    }
+    std::sort(faces.begin(), faces.end());
+    faces.erase(std::unique(faces.begin(), faces.end()), faces.end());
+    std::sort(zones.begin(), zones.end());
+    zones.erase(std::unique(zones.begin(), zones.end()), zones.end());
+
+    // The changes through every face are found from U before any is applied.
+    // -------------------------------------------------------------------------
+    std::vector<double> dU(faces.size()*Nd);
+    for (size_t f=0; f<faces.size(); ++f) {
+      const int l = faces[f] / 4, r = l + stride[faces[f] % 4] / NQ;
+      for (int q=0; q<Nd; ++q) {
+        dU[f*Nd+q] = c*(U[r*NQ+q] - U[l*NQ+q]);
+      }
+    }
+    for (size_t f=0; f<faces.size(); ++f) {
+      const int l = faces[f] / 4, r = l + stride[faces[f] % 4] / NQ;
+      for (int q=0; q<Nd; ++q) {
+        U[l*NQ+q] += dU[f*Nd+q];
+        U[r*NQ+q] -= dU[f*Nd+q];
+      }
+    }
+
+    std::vector<int> runs;
+    for (size_t m=0; m<zones.size(); ++m) {
+      const int n = zones[m];
+      if (!runs.empty() && runs.back() == n) ++runs.back();
+      else { runs.push_back(n); runs.push_back(n+1); }
+    }
+    cons_to_prim_runs(U, P, runs);
+
+    failed.clear();
+    for (size_t m=0; m<zones.size(); ++m) {
+      if (FM[zones[m]]) failed.push_back(zones[m]);
+    }
+  }
+
+  std::vector<int> owned, guard;
+  Mara->boundary->ApplyBoundaries(U);
+  interior_runs(0, owned);
+  complement_runs(owned, 0, Nz, guard);
+
+  return int(failed.size()) + cons_to_prim_runs(U, P, guard);
+}
@@ -20,6 +20,9 @@
 #include <typeinfo>
 
 
+#define MARA_MAX_THREADS 256 // Upper limit on GodunovOperator::num_threads
+
+
 // -----------------------------------------------------------------------------
 // Forward declarations of all classes defined in this header file
 // -----------------------------------------------------------------------------
@@ -35,6 +38,8 @@ class RiemannSolver;
 class GodunovOperator;
 class RungeKuttaIntegration;
 class PhysicalUnits;
+class TimestepController;
+class StateBuffers;
 // -----------------------------------------------------------------------------
 
 
@@ -78,8 +83,11 @@ public:
   RungeKuttaIntegration *advance;
   CoolingModule         *cooling;
   DrivingModule         *driving;
+  TimestepController    *timestep;
+  StateBuffers          *state;
 
   std::valarray<double> PrimitiveArray;
+  std::valarray<double> TemperatureArray; // see EquationOfState::Temperatures
   std::valarray<int> FailureMask;
 } ;
 
@@ -98,6 +106,18 @@ class BoundaryConditions : public HydroModule
 public:
   virtual ~BoundaryConditions() { }
   virtual void ApplyBoundaries(std::valarray<double> &U) const = 0;
+
+  // ---------------------------------------------------------------------------
+  // Split-phase form of ApplyBoundaries. Between the two calls only the guard
+  // zones of U may be read or written by the boundary conditions, so the
+  // caller is free to read the interior. By default all the work is done in
+  // EndApplyBoundaries.
+  // ---------------------------------------------------------------------------
+  virtual void BeginApplyBoundaries(std::valarray<double> &U) const { }
+  virtual void EndApplyBoundaries(std::valarray<double> &U) const
+  {
+    ApplyBoundaries(U);
+  }
 } ;
 class EquationOfState : public HydroModule
 // -----------------------------------------------------------------------------
@@ -114,15 +134,55 @@ public:
   virtual double Temperature_p (double D, double p) const = 0;
   virtual double TemperatureMeV(double D, double p) const = 0;
   virtual double TemperatureArb(double D, double T_MeV) const = 0;
+  virtual double TemperatureArbToMeV(double D, double T) const
+  // The inverse of TemperatureArb, which tables may give without an inversion
+  {
+    return TemperatureMeV(D, Pressure(D, T));
+  }
+
+  // Inverts n states at once for the temperature, reading D and p (or u) from
+  // every stride'th double. With warm, T holds a guess for each state on entry,
+  // such as its temperature on the last step; it holds the result on exit.
+  // ---------------------------------------------------------------------------
+  virtual void TemperatureBatch_p(const double *D, const double *p, double *T,
+                                  int n, int stride, bool warm) const;
+  virtual void TemperatureBatch_u(const double *D, const double *u, double *T,
+                                  int n, int stride, bool warm) const;
+  void Temperatures(const std::valarray<double> &P, int Nq,
+                    std::valarray<double> &T) const;
 
   virtual double Derivatives_u(double D, double T, double *J) const = 0;
   virtual double Derivatives_p(double D, double T, double *J) const = 0;
+  virtual void Derivatives_pu(double D, double T, double *p, double *u,
+                              double *Jp, double *Ju) const
+  // Both of the above at once, for tables which can share the lookup
+  {
+    *p = Derivatives_p(D, T, Jp);
+    *u = Derivatives_u(D, T, Ju);
+  }
 
   virtual double DensLower() const { return 0.0; } // returns lower/upper bound on D in code units
   virtual double DensUpper() const { return 0.0; }
 
   virtual double TempLower() const { return 0.0; } // returns lower/upper bound on T in code units
   virtual double TempUpper() const { return 0.0; }
+
+  // Tabulated equations of state sample states off their table approximately.
+  // Each such sample is counted on the thread that made it, in its own cache
+  // line, and the counts are summed by GetOffTable, so that they may be
+  // reported once per step rather than when they happen. Only those for which
+  // IsTabulated is true count any.
+  // ---------------------------------------------------------------------------
+  virtual bool IsTabulated() const { return false; }
+  enum OffTable {
+    OFF_TABLE_DENSITY,     // samples with the density off the table
+    OFF_TABLE_TEMPERATURE, // samples with only the temperature off the table
+    OFF_TABLE_INVERSE,     // inversions for T which could not be bracketed
+    NUM_OFF_TABLE
+  } ;
+  static void ResetOffTable();
+  static long GetOffTable(OffTable s);
+  static void CountOffTable(OffTable s);
 } ;
 class FluidEquations : public HydroModule
 // -----------------------------------------------------------------------------
@@ -131,15 +191,27 @@ public:
   virtual ~FluidEquations() { }
   virtual int PrimToCons(const double *P, double *U) const = 0;
   virtual int ConsToPrim(const double *U, double *P) const = 0;
+  virtual int PrimToConsBatch(const double *P, double *U, int nzones,
+                              int *fail) const;
+  virtual int ConsToPrimBatch(const double *U, double *P, int nzones,
+                              int *fail) const;
   virtual void FluxAndEigenvalues(const double *U,
                                   const double *P, double *F,
                                   double *ap, double *am, int dim) const = 0;
+  virtual void FluxAndEigenvaluesBatch(const double *U,
+                                       const double *P, double *F,
+                                       double *ap, double *am, int nzones,
+                                       int dim) const;
   virtual void Eigensystem(const double *U, const double *P,
-                           double *L, double *R, double *lam, int dim) const { }
+                           double *L, double *R, double *lam, int dim) const;
+  virtual void EigensystemBatch(const double *U, const double *P,
+                                double *L, double *R, double *lam, int nzones,
+                                int dim) const;
   virtual void ConstrainedTransport2d(double *Fx, double *Fy,
                                       int stride[4]) const { }
   virtual void ConstrainedTransport3d(double *Fx, double *Fy, double *Fz,
                                       int stride[4]) const { }
+  virtual bool UsesConstrainedTransport() const { return false; }
   virtual std::vector<std::string> GetPrimNames() const = 0;
   virtual int GetNq() const = 0;
   virtual std::string PrintPrim(const double *P) const { return ""; }
@@ -147,6 +219,82 @@ public:
   virtual int PrimCheck(const double *P) const { return 0; }
   virtual int ConsCheck(const double *U) const { return 0; }
 } ;
+template <class Fluid> struct FluidCalls
+// -----------------------------------------------------------------------------
+// Calls into a fluid whose type is known at compile time. Calls are qualified,
+// so they bypass the vtable and may be inlined. The FluidEquations
+// specialization below dispatches virtually, for code that must work with any
+// fluid.
+// -----------------------------------------------------------------------------
+{
+  static int PrimToCons(const Fluid &f, const double *P, double *U)
+  {
+    return f.Fluid::PrimToCons(P, U);
+  }
+  static void FluxAndEigenvalues(const Fluid &f, const double *U,
+                                 const double *P, double *F,
+                                 double *ap, double *am, int dim)
+  {
+    f.Fluid::FluxAndEigenvalues(U, P, F, ap, am, dim);
+  }
+} ;
+template <> struct FluidCalls<FluidEquations>
+{
+  static int PrimToCons(const FluidEquations &f, const double *P, double *U)
+  {
+    return f.PrimToCons(P, U);
+  }
+  static void FluxAndEigenvalues(const FluidEquations &f, const double *U,
+                                 const double *P, double *F,
+                                 double *ap, double *am, int dim)
+  {
+    f.FluxAndEigenvalues(U, P, F, ap, am, dim);
+  }
+} ;
+template <class Fluid> struct FluidBatchCalls
+// -----------------------------------------------------------------------------
+// Batched counterparts of FluidCalls, over nzones contiguous zone-major states.
+// The generic version loops over the inlined single-zone calls. Fluids with
+// vectorizable batch kernels specialize it in their own header, and the
+// FluidEquations specialization calls the virtual batch functions.
+// -----------------------------------------------------------------------------
+{
+  static int PrimToCons(const Fluid &f, const double *P, double *U,
+                        int nzones, int nq, int *fail)
+  {
+    int ttl_error = 0;
+    for (int n=0; n<nzones; ++n) {
+      fail[n] = (FluidCalls<Fluid>::PrimToCons(f, &P[n*nq], &U[n*nq]) != 0);
+      ttl_error += fail[n];
+    }
+    return ttl_error;
+  }
+  static void FluxAndEigenvalues(const Fluid &f, const double *U,
+                                 const double *P, double *F,
+                                 double *ap, double *am, int nzones, int nq,
+                                 int dim)
+  {
+    for (int n=0; n<nzones; ++n) {
+      FluidCalls<Fluid>::FluxAndEigenvalues(f, &U[n*nq], &P[n*nq], &F[n*nq],
+                                            &ap[n], &am[n], dim);
+    }
+  }
+} ;
+template <> struct FluidBatchCalls<FluidEquations>
+{
+  static int PrimToCons(const FluidEquations &f, const double *P, double *U,
+                        int nzones, int nq, int *fail)
+  {
+    return f.PrimToConsBatch(P, U, nzones, fail);
+  }
+  static void FluxAndEigenvalues(const FluidEquations &f, const double *U,
+                                 const double *P, double *F,
+                                 double *ap, double *am, int nzones, int nq,
+                                 int dim)
+  {
+    f.FluxAndEigenvaluesBatch(U, P, F, ap, am, nzones, dim);
+  }
+} ;
 class PhysicalDomain : public HydroModule
 // -----------------------------------------------------------------------------
 {
@@ -161,6 +309,11 @@ public:
     int  n_dims;
     int  n_prim;
   } ;
+  enum ExchangeMethod {
+    EXCHANGE_DATATYPE,   // MPI subarray types sent directly from the array
+    EXCHANGE_PERSISTENT  // persistent requests on packed, contiguous buffers
+  } ;
+  static ExchangeMethod exchange_method;
 protected:
   SubdomainSpecs Specs;
 public:
@@ -179,6 +332,16 @@ public:
   virtual std::vector<double> get_x1() const = 0;
   virtual std::vector<int> aug_shape() const = 0; // including guard
   virtual void Synchronize(std::valarray<double> &U) const = 0;
+
+  // ---------------------------------------------------------------------------
+  // Split-phase form of Synchronize: BeginSynchronize starts filling the guard
+  // zones of U, and EndSynchronize waits until they are filled. The interior of
+  // U must not be modified, nor its guard zones read, in between. Several
+  // arrays may be in flight at once, provided every subgrid begins them in the
+  // same order. By default all the work is done in EndSynchronize.
+  // ---------------------------------------------------------------------------
+  virtual void BeginSynchronize(std::valarray<double> &U) const { }
+  virtual void EndSynchronize(std::valarray<double> &U) const { Synchronize(U); }
   virtual int SubgridRank() const = 0;
   virtual int SubgridSize() const = 0;
   virtual int GetNumberOfZones() const = 0; // including guard
@@ -199,14 +362,37 @@ public:
 class RiemannSolver : public HydroModule
 // -----------------------------------------------------------------------------
 {
-protected:
-  static double MaxLambda;
 public:
+  enum { BATCH_SIZE = 64 }; // faces per pencil passed to IntercellFluxBatch
+
+  // ---------------------------------------------------------------------------
+  // Counts of the work done by the solvers, kept by each thread in its own
+  // cache line and summed by GetStatistic.
+  // ---------------------------------------------------------------------------
+  enum Statistic {
+    STAT_HLLD,             // faces given to HLLD
+    STAT_HLLC,             // faces sent to HLLC by the HLLD jump indicator
+    STAT_HLL,              // faces sent to HLL by the HLLD jump indicator
+    STAT_HLLD_FAILED,      // faces on which HLLD failed and reverted to HLLC
+    STAT_HLLD_ITERATIONS,  // Newton-Raphson iterations taken by HLLD
+    STAT_EXACT,            // faces given to the exact solver
+    STAT_EXACT_CACHED,     // of those, started from a cached star pressure
+    STAT_EXACT_ITERATIONS, // Newton-Raphson iterations taken by the exact solver
+    NUM_STATISTICS
+  } ;
+
   virtual ~RiemannSolver() { }
   static double GetMaxLambda();
   static void ResetMaxLambda();
+  static void UpdateMaxLambda(double ml);
+  static void ResetStatistics();
+  static long GetStatistic(Statistic s);
+  static const char *StatisticName(Statistic s);
+  static void CountStatistic(Statistic s, long n=1);
   virtual int IntercellFlux(const double *pl, const double *pr, double *U,
                             double *F, double s, int dim) = 0;
+  virtual double IntercellFluxBatch(const double *PL, const double *PR,
+                                    double *F, int n, int dim, int *fail);
 } ;
 class GodunovOperator : public HydroModule
 // -----------------------------------------------------------------------------
@@ -221,9 +407,23 @@ public:
 			   RECONSTRUCT_WENO5 } ;
   enum FluxSplittingMethod { FLUXSPLIT_LOCAL_LAX_FRIEDRICHS,
 			     FLUXSPLIT_MARQUINA };
+  // Layout of the work arrays of the MethodOfLinesSplit sweeps only. With
+  // LAYOUT_SOA the primitives are transposed into aligned planes once per
+  // stage; PrimitiveArray, the conserved state, the other operators, the
+  // boundaries and the I/O stay zone-major in either case.
+  enum DataLayout { LAYOUT_AOS,   // zone-major, as stored in PrimitiveArray
+		    LAYOUT_SOA }; // one aligned plane per primitive
 
   static ReconstructMethod reconstruct_method;
   static FluxSplittingMethod fluxsplit_method;
+  static DataLayout data_layout;
+  static int num_threads;
+  static int repair_failures;     // repair failed zones in place, see RepairFailures
+  static int repair_passes;
+  static double repair_diffusion;
+  static int lazy_c2p;            // skip inverting unchanged blocks, see cons_to_prim_range
+  static double lazy_tolerance;
+  static int lazy_generation;     // bumped when the fluid, eos, units or domain change
 
   class ConsToPrimFailure : public std::exception
   {
@@ -241,27 +441,73 @@ public:
       return "The integration failed on an intermediate step.";
     }
   } ;
+  GodunovOperator() : lazy_seen(-1), c2p_seed(NULL) { }
   virtual ~GodunovOperator() { }
-  virtual std::valarray<double> dUdt(const std::valarray<double> &Uin) = 0;
+  virtual void dUdt(std::valarray<double> &Uin, std::valarray<double> &L) = 0;
   virtual std::valarray<double> LaxDiffusion(const std::valarray<double> &U, double r);
   virtual int PrimToCons(const std::valarray<double> &P, std::valarray<double> &U);
   virtual int ConsToPrim(const std::valarray<double> &U, std::valarray<double> &P);
+  int RepairFailures(std::valarray<double> &U, std::valarray<double> &P);
   virtual void SetTimeStepDt(double dt) { };
   virtual void SetPlmTheta(double plm) { }
   virtual void SetSafetyLevel(int level) { }
+
+  // ---------------------------------------------------------------------------
+  // Whether the guard zones at the edges and corners of the subgrid, those
+  // lying outside the interior along more than one axis, must hold the values
+  // of the neighboring subgrids. Operators which only read the guard zones
+  // along one axis at a time return false, which lets the domain exchange
+  // with its face neighbors alone.
+  // ---------------------------------------------------------------------------
+  virtual bool NeedsCornerGuards() const { return true; }
   const int *GetStride() const { return stride; }
   int GetNq() const { return NQ; }
   int GetNd() const { return ND; }
 
 protected:
   void prepare_integration();
+  static void thread_tile(int N, int &n0, int &n1);
+  bool zone_is_owned(int n) const;
+
+  // ---------------------------------------------------------------------------
+  // Support for overlapping the guard zone exchange with work on the interior.
+  // Sets of zones are given as contiguous runs [runs[2r], runs[2r+1]) of zone
+  // indices, in increasing order.
+  // ---------------------------------------------------------------------------
+  std::vector<int> overlap_runs, overlap_shell;
+  int overlap_error;
+  void interior_runs(int dim, std::vector<int> &runs) const;
+  static void complement_runs(const std::vector<int> &runs, int n0, int n1,
+                              std::vector<int> &comp);
+  int cons_to_prim_runs(const std::valarray<double> &U, std::valarray<double> &P,
+                        const std::vector<int> &runs);
+  void begin_cons_to_prim(const std::valarray<double> &U, std::valarray<double> &P);
+  int end_cons_to_prim(const std::valarray<double> &U, std::valarray<double> &P);
+
+  // ---------------------------------------------------------------------------
+  // The conserved states each zone was last inverted from, the primitives it
+  // was seeded with and those found, for lazy_c2p. A zone is valid if its
+  // inversion succeeded and lazy_generation is the same as then.
+  // ---------------------------------------------------------------------------
+  enum { LAZY_BLOCK = 64 }; // zones per block tested for changes
+  std::valarray<double> LazyU, LazySeed, LazyP;
+  std::vector<char> LazyValid;
+  int lazy_seen;
+  const double *c2p_seed; // copied into P ahead of each block, if not NULL
+  void begin_seeding(std::valarray<double> &P);
+  void end_seeding(const std::valarray<double> &P);
+  void prepare_lazy_c2p();
+  bool lazy_block_clean(const std::valarray<double> &U,
+                        const std::valarray<double> &P, int n0, int n1) const;
+  int cons_to_prim_range(const std::valarray<double> &U, std::valarray<double> &P,
+                         int n0, int n1, int &skipped);
 } ;
 class RungeKuttaIntegration : public HydroModule
 // -----------------------------------------------------------------------------
 {
 public:
   virtual ~RungeKuttaIntegration() { }
-  virtual void AdvanceState(std::valarray<double> &U, double dt) const = 0;
+  virtual void AdvanceState(std::valarray<double> &U, double dt) = 0;
 } ;
 class StochasticVectorField
 {
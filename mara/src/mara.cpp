@@ -78,6 +78,7 @@ extern "C"
 
   static int luaC_new_ou_field(lua_State *L);
   static int luaC_load_shen(lua_State *L);
+  static int luaC_convert_shen(lua_State *L);
   static int luaC_test_shen(lua_State *L);
   static int luaC_test_rmhd_c2p(lua_State *L);
   static int luaC_test_sampling(lua_State *L);
@@ -90,6 +91,15 @@ extern "C"
 
   static int luaC_boundary_ApplyBoundaries(lua_State *L);
 
+  static int luaC_profile_report(lua_State *L);
+  static int luaC_profile_reset(lua_State *L);
+  static int luaC_profile_clock(lua_State *L);
+
+  static int luaC_riemann_stats(lua_State *L);
+
+  static int luaC_timestep_history(lua_State *L);
+  static int luaC_timestep_reset(lua_State *L);
+
   static int luaC_driving_Advance(lua_State *L);
   static int luaC_driving_Resample(lua_State *L);
   static int luaC_driving_Serialize(lua_State *L);
@@ -292,6 +302,7 @@ int main(int argc, char **argv)
   lua_register(L, "cooling_rate" , luaC_cooling_rate);
   lua_register(L, "new_ou_field" , luaC_new_ou_field);
   lua_register(L, "load_shen"    , luaC_load_shen);
+  lua_register(L, "convert_shen" , luaC_convert_shen);
   lua_register(L, "test_shen"    , luaC_test_shen);
   lua_register(L, "test_rmhd_c2p", luaC_test_rmhd_c2p);
   lua_register(L, "test_sampling", luaC_test_sampling);
@@ -332,6 +343,51 @@ int main(int argc, char **argv)
   lua_setglobal(L, "boundary");
 
 
+  // Expose the profiling interface
+  // ---------------------------------------------------------------------------
+  lua_newtable(L);
+
+  lua_pushstring(L, "report");
+  lua_pushcfunction(L, luaC_profile_report);
+  lua_settable(L, 1);
+
+  lua_pushstring(L, "reset");
+  lua_pushcfunction(L, luaC_profile_reset);
+  lua_settable(L, 1);
+
+  lua_pushstring(L, "clock");
+  lua_pushcfunction(L, luaC_profile_clock);
+  lua_settable(L, 1);
+
+  lua_setglobal(L, "profile");
+
+
+  // Expose the Riemann solver statistics
+  // ---------------------------------------------------------------------------
+  lua_newtable(L);
+
+  lua_pushstring(L, "stats");
+  lua_pushcfunction(L, luaC_riemann_stats);
+  lua_settable(L, 1);
+
+  lua_setglobal(L, "riemann");
+
+
+  // Expose the time step history
+  // ---------------------------------------------------------------------------
+  lua_newtable(L);
+
+  lua_pushstring(L, "history");
+  lua_pushcfunction(L, luaC_timestep_history);
+  lua_settable(L, 1);
+
+  lua_pushstring(L, "reset");
+  lua_pushcfunction(L, luaC_timestep_reset);
+  lua_settable(L, 1);
+
+  lua_setglobal(L, "timestep");
+
+
   // Expose the eos interface
   // ---------------------------------------------------------------------------
   lua_newtable(L);
@@ -504,38 +560,81 @@ int main(int argc, char **argv)
 
 
 int luaC_advance(lua_State *L)
+// -----------------------------------------------------------------------------
+// Returns the rate in kilo-zones per second, the number of failed zones, and
+// whether the step was accepted by the time step controller, and the dt it was
+// taken with. A rejected step is rolled back and, up to max_retries times,
+// tried again with dt reduced by the controller's shrink factor. The state is
+// only updated by an accepted step. Samples of a tabulated EOS off its table
+// are reported once, summed over the step and the ranks.
+// -----------------------------------------------------------------------------
 {
-  const clock_t start = clock();
-  const double dt = luaL_checknumber(L, 1);
+  const double start = Profile::Clock();
+  double dt = luaL_checknumber(L, 1);
+  Profile::Scope timer(Profile::TIMER_ADVANCE);
+  Profile::Count(Profile::COUNT_STEPS);
 
-  std::valarray<double> P = Mara->PrimitiveArray;
-  std::valarray<double> U(P.size());
-  int errors;
+  std::valarray<double> &P = Mara->PrimitiveArray;
+  std::valarray<double> &U = Mara->state->Conserved();
+  int errors = 0;
+  bool accepted = false;
 
-  RiemannSolver::ResetMaxLambda();
+  RiemannSolver::ResetStatistics();
+  EquationOfState::ResetOffTable();
   Mara->FailureMask.resize(Mara->domain->GetNumberOfZones());
-  Mara->godunov->PrimToCons(P, U);
 
-  try {
-    Mara->advance->AdvanceState(U, dt);
-    errors = Mara->godunov->ConsToPrim(U, P);
-  }
-  catch (const GodunovOperator::IntermediateFailure &e) {
-    errors = Mara_mpi_int_sum(Mara->FailureMask.sum());
+  for (int attempt=0; attempt<=TimestepController::max_retries; ++attempt) {
+
+    if (attempt > 0) dt *= TimestepController::shrink;
+
+    Mara->timestep->BeginStep(dt);
+    Mara->state->Save();
+    Mara->godunov->PrimToCons(Mara->state->Front(), U);
+
+    try {
+      Mara->advance->AdvanceState(U, dt);
+      errors = Mara->godunov->ConsToPrim(U, P);
+      if (errors && GodunovOperator::repair_failures) {
+        errors = Mara_mpi_int_sum(Mara->godunov->RepairFailures(U, P));
+      }
+    }
+    catch (const GodunovOperator::IntermediateFailure &e) {
+      errors = Mara_mpi_int_sum(Mara->FailureMask.sum());
+    }
+
+    accepted = Mara->timestep->EndStep(errors);
+    if (accepted) break;
+
+    Mara->state->Restore();
   }
 
-  if (errors == 0) {
+  if (accepted) {
     if (Mara->driving) Mara->driving->Drive(P, dt);
     if (Mara->cooling) Mara->cooling->Cool(P, dt);
-    Mara->PrimitiveArray = P;
   }
 
-  const double sec = (double) (clock() - start) / CLOCKS_PER_SEC;
+  if (Mara->eos && Mara->eos->IsTabulated()) {
+    long off[3] = {
+      EquationOfState::GetOffTable(EquationOfState::OFF_TABLE_DENSITY),
+      EquationOfState::GetOffTable(EquationOfState::OFF_TABLE_TEMPERATURE),
+      EquationOfState::GetOffTable(EquationOfState::OFF_TABLE_INVERSE) };
+    Profile::Count(Profile::COUNT_EOS_OFF_TABLE, off[0] + off[1] + off[2]);
+
+    Mara_mpi_long_sum_n(off, 3);
+    if (off[0] + off[1] + off[2] > 0 && Mara_mpi_get_rank() == 0) {
+      printf("[eos] warning: used approximate EOS off the table for %ld density, "
+             "%ld temperature samples and %ld inversions\n", off[0], off[1], off[2]);
+    }
+  }
+
+  const double sec = Profile::Clock() - start;
 
   lua_pushnumber(L, 1e-3*Mara->domain->GetNumberOfZones()/sec);
   lua_pushnumber(L, errors);
+  lua_pushboolean(L, accepted);
+  lua_pushnumber(L, dt);
 
-  return 2;
+  return 4;
 }
 
 int luaC_diffuse(lua_State *L)
@@ -553,10 +652,13 @@ int luaC_diffuse(lua_State *L)
 }
 
 int luaC_get_timestep(lua_State *L)
+// -----------------------------------------------------------------------------
+// Returns the time step proposed by the controller for the given CFL number,
+// from the wavespeeds of the last call to advance. See TimestepController.
+// -----------------------------------------------------------------------------
 {
   const double CFL = luaL_checknumber(L, 1);
-  const double dt = Mara_mpi_dbl_min(CFL*Mara->domain->get_min_dx() /
-                                     RiemannSolver::GetMaxLambda());
+  const double dt = Mara->timestep->NextTimestep(CFL);
   lua_pushnumber(L, dt);
 
   return 1;
@@ -659,6 +761,21 @@ EquationOfState *BuildShenTabulatedNuclearEos(lua_State *L)
   int N;
   TabulatedEos tab;
 
+  // set_eos("shen", fname) maps a binary table written by convert_shen
+  // ---------------------------------------------------------------------------
+  if (lua_type(L, 2) == LUA_TSTRING) {
+    const char *fname = lua_tostring(L, 2);
+    char msg[256];
+    try {
+      return new ShenTabulatedNuclearEos(fname);
+    }
+    catch (const ShenTabulatedNuclearEos::UnableToLoadTable &e) {
+      snprintf(msg, sizeof(msg), "%s", e.what());
+    }
+    // luaL_error does not return, so it is not called while e is in flight
+    luaL_error(L, "%s (%s)", msg, fname);
+  }
+
   lua_pushstring(L, "logD_values");
   lua_gettable(L, -2);
   double *logD_values = luaU_checklarray(L, -1, &N);
@@ -689,7 +806,7 @@ EquationOfState *BuildShenTabulatedNuclearEos(lua_State *L)
   lua_pop(L, 1);
   tab.EOS_u.assign(EOS_u, EOS_u+N);
 
-  return new ShenTabulatedNuclearEos(tab);
+  return new ShenTabulatedNuclearEos(tab, EosTableStorage::node_shared);
 }
 
 EquationOfState *BuildGenericTabulatedEos(lua_State *L)
@@ -722,7 +839,8 @@ EquationOfState *BuildGenericTabulatedEos(lua_State *L)
   std::vector<double> EOS_c(tmp, tmp + N);
   lua_pop(L, 1);
 
-  return new GenericTabulatedEos(D_values, T_values, EOS_p, EOS_u, EOS_c);
+  return new GenericTabulatedEos(D_values, T_values, EOS_p, EOS_u, EOS_c,
+                                 EosTableStorage::node_shared);
 }
 
 
@@ -1027,6 +1145,7 @@ int luaC_read_prim(lua_State *L)
   return 1;
 }
 int luaC_write_prim(lua_State *L) {
+  Profile::Scope timer(Profile::TIMER_OUTPUT);
   clock_t start = clock();
   mara_prim_io(L, 'w');
   lua_pushnumber(L, (double) (clock() - start) / CLOCKS_PER_SEC);
@@ -1150,6 +1269,7 @@ int luaC_set_domain(lua_State *L)
   if (new_f) {
     if (Mara->domain) delete Mara->domain;
     Mara->domain = new_f;
+    ++GodunovOperator::lazy_generation;
   }
 
   return 0;
@@ -1198,6 +1318,7 @@ int luaC_set_fluid(lua_State *L)
   if (new_f) {
     if (Mara->fluid) delete Mara->fluid;
     Mara->fluid = new_f;
+    ++GodunovOperator::lazy_generation;
   }
 
   return 0;
@@ -1228,6 +1349,8 @@ int luaC_set_eos(lua_State *L)
   if (new_f) {
     if (Mara->eos) delete Mara->eos;
     Mara->eos = new_f;
+    Mara->TemperatureArray.resize(0); // its temperatures were in the old units
+    ++GodunovOperator::lazy_generation;
   }
 
   return 0;
@@ -1246,6 +1369,7 @@ int luaC_set_units(lua_State *L)
   if (new_f) {
     if (Mara->units) delete Mara->units;
     Mara->units = new_f;
+    ++GodunovOperator::lazy_generation;
   }
   return 0;
 }
@@ -1293,6 +1417,12 @@ int luaC_set_riemann(lua_State *L)
   else if (strcmp(key, "hlld") == 0) {
     new_f = new HlldRmhdRiemannSolver;
   }
+  else if (strcmp(key, "exact") == 0) {
+    if (dynamic_cast<const AdiabaticIdealEulers*>(Mara->fluid) == NULL) {
+      luaL_error(L, "the exact solver needs the euler fluid to be set first");
+    }
+    new_f = new ExactEulersRiemannSolver;
+  }
 
   if (new_f) {
     if (Mara->riemann) delete Mara->riemann;
@@ -1348,6 +1478,23 @@ int luaC_config_solver(lua_State *L)
 // theta  (number) : must be [0,2]            ... theta value for PLM/minmod
 // IS     (string) : one of [js96, b08, sz10] ... smoothness indicator
 // sz10A  (number) : should be in [0,100]     ... used by sz10 (see weno.c)
+// layout (string) : one of [aos, soa]         ... plm-split sweep work arrays only
+// threads (number): must be [1,MARA_MAX_THREADS] ... OpenMP threads in sweeps
+// exchange (string): one of [datatype, persistent] ... guard zone messaging
+// hlld_hll (number): jump below which HLLD hands faces to HLL
+// hlld_hllc (number): jump below which HLLD hands faces to HLLC
+// exact_cache (bool): start the exact solver from the last p* on each face
+//                    (compiled plm-split sweeps only)
+// dt_growth (number): largest ratio of consecutive steps, 0 for no limit
+// dt_shrink (number): ratio of a retried step to the rejected one, see retries
+// dt_reject (number): reject steps over this multiple of the CFL bound, or 0
+// retries (number): times advance retries a rejected step at a smaller dt
+// dt_history (number): attempts kept for timestep.history, 0 for none
+// repair (bool): diffuse failed zones locally instead of failing the step
+// repair_diffusion (number): r of the diffusion used by repair, in (0,1]
+// lazy_c2p (bool): skip inverting blocks whose conserved state is unchanged
+// lazy_tolerance (number): relative change under which a block is unchanged
+// shared_tables (bool): tabulated EOS set afterwards hold one copy per node
 //
 // A second positional argument, quiet (bool) may be provided.
 // -----------------------------------------------------------------------------
@@ -1355,6 +1502,8 @@ int luaC_config_solver(lua_State *L)
   typedef std::map<std::string, GodunovOperator::FluxSplittingMethod> FSmap;
   typedef std::map<std::string, GodunovOperator::ReconstructMethod> RMmap;
   typedef std::map<std::string, SmoothnessIndicator> ISmap;
+  typedef std::map<std::string, GodunovOperator::DataLayout> DLmap;
+  typedef std::map<std::string, PhysicalDomain::ExchangeMethod> EXmap;
   luaL_checktype(L, 1, LUA_TTABLE);
 
   int quiet = 0;
@@ -1376,6 +1525,14 @@ int luaC_config_solver(lua_State *L)
   ISmodes["b08"] = ImprovedBorges08;
   ISmodes["sz10"] = ImprovedShenZha10;
 
+  DLmap DLmodes;
+  DLmodes["aos"] = GodunovOperator::LAYOUT_AOS;
+  DLmodes["soa"] = GodunovOperator::LAYOUT_SOA;
+
+  EXmap EXmodes;
+  EXmodes["datatype"] = PhysicalDomain::EXCHANGE_DATATYPE;
+  EXmodes["persistent"] = PhysicalDomain::EXCHANGE_PERSISTENT;
+
   lua_getfield(L, 1, "fsplit");
   if (lua_isstring(L, -1)) {
     const char *key = lua_tostring(L, -1);
@@ -1437,6 +1594,169 @@ int luaC_config_solver(lua_State *L)
   }
   lua_pop(L, 1);
 
+  lua_getfield(L, 1, "layout");
+  if (lua_isstring(L, -1)) {
+    const char *key = lua_tostring(L, -1);
+    DLmap::iterator it = DLmodes.find(key);
+    if (it != DLmodes.end()) {
+      if (!quiet) printf("[config] setting layout=%s\n", it->first.c_str());
+      GodunovOperator::data_layout = it->second;
+    }
+    else {
+      luaL_error(L, "no such layout: %s", key);
+    }
+  }
+  lua_pop(L, 1);
+
+  lua_getfield(L, 1, "exchange");
+  if (lua_isstring(L, -1)) {
+    const char *key = lua_tostring(L, -1);
+    EXmap::iterator it = EXmodes.find(key);
+    if (it != EXmodes.end()) {
+      if (!quiet) printf("[config] setting exchange=%s\n", it->first.c_str());
+      PhysicalDomain::exchange_method = it->second;
+    }
+    else {
+      luaL_error(L, "no such exchange: %s", key);
+    }
+  }
+  lua_pop(L, 1);
+
+  lua_getfield(L, 1, "hlld_hll");
+  if (lua_isnumber(L, -1)) {
+    const double J = lua_tonumber(L, -1);
+    if (!quiet) printf("[config] setting hlld_hll=%f\n", J);
+    HlldRmhdRiemannSolver::smooth_hll = J;
+  }
+  lua_pop(L, 1);
+
+  lua_getfield(L, 1, "hlld_hllc");
+  if (lua_isnumber(L, -1)) {
+    const double J = lua_tonumber(L, -1);
+    if (!quiet) printf("[config] setting hlld_hllc=%f\n", J);
+    HlldRmhdRiemannSolver::smooth_hllc = J;
+  }
+  lua_pop(L, 1);
+
+  lua_getfield(L, 1, "exact_cache");
+  if (lua_isboolean(L, -1)) {
+    const int use = lua_toboolean(L, -1);
+    if (!quiet) printf("[config] setting exact_cache=%s\n", use ? "true" : "false");
+    ExactEulersRiemannSolver::use_star_cache = use;
+  }
+  lua_pop(L, 1);
+
+  lua_getfield(L, 1, "dt_growth");
+  if (lua_isnumber(L, -1)) {
+    const double r = lua_tonumber(L, -1);
+    if (!quiet) printf("[config] setting dt_growth=%f\n", r);
+    TimestepController::max_growth = r;
+  }
+  lua_pop(L, 1);
+
+  lua_getfield(L, 1, "dt_shrink");
+  if (lua_isnumber(L, -1)) {
+    const double r = lua_tonumber(L, -1);
+    if (r <= 0.0 || r >= 1.0) {
+      luaL_error(L, "dt_shrink must be in (0,1)");
+    }
+    if (!quiet) printf("[config] setting dt_shrink=%f\n", r);
+    TimestepController::shrink = r;
+  }
+  lua_pop(L, 1);
+
+  lua_getfield(L, 1, "dt_reject");
+  if (lua_isnumber(L, -1)) {
+    const double r = lua_tonumber(L, -1);
+    if (!quiet) printf("[config] setting dt_reject=%f\n", r);
+    TimestepController::reject_cfl = r;
+  }
+  lua_pop(L, 1);
+
+  lua_getfield(L, 1, "retries");
+  if (lua_isnumber(L, -1)) {
+    const int n = lua_tointeger(L, -1);
+    if (n < 0) {
+      luaL_error(L, "retries must be non-negative");
+    }
+    if (!quiet) printf("[config] setting retries=%d\n", n);
+    TimestepController::max_retries = n;
+  }
+  lua_pop(L, 1);
+
+  lua_getfield(L, 1, "dt_history");
+  if (lua_isnumber(L, -1)) {
+    const int n = lua_tointeger(L, -1);
+    if (n < 0) {
+      luaL_error(L, "dt_history must be non-negative");
+    }
+    if (!quiet) printf("[config] setting dt_history=%d\n", n);
+    TimestepController::history_length = n;
+  }
+  lua_pop(L, 1);
+
+  lua_getfield(L, 1, "repair");
+  if (lua_isboolean(L, -1)) {
+    const int use = lua_toboolean(L, -1);
+    if (!quiet) printf("[config] setting repair=%s\n", use ? "true" : "false");
+    GodunovOperator::repair_failures = use;
+  }
+  lua_pop(L, 1);
+
+  lua_getfield(L, 1, "repair_diffusion");
+  if (lua_isnumber(L, -1)) {
+    const double r = lua_tonumber(L, -1);
+    if (r <= 0.0 || r > 1.0) {
+      luaL_error(L, "repair_diffusion must be in (0,1]");
+    }
+    if (!quiet) printf("[config] setting repair_diffusion=%f\n", r);
+    GodunovOperator::repair_diffusion = r;
+  }
+  lua_pop(L, 1);
+
+  lua_getfield(L, 1, "lazy_c2p");
+  if (lua_isboolean(L, -1)) {
+    const int use = lua_toboolean(L, -1);
+    if (!quiet) printf("[config] setting lazy_c2p=%s\n", use ? "true" : "false");
+    GodunovOperator::lazy_c2p = use;
+  }
+  lua_pop(L, 1);
+
+  lua_getfield(L, 1, "lazy_tolerance");
+  if (lua_isnumber(L, -1)) {
+    const double tol = lua_tonumber(L, -1);
+    if (tol < 0.0) {
+      luaL_error(L, "lazy_tolerance must be non-negative");
+    }
+    if (!quiet) printf("[config] setting lazy_tolerance=%e\n", tol);
+    GodunovOperator::lazy_tolerance = tol;
+  }
+  lua_pop(L, 1);
+
+  lua_getfield(L, 1, "shared_tables");
+  if (lua_isboolean(L, -1)) {
+    const int use = lua_toboolean(L, -1);
+    if (!quiet) printf("[config] setting shared_tables=%s\n", use ? "true" : "false");
+    EosTableStorage::node_shared = use;
+  }
+  lua_pop(L, 1);
+
+  lua_getfield(L, 1, "threads");
+  if (lua_isnumber(L, -1)) {
+    const int n = lua_tointeger(L, -1);
+    if (n < 1 || n > MARA_MAX_THREADS) {
+      luaL_error(L, "threads must be in [1,%d], got %d", MARA_MAX_THREADS, n);
+    }
+#ifndef _OPENMP
+    if (n > 1 && !quiet) {
+      printf("[config] warning: built without OpenMP, sweeps will be serial\n");
+    }
+#endif
+    if (!quiet) printf("[config] setting threads=%d\n", n);
+    GodunovOperator::num_threads = n;
+  }
+  lua_pop(L, 1);
+
   return 0;
 }
 
@@ -1573,6 +1893,34 @@ int luaC_load_shen(lua_State *L)
   return 1;
 }
 
+int luaC_convert_shen(lua_State *L)
+// -----------------------------------------------------------------------------
+// convert_shen(ascii, binary, Yp, [DensRange, TempRange]) reads a slice of the
+// ASCII table as load_shen does, and writes it to a binary file which
+// set_eos("shen", binary) then maps without parsing. Run it once, on one rank.
+// -----------------------------------------------------------------------------
+{
+  const int narg = lua_gettop(L);
+  const char *ascii  = luaL_checkstring(L, 1);
+  const char *binary = luaL_checkstring(L, 2);
+  double  YpExtract  = luaL_checknumber(L, 3);
+  double *DensRange = narg == 3 ? NULL : luaU_checkarray(L, 4);
+  double *TempRange = narg == 3 ? NULL : luaU_checkarray(L, 5);
+
+  ShenTabulatedNuclearEos::verbose = 1;
+  char msg[256];
+  try {
+    TabulatedEos tab =
+      ShenTabulatedNuclearEos::LoadTable(ascii, YpExtract, DensRange, TempRange);
+    ShenTabulatedNuclearEos::WriteBinaryTable(binary, tab);
+    return 0;
+  }
+  catch (const std::exception &e) {
+    snprintf(msg, sizeof(msg), "%s", e.what());
+  }
+  return luaL_error(L, "%s", msg); // outside the catch, see set_eos("shen")
+}
+
 int luaC_test_shen(lua_State *L)
 {
   if (Mara->eos == NULL) {
@@ -1733,6 +2081,153 @@ int luaC_boundary_ApplyBoundaries(lua_State *L)
   return 0;
 }
 
+int luaC_profile_report(lua_State *L)
+// -----------------------------------------------------------------------------
+// Returns a table with the entries timers and counters, each a table keyed by
+// name. Every entry is reduced over the MPI ranks to its min, mean and max,
+// along with the largest number of calls for the timers. Unless the optional
+// argument quiet is true, the report is also printed by the first rank. This
+// must be called on all ranks at once.
+// -----------------------------------------------------------------------------
+{
+  const int quiet = lua_toboolean(L, 1);
+  const int rank = Mara_mpi_get_rank();
+  const int size = Mara_mpi_get_size();
+
+  if (!quiet && rank == 0) {
+    printf("[profile] %-16s %10s %12s %12s %12s\n",
+           "timer", "calls", "min", "mean", "max");
+  }
+
+  lua_newtable(L);
+  lua_newtable(L);
+  for (int t=0; t<Profile::NUM_TIMERS; ++t) {
+    const Profile::Timer T = Profile::Timer(t);
+    const double sec = Profile::Seconds(T);
+    const double calls = Mara_mpi_dbl_max(Profile::Calls(T));
+    const double min = Mara_mpi_dbl_min(sec);
+    const double max = Mara_mpi_dbl_max(sec);
+    const double mean = Mara_mpi_dbl_sum(sec) / size;
+
+    lua_newtable(L);
+    lua_pushnumber(L, calls); lua_setfield(L, -2, "calls");
+    lua_pushnumber(L, min);   lua_setfield(L, -2, "min");
+    lua_pushnumber(L, mean);  lua_setfield(L, -2, "mean");
+    lua_pushnumber(L, max);   lua_setfield(L, -2, "max");
+    lua_setfield(L, -2, Profile::Name(T));
+
+    if (!quiet && rank == 0) {
+      printf("[profile] %-16s %10.0f %10.4f s %10.4f s %10.4f s\n",
+             Profile::Name(T), calls, min, mean, max);
+    }
+  }
+  lua_setfield(L, -2, "timers");
+
+  lua_newtable(L);
+  for (int c=0; c<Profile::NUM_COUNTERS; ++c) {
+    const Profile::Counter C = Profile::Counter(c);
+    const double n = Profile::Counts(C);
+    const double min = Mara_mpi_dbl_min(n);
+    const double max = Mara_mpi_dbl_max(n);
+    const double mean = Mara_mpi_dbl_sum(n) / size;
+
+    lua_newtable(L);
+    lua_pushnumber(L, min);  lua_setfield(L, -2, "min");
+    lua_pushnumber(L, mean); lua_setfield(L, -2, "mean");
+    lua_pushnumber(L, max);  lua_setfield(L, -2, "max");
+    lua_setfield(L, -2, Profile::Name(C));
+
+    if (!quiet && rank == 0) {
+      printf("[profile] %-16s %10s %12.0f %12.0f %12.0f\n",
+             Profile::Name(C), "", min, mean, max);
+    }
+  }
+  lua_setfield(L, -2, "counters");
+
+  return 1;
+}
+int luaC_profile_reset(lua_State *L)
+{
+  Profile::Reset();
+  return 0;
+}
+int luaC_profile_clock(lua_State *L)
+// -----------------------------------------------------------------------------
+// Returns the wall clock used by the profiler, in seconds. Unlike os.clock it
+// counts time spent waiting, e.g. on MPI messages.
+// -----------------------------------------------------------------------------
+{
+  lua_pushnumber(L, Profile::Clock());
+  return 1;
+}
+
+int luaC_riemann_stats(lua_State *L)
+// -----------------------------------------------------------------------------
+// Returns a table with the number of faces the HLLD solver gave to each of the
+// solvers in its cascade, the faces given to the exact solver, and the
+// iterations each took, summed over the MPI ranks. The counts are those of the
+// last call to advance. Unless the optional argument quiet is true, they are
+// also printed by the first rank. This must be called on all ranks at once.
+// -----------------------------------------------------------------------------
+{
+  const int quiet = lua_toboolean(L, 1);
+  const int rank = Mara_mpi_get_rank();
+
+  lua_newtable(L);
+  for (int n=0; n<RiemannSolver::NUM_STATISTICS; ++n) {
+    const RiemannSolver::Statistic S = RiemannSolver::Statistic(n);
+    const double count = Mara_mpi_dbl_sum(RiemannSolver::GetStatistic(S));
+    const char *name = RiemannSolver::StatisticName(S);
+
+    lua_pushnumber(L, count);
+    lua_setfield(L, -2, name);
+
+    if (!quiet && rank == 0) {
+      printf("[riemann] %-16s %12.0f\n", name, count);
+    }
+  }
+  return 1;
+}
+
+int luaC_timestep_history(lua_State *L)
+// -----------------------------------------------------------------------------
+// Returns a table of arrays dt, lambda_dx, errors and accepted, with an entry
+// for each of the last dt_history steps attempted since the last call to
+// timestep.reset, and the number of steps rejected since then. The values are
+// the same on all ranks.
+// -----------------------------------------------------------------------------
+{
+  std::vector<TimestepController::Attempt> H;
+  Mara->timestep->GetHistory(H);
+
+  lua_newtable(L);
+  const int t = lua_gettop(L);
+  const char *names[4] = { "dt", "lambda_dx", "errors", "accepted" };
+
+  for (int m=0; m<4; ++m) {
+    lua_newtable(L);
+    for (size_t n=0; n<H.size(); ++n) {
+      switch (m) {
+      case 0: lua_pushnumber(L, H[n].dt); break;
+      case 1: lua_pushnumber(L, H[n].lambda_dx); break;
+      case 2: lua_pushnumber(L, H[n].errors); break;
+      case 3: lua_pushboolean(L, H[n].accepted); break;
+      }
+      lua_rawseti(L, -2, n+1);
+    }
+    lua_setfield(L, t, names[m]);
+  }
+  lua_pushnumber(L, Mara->timestep->GetRejected());
+  lua_setfield(L, t, "rejected");
+
+  return 1;
+}
+int luaC_timestep_reset(lua_State *L)
+{
+  Mara->timestep->ResetHistory();
+  return 0;
+}
+
 int luaC_eos_TemperatureMeV(lua_State *L)
 {
   const double D = luaL_checknumber(L, 1);
@@ -19,6 +19,7 @@
 #include "ornuhl.hpp"
 #include "ou-field.hpp"
 #include "plm-split.hpp"
+#include "profile.hpp"
 #include "quartic.hpp"
 #include "random.hpp"
 #include "riemann_exact-eulers.hpp"
@@ -35,6 +36,7 @@
 #include "simple-cart.hpp"
 #include "srhd.hpp"
 #include "subgrids.hpp"
+#include "timestep.hpp"
 #include "valman.hpp"
 #include "weno-split.hpp"
 
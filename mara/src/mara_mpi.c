@@ -9,6 +9,12 @@
 #include <mpi.h>
 #endif //__MARA_USE_MPI
 
+#if (__MARA_USE_MPI) && defined(MPI_VERSION) && (MPI_VERSION >= 3)
+#define MARA_MPI_SHARED 1
+#else
+#define MARA_MPI_SHARED 0
+#endif
+
 
 static int luaC_mpi_dims_create(lua_State *L);
 static int luaC_mpi_get_rank(lua_State *L);
@@ -109,6 +115,18 @@ int Mara_mpi_int_sum(int myval)
 #endif //__MARA_USE_MPI
 }
 
+void Mara_mpi_long_sum_n(long *vals, int n)
+/* Sums each of the n values over the ranks in place, in one reduction */
+{
+#if (__MARA_USE_MPI)
+  int run_uses_mpi;
+  MPI_Initialized(&run_uses_mpi);
+  if (run_uses_mpi) {
+    MPI_Allreduce(MPI_IN_PLACE, vals, n, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+  }
+#endif //__MARA_USE_MPI
+}
+
 double Mara_mpi_dbl_min(double myval)
 {
 #if (__MARA_USE_MPI)
@@ -174,6 +192,90 @@ int Mara_mpi_active()
 #endif
 }
 
+
+// -----------------------------------------------------------------------------
+// Blocks of doubles shared by the ranks on a node, through an MPI-3 shared
+// memory window. Creating one is collective: the first rank on each node
+// allocates the block and is its writer, and the others map the same pages.
+// After the writer has filled it, Mara_mpi_shared_sync (also collective) makes
+// the contents visible to the node. Without MPI-3 or an active MPI run, each
+// rank gets a private block which it writes itself.
+// -----------------------------------------------------------------------------
+struct Mara_mpi_shared
+{
+  double *data;
+  int writer;
+#if (MARA_MPI_SHARED)
+  MPI_Comm node;
+  MPI_Win win;
+#endif
+} ;
+
+Mara_mpi_shared *Mara_mpi_shared_new(long n)
+{
+  Mara_mpi_shared *s = (Mara_mpi_shared*) malloc(sizeof(Mara_mpi_shared));
+#if (MARA_MPI_SHARED)
+  s->node = MPI_COMM_NULL;
+  if (Mara_mpi_active()) {
+    int node_rank, disp_unit;
+    MPI_Aint size;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0,
+                        MPI_INFO_NULL, &s->node);
+    MPI_Comm_rank(s->node, &node_rank);
+    s->writer = node_rank == 0;
+    MPI_Win_allocate_shared(s->writer ? n*sizeof(double) : 0, sizeof(double),
+                            MPI_INFO_NULL, s->node, &s->data, &s->win);
+    MPI_Win_shared_query(s->win, 0, &size, &disp_unit, &s->data);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, s->win);
+    return s;
+  }
+#endif // MARA_MPI_SHARED
+  s->data = (double*) malloc(n*sizeof(double));
+  s->writer = 1;
+  return s;
+}
+
+double *Mara_mpi_shared_data(Mara_mpi_shared *s)
+{
+  return s->data;
+}
+
+int Mara_mpi_shared_writer(Mara_mpi_shared *s)
+{
+  return s->writer;
+}
+
+void Mara_mpi_shared_sync(Mara_mpi_shared *s)
+{
+#if (MARA_MPI_SHARED)
+  if (s->node != MPI_COMM_NULL) {
+    MPI_Win_sync(s->win);
+    MPI_Barrier(s->node);
+    MPI_Win_sync(s->win);
+  }
+#endif // MARA_MPI_SHARED
+}
+
+void Mara_mpi_shared_del(Mara_mpi_shared *s)
+{
+  if (s == NULL) return;
+#if (MARA_MPI_SHARED)
+  if (s->node != MPI_COMM_NULL) {
+    int finalized;
+    MPI_Finalized(&finalized);
+    if (!finalized) { // otherwise the window went with MPI_Finalize
+      MPI_Win_unlock_all(s->win);
+      MPI_Win_free(&s->win);
+      MPI_Comm_free(&s->node);
+    }
+    free(s);
+    return;
+  }
+#endif // MARA_MPI_SHARED
+  free(s->data);
+  free(s);
+}
+
 int luaC_mpi_dims_create(lua_State *L)
 {
   int i;
@@ -15,6 +15,14 @@ double Mara_mpi_dbl_max(double myval);
 double Mara_mpi_dbl_sum(double myval);
 int Mara_mpi_int_prod(int myval);
 int Mara_mpi_int_sum(int myval);
+void Mara_mpi_long_sum_n(long *vals, int n);
+
+typedef struct Mara_mpi_shared Mara_mpi_shared;
+Mara_mpi_shared *Mara_mpi_shared_new(long n);
+double *Mara_mpi_shared_data(Mara_mpi_shared *s);
+int Mara_mpi_shared_writer(Mara_mpi_shared *s);
+void Mara_mpi_shared_sync(Mara_mpi_shared *s);
+void Mara_mpi_shared_del(Mara_mpi_shared *s);
 
 #endif // __MaraMpiWrappers_HEADER__
 
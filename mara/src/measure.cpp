@@ -140,6 +140,9 @@ int luaC_mean_energies(lua_State *L)
   const EquationOfState &eos     = *HydroModule::Mara->eos;
   const int Nq                   =  HydroModule::Mara->domain->get_Nq();
   const std::valarray<double> &P =  HydroModule::Mara->PrimitiveArray;
+  std::valarray<double> &T       =  HydroModule::Mara->TemperatureArray;
+
+  eos.Temperatures(P, Nq, T);
 
   double kinetic  = 0.0;
   double internal = 0.0;
@@ -156,7 +159,7 @@ int luaC_mean_energies(lua_State *L)
     fluid.PrimToCons(&P0[0], &U0[0]);
 
     const double v2 = P0[vx]*P0[vx] + P0[vy]*P0[vy] + P0[vz]*P0[vz];
-    const double T0 = eos.Temperature_p(P0[rho], P0[pre]);
+    const double T0 = T[m/Nq];
     const double u0 = eos.Internal(P0[rho], T0);
 
     if (typeid(fluid) == typeid(AdiabaticIdealSrhd) ||
@@ -201,6 +204,9 @@ int luaC_mean_max_temperature(lua_State *L)
   const EquationOfState &eos     = *HydroModule::Mara->eos;
   const int Nq                   =  HydroModule::Mara->domain->get_Nq();
   const std::valarray<double> &P =  HydroModule::Mara->PrimitiveArray;
+  std::valarray<double> &T       =  HydroModule::Mara->TemperatureArray;
+
+  eos.Temperatures(P, Nq, T);
 
   double ttl=0.0, max=0.0;
 
@@ -209,7 +215,7 @@ int luaC_mean_max_temperature(lua_State *L)
 
     const std::slice M(m, Nq, 1);
     const std::valarray<double> P0 = P[M];
-    const double T0 = eos.TemperatureMeV(P0[rho], P0[pre]);
+    const double T0 = eos.TemperatureArbToMeV(P0[rho], T[m/Nq]);
     ttl += T0;
     if (T0 > max) max = T0;
   }
@@ -225,6 +231,9 @@ int luaC_mean_max_sonic_mach(lua_State *L)
   const EquationOfState &eos     = *HydroModule::Mara->eos;
   const int Nq                   =  HydroModule::Mara->domain->get_Nq();
   const std::valarray<double> &P =  HydroModule::Mara->PrimitiveArray;
+  std::valarray<double> &T       =  HydroModule::Mara->TemperatureArray;
+
+  eos.Temperatures(P, Nq, T);
 
   double ttl=0.0, max=0.0;
 
@@ -234,7 +243,7 @@ int luaC_mean_max_sonic_mach(lua_State *L)
     const std::slice M(m, Nq, 1);
     const std::valarray<double> P0 = P[M];
     const double v2 = P0[vx]*P0[vx] + P0[vy]*P0[vy] + P0[vz]*P0[vz];
-    const double T0 = eos.Temperature_p(P0[rho], P0[pre]);
+    const double T0 = T[m/Nq];
 
     if (typeid(fluid) == typeid(AdiabaticIdealSrhd) ||
         typeid(fluid) == typeid(AdiabaticIdealRmhd)) {
@@ -264,12 +273,15 @@ int luaC_mean_min_alfvenic_mach(lua_State *L)
   const EquationOfState &eos     = *HydroModule::Mara->eos;
   const int Nq                   =  HydroModule::Mara->domain->get_Nq();
   const std::valarray<double> &P =  HydroModule::Mara->PrimitiveArray;
+  std::valarray<double> &T       =  HydroModule::Mara->TemperatureArray;
 
   if (typeid(fluid) != typeid(AdiabaticIdealRmhd)) {
     lua_pushnumber(L, 0.0);
     return 1;
   }
 
+  eos.Temperatures(P, Nq, T);
+
   double ttl=0.0, min=1e20;
 
   for (size_t m=0; m<P.size(); m+=Nq) {
@@ -280,7 +292,7 @@ int luaC_mean_min_alfvenic_mach(lua_State *L)
 
     const double v2 = P0[vx]*P0[vx] + P0[vy]*P0[vy] + P0[vz]*P0[vz];
     const double B2 = P0[Bx]*P0[Bx] + P0[By]*P0[By] + P0[Bz]*P0[Bz];
-    const double T0 = eos.Temperature_p(P0[rho], P0[pre]);
+    const double T0 = T[m/Nq];
     const double u0 = eos.Internal(P0[rho], T0);
     const double rhoh = P0[rho] + u0 + P0[pre];
     const double va2 = B2 / (B2 + rhoh);
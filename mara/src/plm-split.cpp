@@ -2,111 +2,375 @@
 #include "plm-split.hpp"
 #include "weno.h"
 #include "logging.hpp"
+#include "profile.hpp"
 
 #define MAXNQ 8 // Used for static array initialization
 typedef MethodOfLinesSplit Deriv;
 
-std::valarray<double> Deriv::dUdt(const std::valarray<double> &Uin)
+static void report_first_order_fallback(int error)
+{
+#pragma omp critical (debuglog)
+  {
+    DebugLog.Warning(__FUNCTION__) << "Reverting to first order at zone interface... ";
+    if (!error) DebugLog.Warning() << "Success!" << std::endl;
+    else        DebugLog.Warning() << "Still failed!" << std::endl;
+  }
+}
+
+Deriv::MethodOfLinesSplit()
+  : special(NULL),
+    special_fluid(NULL),
+    special_riemann(NULL),
+    special_fluid_type(NULL),
+    special_riemann_type(NULL),
+    special_recon(RECONSTRUCT_PLM) { }
+
+Deriv::~MethodOfLinesSplit()
+{
+  delete special;
+}
+
+void Deriv::select_special_sweep()
+// -----------------------------------------------------------------------------
+// Builds the specialized sweep the first time it is needed, and again only when
+// the fluid, Riemann solver or reconstruction have changed since. Types are
+// compared along with addresses, since a module replaced by set_riemann may be
+// allocated at the address of the one it replaced.
+// -----------------------------------------------------------------------------
+{
+  const FluidEquations *fluid = Mara->fluid;
+  RiemannSolver *riemann = Mara->riemann;
+
+  if (fluid == NULL || riemann == NULL) {
+    delete special;
+    special = NULL;
+    special_fluid = NULL;
+    special_riemann = NULL;
+    return;
+  }
+  if (fluid == special_fluid && riemann == special_riemann &&
+      &typeid(*fluid) == special_fluid_type &&
+      &typeid(*riemann) == special_riemann_type &&
+      reconstruct_method == special_recon) {
+    return;
+  }
+
+  delete special;
+  special = BuildFluxSweep(*fluid, *riemann, reconstruct_method);
+  special_fluid = fluid;
+  special_riemann = riemann;
+  special_fluid_type = &typeid(*fluid);
+  special_riemann_type = &typeid(*riemann);
+  special_recon = reconstruct_method;
+}
+
+void Deriv::dUdt(std::valarray<double> &Uin, std::valarray<double> &L)
+// -----------------------------------------------------------------------------
+// Writes the time derivative of Uin into L, which must already have the size of
+// Uin. Boundary conditions are applied to the guard zones of Uin.
+//
+// When the domain is decomposed over several subgrids, the fluxes through faces
+// whose stencils lie outside the guard layer are computed while the guard zones
+// are exchanged, and the remaining ones after. Every face is computed exactly
+// once from the same inputs, so the result is the same either way. The SoA
+// layout transposes every zone, guards included, before any sweep, so there
+// only the inversion of the interior overlaps the exchange, and the sweeps do
+// not use the specialized FluxSweep.
+// -----------------------------------------------------------------------------
 {
   this->prepare_integration();
 
-  std::valarray<double> U = Uin;
-  std::valarray<double> L(U.size());
   std::valarray<double> &P = Mara->PrimitiveArray;
 
-  ConsToPrim(U, P);
-  DriveSweeps(P, L);
+  if (Mara->domain->SubgridSize() == 1) {
+    ConsToPrim(Uin, P);
+    DriveSweeps(P, L);
+    return;
+  }
+  if (GodunovOperator::data_layout == LAYOUT_SOA) {
+    begin_cons_to_prim(Uin, P);
+    end_cons_to_prim(Uin, P);
+    DriveSweeps(P, L);
+    return;
+  }
+
+  begin_cons_to_prim(Uin, P);
+  select_special_sweep();
+  size_fluxes();
 
-  return L;
+  for (int d=1; d<=ND; ++d) {
+    interior_runs(d, face_runs[d]);
+    sweep(&P[0], flux(d), d, face_runs[d]);
+  }
+
+  end_cons_to_prim(Uin, P);
+
+  for (int d=1; d<=ND; ++d) {
+    const int s = stride[d] / NQ;
+    complement_runs(face_runs[d], 2*s, stride[0]/NQ - 3*s, shell_runs);
+    sweep(&P[0], flux(d), d, shell_runs);
+  }
+  assemble(&L[0]);
+}
+bool Deriv::NeedsCornerGuards() const
+// -----------------------------------------------------------------------------
+// The sweeps read the guard zones along the sweep axis only, but constrained
+// transport averages fluxes over the transverse neighbors.
+// -----------------------------------------------------------------------------
+{
+  return Mara->fluid == NULL || Mara->fluid->UsesConstrainedTransport();
 }
 void Deriv::DriveSweeps(const std::valarray<double> &P,
                         std::valarray<double> &L)
 {
-   switch (ND) {
-   case 1: drive_sweeps_1d(&P[0], &L[0]); break;
-   case 2: drive_sweeps_2d(&P[0], &L[0]); break;
-   case 3: drive_sweeps_3d(&P[0], &L[0]); break;
+   if (GodunovOperator::data_layout == LAYOUT_SOA) {
+     transpose_to_soa(&P[0]);
+   }
+   else {
+     select_special_sweep();
    }
+   size_fluxes();
+   for (int d=1; d<=ND; ++d) {
+     sweep(&P[0], flux(d), d);
+   }
+   assemble(&L[0]);
+}
+void Deriv::intercell_flux_sweep(const double *P, double *F, int dim,
+                                 const std::vector<int> &runs)
+// -----------------------------------------------------------------------------
+// The faces of each run are reconstructed and handed to the Riemann solver a
+// pencil of BATCH_SIZE at a time.
+// -----------------------------------------------------------------------------
+{
+  enum { B = RiemannSolver::BATCH_SIZE };
+  const int S = stride[dim];
+
+#pragma omp parallel num_threads(GodunovOperator::num_threads)
+  for (size_t r=0; r<runs.size(); r+=2) {
+#pragma omp for schedule(static) nowait
+    for (int n0=runs[r]; n0<runs[r+1]; n0+=B) {
+      const int m = (runs[r+1]-n0 < B) ? runs[r+1]-n0 : B;
+      double Pl[B*MAXNQ], Pr[B*MAXNQ];
+      int fail[B];
+
+      for (int k=0; k<m; ++k) {
+        const int i = (n0+k)*NQ;
+        for (int q=0; q<NQ; ++q) {
+          const int j = i + q;
+          double v[6] = { P[j-2*S], P[j-S], P[j+0], P[j+1*S], P[j+2*S], P[j+3*S] };
+
+          switch (GodunovOperator::reconstruct_method) {
+          case RECONSTRUCT_PCM:
+            Pl[k*NQ+q] = v[2];
+            Pr[k*NQ+q] = v[3];
+            break;
+          case RECONSTRUCT_PLM:
+            Pl[k*NQ+q] = reconstruct(&v[2], PLM_C2R);
+            Pr[k*NQ+q] = reconstruct(&v[3], PLM_C2L);
+            break;
+          case RECONSTRUCT_WENO5:
+            Pl[k*NQ+q] = reconstruct(&v[2], WENO5_FV_C2R);
+            Pr[k*NQ+q] = reconstruct(&v[3], WENO5_FV_C2L);
+            break;
+          }
+        }
+      }
+      solve_pencil(P, Pl, Pr, F, n0, m, dim, fail);
+    }
+  }
 }
-void Deriv::intercell_flux_sweep(const double *P, double *F, int dim)
+void Deriv::solve_pencil(const double *P, const double *Pl, const double *Pr,
+                         double *F, int n0, int m, int dim, int *fail)
+// -----------------------------------------------------------------------------
+// Writes the fluxes through the right faces of the m zones starting at n0,
+// given the reconstructed states on either side. Faces whose states the solver
+// rejects revert to first order.
+// -----------------------------------------------------------------------------
 {
-  int i,S=stride[dim];
-  double Pl[MAXNQ], Pr[MAXNQ];
+  const int S = stride[dim];
+  const double ml = Mara->riemann->IntercellFluxBatch(Pl, Pr, &F[n0*NQ], m,
+                                                      dim, fail);
+  RiemannSolver::UpdateMaxLambda(ml);
+
+  for (int k=0; k<m; ++k) {
+    if (fail[k]) {
+      const int i = (n0+k)*NQ;
+      int error = Mara->riemann->IntercellFlux(&P[i], &P[i+S], 0, &F[i], 0.0, dim);
+      report_first_order_fallback(error);
+    }
+  }
+}
+
+void Deriv::transpose_to_soa(const double *P)
+// -----------------------------------------------------------------------------
+// Copies the zone-major primitives into one contiguous, aligned plane per
+// component, so that reconstruction along any axis has unit stride over zones.
+// -----------------------------------------------------------------------------
+{
+  const int Nz = stride[0] / NQ;
+  Psoa.resize(NQ, Nz);
+  Pface.resize(2*NQ, Nz);
+
+  for (int q=0; q<NQ; ++q) {
+    double *Pq = Psoa[q];
+    for (int n=0; n<Nz; ++n) {
+      Pq[n] = P[n*NQ + q];
+    }
+  }
+}
+void Deriv::intercell_flux_sweep_soa(const double *P, double *F, int dim)
+// -----------------------------------------------------------------------------
+// Equivalent to intercell_flux_sweep, but reconstructs the face values of every
+// zone a whole plane at a time, using the SoA copy of the primitives. Pface[q]
+// holds the value on the right face of each zone, and Pface[NQ+q] the value on
+// its left face. P is the zone-major array, used only for the first order
+// fallback.
+// -----------------------------------------------------------------------------
+{
+  enum { B = RiemannSolver::BATCH_SIZE };
+  const int s = stride[dim] / NQ;   // zone stride along dim
+  const int Nz = stride[0] / NQ;
+
+  Profile::Scope timer(Profile::TIMER_FLUX_SWEEP);
+  Profile::Count(Profile::COUNT_FACES_SWEPT, Nz-5*s);
+
+#pragma omp parallel num_threads(GodunovOperator::num_threads)
+  {
+    int n0, n1;
+    thread_tile(Nz-4*s, n0, n1);
 
-  for (i=2*S; i<stride[0]-3*S; i+=NQ) {
     for (int q=0; q<NQ; ++q) {
-      const int m = i + q;
-      double v[6] = { P[m-2*S], P[m-S], P[m+0], P[m+1*S], P[m+2*S], P[m+3*S] };
+      const double *v = Psoa[q] + 2*s + n0;
+      double *R = Pface[q] + 2*s + n0;
+      double *L = Pface[NQ+q] + 2*s + n0;
 
       switch (GodunovOperator::reconstruct_method) {
       case RECONSTRUCT_PCM:
-	Pl[q] = v[2];
-	Pr[q] = v[3];
-	break;
+        for (int n=0; n<n1-n0; ++n) R[n] = L[n] = v[n];
+        break;
       case RECONSTRUCT_PLM:
-	Pl[q] = reconstruct(&v[2], PLM_C2R);
-	Pr[q] = reconstruct(&v[3], PLM_C2L);
-	break;
+        reconstruct_batch(v, R, n1-n0, s, PLM_C2R);
+        reconstruct_batch(v, L, n1-n0, s, PLM_C2L);
+        break;
       case RECONSTRUCT_WENO5:
-	Pl[q] = reconstruct(&v[2], WENO5_FV_C2R);
-	Pr[q] = reconstruct(&v[3], WENO5_FV_C2L);
-	break;
+        reconstruct_batch(v, R, n1-n0, s, WENO5_FV_C2R);
+        reconstruct_batch(v, L, n1-n0, s, WENO5_FV_C2L);
+        break;
       }
     }
-    int error = Mara->riemann->IntercellFlux(Pl, Pr, 0, &F[i], 0.0, dim);
-    if (error) {
-      error = Mara->riemann->IntercellFlux(&P[i], &P[i+S], 0, &F[i], 0.0, dim);
+#pragma omp barrier // faces of neighboring tiles are read below
+
+#pragma omp for schedule(static)
+    for (int n0=2*s; n0<Nz-3*s; n0+=B) {
+      const int m = (Nz-3*s-n0 < B) ? Nz-3*s-n0 : B;
+      double Pl[B*MAXNQ], Pr[B*MAXNQ];
+      int fail[B];
 
-      DebugLog.Warning(__FUNCTION__) << "Reverting to first order at zone interface... ";
-      if (!error) DebugLog.Warning() << "Success!" << std::endl;
-      else        DebugLog.Warning() << "Still failed!" << std::endl;
+      for (int q=0; q<NQ; ++q) {
+        const double *R = Pface[   q] + n0;
+        const double *L = Pface[NQ+q] + n0 + s;
+        for (int k=0; k<m; ++k) {
+          Pl[k*NQ+q] = R[k];
+          Pr[k*NQ+q] = L[k];
+        }
+      }
+      solve_pencil(P, Pl, Pr, F, n0, m, dim, fail);
     }
   }
 }
 
-void Deriv::drive_sweeps_1d(const double *P, double *L)
+void Deriv::sweep(const double *P, double *F, int dim)
 {
-  double *F = (double*) malloc(stride[0]*sizeof(double));
+  if (GodunovOperator::data_layout == LAYOUT_SOA) {
+    intercell_flux_sweep_soa(P, F, dim);
+  }
+  else {
+    const int s = stride[dim] / NQ;
+    sweep_runs.resize(2);
+    sweep_runs[0] = 2*s;
+    sweep_runs[1] = stride[0]/NQ - 3*s;
+    sweep(P, F, dim, sweep_runs);
+  }
+}
+void Deriv::sweep(const double *P, double *F, int dim,
+                  const std::vector<int> &runs)
+// -----------------------------------------------------------------------------
+// Computes the fluxes through the right faces of the zones in runs. Only the
+// zone-major layout supports a subset of faces.
+// -----------------------------------------------------------------------------
+{
+  Profile::Scope timer(Profile::TIMER_FLUX_SWEEP);
+  for (size_t r=0; r<runs.size(); r+=2) {
+    Profile::Count(Profile::COUNT_FACES_SWEPT, runs[r+1] - runs[r]);
+  }
 
+  if (special) {
+    special->Sweep(P, F, stride, dim, runs);
+  }
+  else {
+    intercell_flux_sweep(P, F, dim, runs);
+  }
+}
+void Deriv::size_fluxes()
+{
+  if (ND >= 1 && F.size() != size_t(stride[0])) F.resize(stride[0]);
+  if (ND >= 2 && G.size() != size_t(stride[0])) G.resize(stride[0]);
+  if (ND >= 3 && H.size() != size_t(stride[0])) H.resize(stride[0]);
+}
+double *Deriv::flux(int dim)
+{
+  switch (dim) {
+  case 1: return &F[0];
+  case 2: return &G[0];
+  case 3: return &H[0];
+  }
+  return NULL;
+}
+void Deriv::assemble(double *L)
+{
+  switch (ND) {
+  case 1: assemble_1d(L); break;
+  case 2: assemble_2d(L); break;
+  case 3: assemble_3d(L); break;
+  }
+}
+void Deriv::assemble_1d(double *L)
+{
   int i,sx=stride[1];
-  intercell_flux_sweep(P,F,1);
 
+  for (i=0; i<sx; ++i) {
+    L[i] = 0.0;
+  }
+#pragma omp parallel for num_threads(GodunovOperator::num_threads) schedule(static)
   for (i=sx; i<stride[0]; ++i) {
     L[i] = -(F[i]-F[i-sx])/dx;
   }
-  free(F);
 }
-void Deriv::drive_sweeps_2d(const double *P, double *L)
+void Deriv::assemble_2d(double *L)
 {
-  double *F = (double*) malloc(stride[0]*sizeof(double));
-  double *G = (double*) malloc(stride[0]*sizeof(double));
-
   int i,sx=stride[1],sy=stride[2];
-  intercell_flux_sweep(P,F,1);
-  intercell_flux_sweep(P,G,2);
 
-  Mara->fluid->ConstrainedTransport2d(F,G,stride);
+  Mara->fluid->ConstrainedTransport2d(&F[0],&G[0],stride);
 
+  for (i=0; i<sx; ++i) {
+    L[i] = 0.0;
+  }
+#pragma omp parallel for num_threads(GodunovOperator::num_threads) schedule(static)
   for (i=sx; i<stride[0]; ++i) {
     L[i] = -(F[i]-F[i-sx])/dx - (G[i]-G[i-sy])/dy;
   }
-  free(F); free(G);
 }
-void Deriv::drive_sweeps_3d(const double *P, double *L)
+void Deriv::assemble_3d(double *L)
 {
-  double *F = (double*) malloc(stride[0]*sizeof(double));
-  double *G = (double*) malloc(stride[0]*sizeof(double));
-  double *H = (double*) malloc(stride[0]*sizeof(double));
-
   int i,sx=stride[1],sy=stride[2],sz=stride[3];
-  intercell_flux_sweep(P,F,1);
-  intercell_flux_sweep(P,G,2);
-  intercell_flux_sweep(P,H,3);
 
-  Mara->fluid->ConstrainedTransport3d(F,G,H,stride);
+  Mara->fluid->ConstrainedTransport3d(&F[0],&G[0],&H[0],stride);
 
+  for (i=0; i<sx; ++i) {
+    L[i] = 0.0;
+  }
+#pragma omp parallel for num_threads(GodunovOperator::num_threads) schedule(static)
   for (i=sx; i<stride[0]; ++i) {
     L[i] = -(F[i]-F[i-sx])/dx - (G[i]-G[i-sy])/dy - (H[i]-H[i-sz])/dz;
   }
-  free(F); free(G); free(H);
 }
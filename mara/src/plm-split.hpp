@@ -4,18 +4,53 @@
 #define __MethodOfLinesSplit_HEADER__
 
 #include "hydro.hpp"
+#include "arrays.hpp"
+#include "flux-sweep.hpp"
 
 class MethodOfLinesSplit : public GodunovOperator
 {
 private:
-  void intercell_flux_sweep(const double *P, double *F, int dim);
+  std::valarray<double> F, G, H; // intercell fluxes, sized once per domain
+  std::vector<int> sweep_runs;    // all the faces swept along one axis
+  std::vector<int> face_runs[4];  // faces swept while guards are exchanged
+  std::vector<int> shell_runs;    // faces left to sweep once they are filled
+  AlignedPlanes<double> Psoa;    // primitives, one plane per component
+  AlignedPlanes<double> Pface;   // face values: C2R planes, then C2L planes
 
-  void drive_sweeps_1d(const double *P, double *L);
-  void drive_sweeps_2d(const double *P, double *L);
-  void drive_sweeps_3d(const double *P, double *L);
+  // ---------------------------------------------------------------------------
+  // Specialized sweep for the current fluid, solver and reconstruction, along
+  // with the configuration it was built for. NULL when there is no
+  // specialization, in which case the generic sweep is used.
+  // ---------------------------------------------------------------------------
+  IntercellFluxSweep *special;
+  const FluidEquations *special_fluid;
+  const RiemannSolver *special_riemann;
+  const std::type_info *special_fluid_type;
+  const std::type_info *special_riemann_type;
+  ReconstructMethod special_recon;
+
+  void select_special_sweep();
+  void intercell_flux_sweep(const double *P, double *F, int dim,
+                            const std::vector<int> &runs);
+  void intercell_flux_sweep_soa(const double *P, double *F, int dim);
+  void solve_pencil(const double *P, const double *Pl, const double *Pr,
+                    double *F, int n0, int m, int dim, int *fail);
+  void transpose_to_soa(const double *P);
+  void sweep(const double *P, double *F, int dim);
+  void sweep(const double *P, double *F, int dim, const std::vector<int> &runs);
+
+  void size_fluxes();
+  double *flux(int dim);
+  void assemble(double *L);
+  void assemble_1d(double *L);
+  void assemble_2d(double *L);
+  void assemble_3d(double *L);
   void DriveSweeps(const std::valarray<double> &P, std::valarray<double> &L);
 public:
-  std::valarray<double> dUdt(const std::valarray<double> &Uin);
+  MethodOfLinesSplit();
+  ~MethodOfLinesSplit();
+  void dUdt(std::valarray<double> &Uin, std::valarray<double> &L);
+  bool NeedsCornerGuards() const;
 } ;
 
 #endif // __MethodOfLinesSplit_HEADER__
@@ -0,0 +1,57 @@
+
+#include <time.h>
+#include <sys/time.h>
+#include "profile.hpp"
+
+double Profile::seconds[NUM_TIMERS];
+long Profile::calls[NUM_TIMERS];
+long Profile::counts[NUM_COUNTERS];
+
+double Profile::Clock()
+{
+#if defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9*ts.tv_nsec;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + 1e-6*tv.tv_usec;
+#endif
+}
+void Profile::Reset()
+{
+  for (int t=0; t<NUM_TIMERS; ++t) {
+    seconds[t] = 0.0;
+    calls[t] = 0;
+  }
+  for (int c=0; c<NUM_COUNTERS; ++c) {
+    counts[c] = 0;
+  }
+}
+const char *Profile::Name(Timer t)
+{
+  switch (t) {
+  case TIMER_ADVANCE     : return "advance";
+  case TIMER_CONS_TO_PRIM: return "cons_to_prim";
+  case TIMER_FLUX_SWEEP  : return "flux_sweep";
+  case TIMER_SYNCHRONIZE : return "synchronize";
+  case TIMER_DRIVING     : return "driving";
+  case TIMER_COOLING     : return "cooling";
+  case TIMER_OUTPUT      : return "output";
+  default: return "";
+  }
+}
+const char *Profile::Name(Counter c)
+{
+  switch (c) {
+  case COUNT_STEPS         : return "steps";
+  case COUNT_ZONES_INVERTED: return "zones_inverted";
+  case COUNT_ZONES_SKIPPED : return "zones_skipped";
+  case COUNT_FACES_SWEPT   : return "faces_swept";
+  case COUNT_MESSAGES      : return "messages";
+  case COUNT_ZONES_REPAIRED: return "zones_repaired";
+  case COUNT_EOS_OFF_TABLE : return "eos_off_table";
+  default: return "";
+  }
+}
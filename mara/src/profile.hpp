@@ -0,0 +1,68 @@
+
+
+#ifndef __Profile_HEADER__
+#define __Profile_HEADER__
+
+class Profile
+// -----------------------------------------------------------------------------
+// A fixed registry of wall clock timers and event counters for the hot paths.
+// The set of entries is the same on every rank, so they may be reduced over
+// MPI by position. Timers are inclusive, so that a Synchronize called from
+// within a flux sweep is counted toward both. Entries are not thread safe, and
+// must only be updated outside of OpenMP parallel regions.
+// -----------------------------------------------------------------------------
+{
+public:
+  enum Timer {
+    TIMER_ADVANCE,        // whole steps taken by advance
+    TIMER_CONS_TO_PRIM,   // batched inversion, not counting the boundaries
+    TIMER_FLUX_SWEEP,     // reconstruction and Riemann solves
+    TIMER_SYNCHRONIZE,    // guard zone exchange, including waits
+    TIMER_DRIVING,
+    TIMER_COOLING,
+    TIMER_OUTPUT,         // writing the primitives to disk
+    NUM_TIMERS
+  } ;
+  enum Counter {
+    COUNT_STEPS,
+    COUNT_ZONES_INVERTED,
+    COUNT_ZONES_SKIPPED,  // left to their last inversion by lazy_c2p
+    COUNT_FACES_SWEPT,
+    COUNT_MESSAGES,       // guard zone messages posted, sends and receives
+    COUNT_ZONES_REPAIRED, // failed zones diffused by each repair pass
+    COUNT_EOS_OFF_TABLE,  // tabulated EOS samples taken off the table
+    NUM_COUNTERS
+  } ;
+
+  class Scope
+  // ---------------------------------------------------------------------------
+  // Adds the time from its construction to its destruction to a timer, also
+  // when the scope is left by an exception.
+  // ---------------------------------------------------------------------------
+  {
+  private:
+    Timer timer;
+    double start;
+  public:
+    Scope(Timer timer) : timer(timer), start(Profile::Clock()) { }
+    ~Scope() { Profile::Add(timer, Profile::Clock() - start); }
+  } ;
+
+  static double Clock(); // monotonic wall clock, in seconds
+  static void Add(Timer t, double sec) { seconds[t] += sec; ++calls[t]; }
+  static void Count(Counter c, long n=1) { counts[c] += n; }
+  static void Reset();
+
+  static const char *Name(Timer t);
+  static const char *Name(Counter c);
+  static double Seconds(Timer t) { return seconds[t]; }
+  static long Calls(Timer t) { return calls[t]; }
+  static long Counts(Counter c) { return counts[c]; }
+
+private:
+  static double seconds[NUM_TIMERS];
+  static long calls[NUM_TIMERS];
+  static long counts[NUM_COUNTERS];
+} ;
+
+#endif // __Profile_HEADER__
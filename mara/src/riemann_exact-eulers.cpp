@@ -42,47 +42,94 @@ public:
 
 
 
+bool ExactEulersRiemannSolver::use_star_cache = false;
+
+
 int ExactEulersRiemannSolver::IntercellFlux(const double *pl, const double *pr,
 					    double *U_out, double *F, double s, int dim)
 {
-  switch (dim) {
-  case 1:
-    v1=vx; v2=vy; v3=vz;
-    break;
-  case 2:
-    v1=vy; v2=vz; v3=vx;
-    break;
-  case 3:
-    v1=vz; v2=vx; v3=vy;
-    break;
+  return solve(pl, pr, U_out, F, s, dim, NULL);
+}
+
+int ExactEulersRiemannSolver::IntercellFluxAtFace(const double *pl,
+                                                  const double *pr,
+                                                  double *F, int dim, int face)
+// -----------------------------------------------------------------------------
+// Same as IntercellFlux sampled at s=0, for the face with the given index
+// along axis dim. The index is that of the zone on the left of the face, so
+// that faces along different axes may share it. PrepareStarCache must have
+// been called with the number of zones before any threads enter here.
+// -----------------------------------------------------------------------------
+{
+  if (!use_star_cache) {
+    return solve(pl, pr, NULL, F, 0.0, dim, NULL);
+  }
+  return solve(pl, pr, NULL, F, 0.0, dim, &StarPressure[dim-1][face]);
+}
+
+void ExactEulersRiemannSolver::PrepareStarCache(int nfaces)
+// -----------------------------------------------------------------------------
+// Sizes the cache of star pressures for a grid of nfaces zones. The entries
+// are cleared when the size changes, since they then belong to another grid.
+// -----------------------------------------------------------------------------
+{
+  if (!use_star_cache) return;
+  for (int d=0; d<3; ++d) {
+    if (StarPressure[d].size() != size_t(nfaces)) {
+      StarPressure[d].assign(nfaces, 0.0);
+    }
   }
+}
 
+int ExactEulersRiemannSolver::solve(const double *pl, const double *pr,
+                                    double *U_out, double *F, double s, int dim,
+                                    double *guess)
+// -----------------------------------------------------------------------------
+// When guess is given and positive, it is used as the first initial guess for
+// p*, before the usual estimates, and the converged p* is written back to it.
+// A cached guess which fails to converge falls through to the estimates
+// silently, since it is only a shortcut.
+// -----------------------------------------------------------------------------
+{
+  const AdiabaticIdealEulers &fluid = Mara->GetFluid<AdiabaticIdealEulers>();
   NewtonRaphesonSolver solver(500, 1e-12);
   EulersWavePattern eqn(pl, pr, Mara->GetEos<AdiabaticEos>().Gamma, dim);
 
   double U[5], P[5], ap, am, p;
-  int Attempt = 0;
+  int Attempt = (guess && *guess > 0.0) ? -1 : 0;
+
+  CountStatistic(STAT_EXACT);
+  if (Attempt == -1) CountStatistic(STAT_EXACT_CACHED);
+
   while (Attempt < 3) {
     try {
-      p = eqn.EstimateSolution(Attempt);
+      p = (Attempt == -1) ? *guess : eqn.EstimateSolution(Attempt);
       solver.Solve(eqn, &p);
+      CountStatistic(STAT_EXACT_ITERATIONS, solver.GetIterations());
       eqn.SampleSolution(p, s, P);
-      fluid.PrimToCons(P, U);
-      fluid.FluxAndEigenvalues(U, P, F, &ap, &am, dim);
+      fluid.AdiabaticIdealEulers::PrimToCons(P, U);
+      fluid.AdiabaticIdealEulers::FluxAndEigenvalues(U, P, F, &ap, &am, dim);
 
       double ml = (fabs(am)<fabs(ap)) ? fabs(ap) : fabs(am);
-      if (MaxLambda < ml) MaxLambda = ml;
+      UpdateMaxLambda(ml);
       if (U_out) std::memcpy(U_out, U, 5*sizeof(double));
+      if (guess) *guess = p;
       return 0;
     }
     catch (const std::exception &e) {
-      DebugLog.Warning(__FUNCTION__)
-	<< "failed to find p* in Riemann solution on attempt "
-	<< Attempt << std::endl;
+      CountStatistic(STAT_EXACT_ITERATIONS, solver.GetIterations());
+      if (Attempt >= 0) {
+#pragma omp critical (debuglog)
+        DebugLog.Warning(__FUNCTION__)
+          << "failed to find p* in Riemann solution on attempt "
+          << Attempt << std::endl;
+      }
       ++Attempt;
     }
   }
+  if (guess) *guess = 0.0;
   if (BackupRiemannSolver) {
+#pragma omp critical (debuglog)
     DebugLog.Error(__FUNCTION__)
       << "failed to find p* in Riemann solution. "
       << "Reverting to backup riemann solver." << std::endl;
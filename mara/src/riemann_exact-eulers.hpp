@@ -15,16 +15,32 @@
 #define __ExactRiemannSolverEulers_HEADER__
 
 #include <iostream>
+#include <vector>
 #include "nrsolver.hpp"
 #include "eulers.hpp"
 
 
 class ExactEulersRiemannSolver : public RiemannSolver
+// -----------------------------------------------------------------------------
+// When use_star_cache is set, the star pressure found on each face is kept, and
+// is tried first as the initial guess of the Newton-Raphson search the next
+// time that face is solved through IntercellFluxAtFace. Between the stages and
+// steps of a smooth flow it is much closer to the root than the two-rarefaction
+// estimate, so the search takes fewer iterations. The root is the same to the
+// solver tolerance, but not bit-identical, so the cache is off by default.
+//
+// Faces are identified only in the compiled sweeps of MethodOfLinesSplit (see
+// RiemannCalls in flux-sweep.cpp), so only those use the cache. The generic
+// sweeps, the SoA layout, ctu-hancock and weno-split solve every face from the
+// usual estimates whatever use_star_cache is.
+//
+// The fluid is looked up through Mara->fluid on each solve, so that the solver
+// outlives a change of fluid, as the other solvers do.
+// -----------------------------------------------------------------------------
 {
 private:
-  const AdiabaticIdealEulers &fluid;
   RiemannSolver *BackupRiemannSolver;
-  int v1, v2, v3;
+  std::vector<double> StarPressure[3]; // last p* on each face, zero if none
 
   enum { rho, nrg, px, py, pz }; // Conserved
   enum { RHO, pre, vx, vy, vz }; // Primitive
@@ -38,14 +54,22 @@ public:
       return "Failed to find p* in Riemann solution.";
     }
   } ;
-  ExactEulersRiemannSolver(const AdiabaticIdealEulers &fluid)
-    : fluid(fluid), BackupRiemannSolver(NULL) { }
-  ExactEulersRiemannSolver(const AdiabaticIdealEulers &fluid,
-			   RiemannSolver *BackupRiemannSolver)
-    : fluid(fluid), BackupRiemannSolver(BackupRiemannSolver) { }
+  ExactEulersRiemannSolver()
+    : BackupRiemannSolver(NULL) { }
+  ExactEulersRiemannSolver(RiemannSolver *BackupRiemannSolver)
+    : BackupRiemannSolver(BackupRiemannSolver) { }
   ~ExactEulersRiemannSolver() { }
   int IntercellFlux(const double *pl, const double *pr, double *U_out,
 		    double *F, double s, int dim);
+  int IntercellFluxAtFace(const double *pl, const double *pr, double *F,
+                          int dim, int face);
+  void PrepareStarCache(int nfaces);
+
+  static bool use_star_cache;
+
+private:
+  int solve(const double *pl, const double *pr, double *U_out, double *F,
+            double s, int dim, double *guess);
 } ;
 
 #endif // __ExactRiemannSolverEulers_HEADER__
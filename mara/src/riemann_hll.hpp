@@ -2,6 +2,8 @@
 #ifndef __HllRiemanSolver_HEADER__
 #define __HllRiemanSolver_HEADER__
 
+#include <cmath>
+#include <cstring>
 #include "hydro.hpp"
 
 class HllRiemannSolver : public RiemannSolver
@@ -9,7 +11,130 @@ class HllRiemannSolver : public RiemannSolver
 public:
   int IntercellFlux(const double *pl, const double *pr, double *U,
 		    double *F, double s, int dim);
+
+  // ---------------------------------------------------------------------------
+  // The solver body, for a fluid type and number of components known at
+  // compile time. With Fluid = FluidEquations and NQ = 0 it works for any fluid
+  // and takes the number of components from the fluid at run time.
+  // ---------------------------------------------------------------------------
+  template <class Fluid, int NQ>
+  int IntercellFlux(const Fluid &fluid, const double *pl, const double *pr,
+                    double *U, double *F, double s, int dim);
+
+  double IntercellFluxBatch(const double *PL, const double *PR, double *F,
+                            int n, int dim, int *fail);
+  template <class Fluid, int NQ>
+  double IntercellFluxBatch(const Fluid &fluid, const double *PL,
+                            const double *PR, double *F, int n, int dim,
+                            int *fail);
 } ;
 
+template <class Fluid, int NQ>
+int HllRiemannSolver::IntercellFlux(const Fluid &fluid,
+                                    const double *pl, const double *pr,
+                                    double *U, double *F, double s, int dim)
+{
+  enum { N = NQ ? NQ : 8 }; // Used for static array initialization
+  typedef FluidCalls<Fluid> Calls;
+
+  int i;
+  const int nq = NQ ? NQ : fluid.GetNq();
+  double epl=1, epr=1, eml=1, emr=1;
+  double Ul[N], Ur[N];
+  double Pl[N], Pr[N];
+  double Fl[N], Fr[N];
+
+  std::memcpy(Pl,pl,nq*sizeof(double));
+  std::memcpy(Pr,pr,nq*sizeof(double));
+
+  if (Calls::PrimToCons(fluid,Pl,Ul)) return 1;
+  if (Calls::PrimToCons(fluid,Pr,Ur)) return 1;
+
+  Calls::FluxAndEigenvalues(fluid, Ul, Pl, Fl, &epl, &eml, dim);
+  Calls::FluxAndEigenvalues(fluid, Ur, Pr, Fr, &epr, &emr, dim);
+
+  double ap = (epl>epr) ? epl : epr;
+  double am = (eml<emr) ? eml : emr;
+
+  double ml = (fabs(am)<fabs(ap)) ? fabs(ap) : fabs(am);
+  UpdateMaxLambda(ml);
+
+  double F_hll[N], U_hll[N];
+  for (i=0; i<nq; ++i) {
+    U_hll[i] = (ap*Ur[i] - am*Ul[i] +       (Fl[i] - Fr[i])) / (ap - am);
+    F_hll[i] = (ap*Fl[i] - am*Fr[i] + ap*am*(Ur[i] - Ul[i])) / (ap - am);
+  }
+
+  if (U) {
+    if      (         s<=am ) for (i=0; i<nq; ++i) U[i] = Ul   [i];
+    else if ( am<s && s<=ap ) for (i=0; i<nq; ++i) U[i] = U_hll[i];
+    else if ( ap<s          ) for (i=0; i<nq; ++i) U[i] = Ur   [i];
+  }
+  {
+    if      (         s<=am ) for (i=0; i<nq; ++i) F[i] = Fl   [i];
+    else if ( am<s && s<=ap ) for (i=0; i<nq; ++i) F[i] = F_hll[i];
+    else if ( ap<s          ) for (i=0; i<nq; ++i) F[i] = Fr   [i];
+  }
+
+  return 0;
+}
+
+template <class Fluid, int NQ>
+double HllRiemannSolver::IntercellFluxBatch(const Fluid &fluid,
+                                            const double *PL, const double *PR,
+                                            double *F, int n, int dim,
+                                            int *fail)
+// -----------------------------------------------------------------------------
+// Same arithmetic as IntercellFlux with s=0, over a pencil of n faces. The
+// conserved states, fluxes and eigenvalues on either side are obtained for a
+// block of faces at a time from the fluid's batch kernels, and the wavespeed
+// is returned rather than reported for each face.
+// -----------------------------------------------------------------------------
+{
+  enum { N = NQ ? NQ : 8, B = BATCH_SIZE };
+  typedef FluidBatchCalls<Fluid> Calls;
+
+  const int nq = NQ ? NQ : fluid.GetNq();
+  double epl[B], epr[B], eml[B], emr[B];
+  double Ul[B*N], Ur[B*N];
+  double Fl[B*N], Fr[B*N];
+  int fail_r[B];
+  double ml_max = 0.0;
+
+  for (int k0=0; k0<n; k0+=B) {
+    const int m = (n-k0 < B) ? n-k0 : B;
+    const double *Pl = &PL[k0*nq];
+    const double *Pr = &PR[k0*nq];
+
+    Calls::PrimToCons(fluid, Pl, Ul, m, nq, &fail[k0]);
+    Calls::PrimToCons(fluid, Pr, Ur, m, nq, fail_r);
+    Calls::FluxAndEigenvalues(fluid, Ul, Pl, Fl, epl, eml, m, nq, dim);
+    Calls::FluxAndEigenvalues(fluid, Ur, Pr, Fr, epr, emr, m, nq, dim);
+
+    for (int k=0; k<m; ++k) {
+      fail[k0+k] = (fail[k0+k] || fail_r[k]);
+      if (fail[k0+k]) continue;
+
+      const double ap = (epl[k]>epr[k]) ? epl[k] : epr[k];
+      const double am = (eml[k]<emr[k]) ? eml[k] : emr[k];
+      const double ml = (fabs(am)<fabs(ap)) ? fabs(ap) : fabs(am);
+      if (ml_max < ml) ml_max = ml;
+
+      const double *ul = &Ul[k*nq], *ur = &Ur[k*nq];
+      const double *fl = &Fl[k*nq], *fr = &Fr[k*nq];
+      double *f = &F[(k0+k)*nq];
+
+      if      (         0.0<=am ) for (int i=0; i<nq; ++i) f[i] = fl[i];
+      else if ( am<0.0 && 0.0<=ap ) {
+        for (int i=0; i<nq; ++i) {
+          f[i] = (ap*fl[i] - am*fr[i] + ap*am*(ur[i] - ul[i])) / (ap - am);
+        }
+      }
+      else if ( ap<0.0          ) for (int i=0; i<nq; ++i) f[i] = fr[i];
+    }
+  }
+
+  return ml_max;
+}
 
 #endif // __HllRiemanSolver_HEADER__
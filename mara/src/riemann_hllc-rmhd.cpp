@@ -63,11 +63,11 @@ int HllcRmhdRiemannSolver::IntercellFlux
 
   Pl[B1] = Pr[B1] = 0.5*(Pl[B1] + Pr[B1]); // Must have no normal jump in B
 
-  if (fluid.PrimToCons(Pl,Ul)) return 1;
-  if (fluid.PrimToCons(Pr,Ur)) return 1;
+  if (fluid.AdiabaticIdealRmhd::PrimToCons(Pl,Ul)) return 1;
+  if (fluid.AdiabaticIdealRmhd::PrimToCons(Pr,Ur)) return 1;
 
-  fluid.FluxAndEigenvalues(Ul, Pl, Fl, &epl, &eml, dim);
-  fluid.FluxAndEigenvalues(Ur, Pr, Fr, &epr, &emr, dim);
+  fluid.AdiabaticIdealRmhd::FluxAndEigenvalues(Ul, Pl, Fl, &epl, &eml, dim);
+  fluid.AdiabaticIdealRmhd::FluxAndEigenvalues(Ur, Pr, Fr, &epr, &emr, dim);
 
   Ul[tau] += Ul[ddd];  Fl[tau] += Fl[ddd]; // Change in convention of total energy
   Ur[tau] += Ur[ddd];  Fr[tau] += Fr[ddd];
@@ -76,7 +76,7 @@ int HllcRmhdRiemannSolver::IntercellFlux
   double am = (eml<emr) ? eml : emr;
 
   double ml = (fabs(am)<fabs(ap)) ? fabs(ap) : fabs(am);
-  if (MaxLambda < ml) MaxLambda = ml;
+  UpdateMaxLambda(ml);
 
   double F_hll[8], U_hll[8];
   for (i=0; i<8; ++i) {
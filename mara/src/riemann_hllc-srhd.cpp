@@ -55,11 +55,11 @@ int HllcSrhdRiemannSolver::IntercellFlux
   std::memcpy(Pl,pl,5*sizeof(double));
   std::memcpy(Pr,pr,5*sizeof(double));
 
-  if (fluid.PrimToCons(Pl,Ul)) return 1;
-  if (fluid.PrimToCons(Pr,Ur)) return 1;
+  if (fluid.AdiabaticIdealSrhd::PrimToCons(Pl,Ul)) return 1;
+  if (fluid.AdiabaticIdealSrhd::PrimToCons(Pr,Ur)) return 1;
 
-  fluid.FluxAndEigenvalues(Ul, Pl, Fl, &epl, &eml, dim);
-  fluid.FluxAndEigenvalues(Ur, Pr, Fr, &epr, &emr, dim);
+  fluid.AdiabaticIdealSrhd::FluxAndEigenvalues(Ul, Pl, Fl, &epl, &eml, dim);
+  fluid.AdiabaticIdealSrhd::FluxAndEigenvalues(Ur, Pr, Fr, &epr, &emr, dim);
 
   Ul[tau] += Ul[ddd];  Fl[tau] += Fl[ddd]; // Change in convention of total energy
   Ur[tau] += Ur[ddd];  Fr[tau] += Fr[ddd];
@@ -68,7 +68,7 @@ int HllcSrhdRiemannSolver::IntercellFlux
   double am = (eml<emr) ? eml : emr;
 
   double ml = (fabs(am)<fabs(ap)) ? fabs(ap) : fabs(am);
-  if (MaxLambda < ml) MaxLambda = ml;
+  UpdateMaxLambda(ml);
 
   double F_hll[5], U_hll[5];
   for (i=0; i<5; ++i) {
@@ -118,3 +118,115 @@ int HllcSrhdRiemannSolver::IntercellFlux
 
   return 0;
 }
+
+double HllcSrhdRiemannSolver::IntercellFluxBatch
+(const double *PL, const double *PR, double *F, int n, int dim, int *fail)
+// -----------------------------------------------------------------------------
+// Same arithmetic as IntercellFlux with s=0, over a pencil of n faces. The
+// conserved states, fluxes and eigenvalues on either side are obtained for a
+// block of faces at a time from the vectorized fluid kernels, and the
+// wavespeed is returned rather than reported for each face. Faces with a
+// superluminal state on either side are flagged in fail.
+// -----------------------------------------------------------------------------
+{
+  AdiabaticIdealSrhd &fluid = Mara->GetFluid<AdiabaticIdealSrhd>();
+
+  enum { B = BATCH_SIZE };
+  double epl[B], epr[B], eml[B], emr[B];
+  double Ulb[5*B], Urb[5*B];
+  double Flb[5*B], Frb[5*B];
+  int fail_r[B];
+  double ml_max = 0.0;
+
+  int S1=0,S2=0,S3=0;
+  int v1=0;
+
+  switch (dim) {
+  case 1:
+    S1=Sx; S2=Sy; S3=Sz;
+    v1=vx;
+    break;
+
+  case 2:
+    S1=Sy; S2=Sz; S3=Sx;
+    v1=vy;
+    break;
+
+  case 3:
+    S1=Sz; S2=Sx; S3=Sy;
+    v1=vz;
+    break;
+  }
+
+  for (int k0=0; k0<n; k0+=B) {
+    const int m = (n-k0 < B) ? n-k0 : B;
+    const double *Plb = &PL[5*k0];
+    const double *Prb = &PR[5*k0];
+
+    fluid.AdiabaticIdealSrhd::PrimToConsBatch(Plb, Ulb, m, &fail[k0]);
+    fluid.AdiabaticIdealSrhd::PrimToConsBatch(Prb, Urb, m, fail_r);
+
+    fluid.AdiabaticIdealSrhd::FluxAndEigenvaluesBatch(Ulb, Plb, Flb, epl, eml, m, dim);
+    fluid.AdiabaticIdealSrhd::FluxAndEigenvaluesBatch(Urb, Prb, Frb, epr, emr, m, dim);
+
+    for (int k=0; k<m; ++k) {
+      fail[k0+k] = (fail[k0+k] || fail_r[k]);
+      if (fail[k0+k]) continue;
+
+      const double *Pl = &Plb[5*k], *Pr = &Prb[5*k];
+      double *Ul = &Ulb[5*k], *Ur = &Urb[5*k];
+      double *Fl = &Flb[5*k], *Fr = &Frb[5*k];
+      double *Fk = &F[5*(k0+k)];
+      int i;
+
+      Ul[tau] += Ul[ddd];  Fl[tau] += Fl[ddd]; // Change in convention of total energy
+      Ur[tau] += Ur[ddd];  Fr[tau] += Fr[ddd];
+
+      double ap = (epl[k]>epr[k]) ? epl[k] : epr[k];
+      double am = (eml[k]<emr[k]) ? eml[k] : emr[k];
+
+      double ml = (fabs(am)<fabs(ap)) ? fabs(ap) : fabs(am);
+      if (ml_max < ml) ml_max = ml;
+
+      double F_hll[5], U_hll[5];
+      for (i=0; i<5; ++i) {
+        U_hll[i] = (ap*Ur[i] - am*Ul[i] +       (Fl[i] - Fr[i])) / (ap - am);
+        F_hll[i] = (ap*Fl[i] - am*Fr[i] + ap*am*(Ur[i] - Ul[i])) / (ap - am);
+      }
+
+      double Ul_[5], Ur_[5], lc; // The star states
+
+      const double a =  F_hll[tau];
+      const double b = -F_hll[S1 ] - U_hll[tau];
+      const double c =  U_hll[S1 ];
+
+      const double v1_ = lc = (fabs(a) < SMALL_A) ? -c/b : (-b - sqrt(b*b - 4*a*c)) / (2*a);
+      const double p_  = -F_hll[tau]*v1_ + F_hll[S1];
+
+      Ul_[ddd] = (am - Pl[v1]) / (am - v1_) * Ul[ddd];
+      Ur_[ddd] = (ap - Pr[v1]) / (ap - v1_) * Ur[ddd];
+
+      Ul_[tau] = (am*Ul[tau] - Ul[S1] + p_*v1_) / (am - v1_);
+      Ur_[tau] = (ap*Ur[tau] - Ur[S1] + p_*v1_) / (ap - v1_);
+
+      Ul_[S1 ] = (Ul_[tau] + p_)*v1_;
+      Ur_[S1 ] = (Ur_[tau] + p_)*v1_;
+
+      Ul_[S2 ] = (am - Pl[v1]) / (am - v1_) * Ul[S2];
+      Ur_[S2 ] = (ap - Pr[v1]) / (ap - v1_) * Ur[S2];
+
+      Ul_[S3 ] = (am - Pl[v1]) / (am - v1_) * Ul[S3];
+      Ur_[S3 ] = (ap - Pr[v1]) / (ap - v1_) * Ur[S3];
+
+      const double s = 0.0;
+      if      (         s<=am ) for (i=0; i<5; ++i) Fk[i] = Fl[i];
+      else if ( am<s && s<=lc ) for (i=0; i<5; ++i) Fk[i] = Fl[i] + am*(Ul_[i]-Ul[i]);
+      else if ( lc<s && s<=ap ) for (i=0; i<5; ++i) Fk[i] = Fr[i] + ap*(Ur_[i]-Ur[i]);
+      else if ( ap<s          ) for (i=0; i<5; ++i) Fk[i] = Fr[i];
+
+      Fk[tau] -= Fk[ddd]; // Change in convention of total energy
+    }
+  }
+
+  return ml_max;
+}
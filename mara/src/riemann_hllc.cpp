@@ -5,23 +5,28 @@
 int HllcRiemannSolver::IntercellFlux(const double *pl, const double *pr, double *U,
                                      double *F, double s, int dim)
 {
-  FluidEquations &fluid = *Mara->fluid;
-  RiemannSolver *riemann;
+  return SolverFor(*Mara->fluid).IntercellFlux(pl, pr, U, F, s, dim);
+}
+
+double HllcRiemannSolver::IntercellFluxBatch(const double *PL, const double *PR,
+                                             double *F, int n, int dim,
+                                             int *fail)
+{
+  return SolverFor(*Mara->fluid).IntercellFluxBatch(PL, PR, F, n, dim, fail);
+}
 
+RiemannSolver &HllcRiemannSolver::SolverFor(const FluidEquations &fluid)
+{
   if      (typeid(fluid) == typeid(AdiabaticIdealEulers)) {
-    riemann = new HllcEulersRiemannSolver;
+    return eulers_solver;
   }
   else if (typeid(fluid) == typeid(AdiabaticIdealSrhd)) {
-    riemann = new HllcSrhdRiemannSolver;
+    return srhd_solver;
   }
   else if (typeid(fluid) == typeid(AdiabaticIdealRmhd)) {
-    riemann = new HllcRmhdRiemannSolver;
+    return rmhd_solver;
   }
   else {
     throw std::bad_typeid();
   }
-
-  int error = riemann->IntercellFlux(pl, pr, U, F, s, dim);
-  delete riemann;
-  return error;
 }
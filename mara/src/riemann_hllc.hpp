@@ -8,32 +8,48 @@
 #include "rmhd.hpp"
 
 
-class HllcRiemannSolver : public RiemannSolver
+class HllcEulersRiemannSolver : public RiemannSolver
 {
 public:
   int IntercellFlux(const double *pl, const double *pr, double *U,
 		    double *F, double s, int dim);
+  double IntercellFluxBatch(const double *PL, const double *PR, double *F,
+                            int n, int dim, int *fail);
 } ;
 
-class HllcEulersRiemannSolver : public RiemannSolver
+class HllcSrhdRiemannSolver : public RiemannSolver
 {
 public:
   int IntercellFlux(const double *pl, const double *pr, double *U,
-		    double *F, double s, int dim);
+                    double *F, double s, int dim);
+  double IntercellFluxBatch(const double *PL, const double *PR, double *F,
+                            int n, int dim, int *fail);
 } ;
 
-class HllcSrhdRiemannSolver : public RiemannSolver
+class HllcRmhdRiemannSolver : public RiemannSolver
 {
 public:
   int IntercellFlux(const double *pl, const double *pr, double *U,
-                    double *F, double s, int dim);
+		    double *F, double s, int dim);
 } ;
 
-class HllcRmhdRiemannSolver : public RiemannSolver
+class HllcRiemannSolver : public RiemannSolver
+// -----------------------------------------------------------------------------
+// Forwards to the HLLC solver for the fluid in use. The solvers are stateless,
+// so one of each is held for the lifetime of this object.
+// -----------------------------------------------------------------------------
 {
+private:
+  HllcEulersRiemannSolver eulers_solver;
+  HllcSrhdRiemannSolver srhd_solver;
+  HllcRmhdRiemannSolver rmhd_solver;
+
 public:
   int IntercellFlux(const double *pl, const double *pr, double *U,
 		    double *F, double s, int dim);
+  double IntercellFluxBatch(const double *PL, const double *PR, double *F,
+                            int n, int dim, int *fail);
+  RiemannSolver &SolverFor(const FluidEquations &fluid);
 } ;
 
 
@@ -14,18 +14,53 @@
  */
 
 #include <cstdio>
+#include <cmath>
 #include "nrsolver.hpp"
 #include "secant.hpp"
 #include "riemann_hlld-rmhd.hpp"
 #include "riemann_hllc.hpp"
 #include "config.h"
 
-static double PrimFromHllState[8];
-static double ConsFromHllState[8];
-static double FluxFromHllState[8];
+typedef HlldRmhdRiemannSolver Hlld;
 
-int HlldRmhdRiemannSolver::NumberOfSuccess = 0;
-int HlldRmhdRiemannSolver::NumberOfFailure = 0;
+double Hlld::smooth_hll = 0.0;
+double Hlld::smooth_hllc = 0.0;
+
+
+double Hlld::JumpIndicator(const double *pl, const double *pr, int dim)
+// -----------------------------------------------------------------------------
+// A cheap measure of how far the states on either side of a face are from one
+// another: the largest of the relative jumps in density and gas pressure, the
+// jump in normal velocity, and the energy in the jump of the transverse
+// magnetic field relative to the total pressure. It is infinite for states
+// with non-positive density or pressure, which are left to HLLD to reject.
+// -----------------------------------------------------------------------------
+{
+  if (!(pl[rho] > 0.0 && pr[rho] > 0.0 && pl[pre] > 0.0 && pr[pre] > 0.0)) {
+    return HUGE_VAL;
+  }
+
+  const int v1 = vx + (dim - 1);
+  const int B2 = Bx + (dim % 3);
+  const int B3 = Bx + (dim + 1) % 3;
+
+  const double Bl2 = pl[Bx]*pl[Bx] + pl[By]*pl[By] + pl[Bz]*pl[Bz];
+  const double Br2 = pr[Bx]*pr[Bx] + pr[By]*pr[By] + pr[Bz]*pr[Bz];
+  const double dB2 = pr[B2] - pl[B2];
+  const double dB3 = pr[B3] - pl[B3];
+
+  const double jumps[4] = {
+    fabs(pr[rho] - pl[rho]) / (pl[rho] < pr[rho] ? pl[rho] : pr[rho]),
+    fabs(pr[pre] - pl[pre]) / (pl[pre] < pr[pre] ? pl[pre] : pr[pre]),
+    fabs(pr[v1] - pl[v1]),
+    (dB2*dB2 + dB3*dB3) / (Bl2 + Br2 + pl[pre] + pr[pre]) };
+
+  double J = 0.0;
+  for (int k=0; k<4; ++k) {
+    if (J < jumps[k]) J = jumps[k];
+  }
+  return J;
+}
 
 
 class HlldEquation48 : public EquationSystemBaseClass
@@ -48,6 +83,8 @@ private:
   const double *Pl, *Pr;
   double *Ul, *Ur;
   double *Fl, *Fr;
+  const double *P_hll;
+  double *U_hll, *F_hll;
   const double ap, am;
   HlldOuterwaveJumpState L, R;
 
@@ -55,6 +92,7 @@ public:
   HlldEquation48(const double *Pl, const double *Pr,
                  double *Ul, double *Ur,
                  double *Fl, double *Fr,
+                 const double *P_hll, double *U_hll, double *F_hll,
                  double ap, double am);
   void Function(const double *x, double *y) const;
   void Jacobian(const double *x, double *J) const;
@@ -145,6 +183,21 @@ int HlldRmhdRiemannSolver::IntercellFlux(const double *pl, const double *pr, dou
 {
   AdiabaticIdealRmhd &fluid = Mara->GetFluid<AdiabaticIdealRmhd>();
 
+  // Smooth faces are sent to the cheaper solvers before anything else is done.
+  // ---------------------------------------------------------------------------
+  if (smooth_hll > 0.0 || smooth_hllc > 0.0) {
+    const double J = JumpIndicator(pl, pr, dim);
+    if (J < smooth_hll) {
+      CountStatistic(STAT_HLL);
+      return hll.IntercellFlux<AdiabaticIdealRmhd, 8>(fluid, pl, pr, u, f, s, dim);
+    }
+    if (J < smooth_hllc) {
+      CountStatistic(STAT_HLLC);
+      return hllc.HllcRmhdRiemannSolver::IntercellFlux(pl, pr, u, f, s, dim);
+    }
+  }
+  CountStatistic(STAT_HLLD);
+
   // Convention here is that user input variables u,f,pl/pr are lower case, and
   // get indexed with B1,B2,B3 etc. Local variables U,F,Pl/Pr are input for HLLD
   // and get indexed with Bx,By,Bz etc. HLLD expects all intercell fluxes to be
@@ -191,36 +244,34 @@ int HlldRmhdRiemannSolver::IntercellFlux(const double *pl, const double *pr, dou
 
   Pl[Bx] = Pr[Bx] = 0.5*(pl[B1] + pr[B1]); // This is to prevent jumps in Bx
 
-  if (fluid.PrimToCons(Pl, Ul)) return 1;
-  if (fluid.PrimToCons(Pr, Ur)) return 1;
+  if (fluid.AdiabaticIdealRmhd::PrimToCons(Pl, Ul)) return 1;
+  if (fluid.AdiabaticIdealRmhd::PrimToCons(Pr, Ur)) return 1;
 
-  fluid.FluxAndEigenvalues(Ul, Pl, Fl, &epl, &eml, 1);
-  fluid.FluxAndEigenvalues(Ur, Pr, Fr, &epr, &emr, 1);
+  fluid.AdiabaticIdealRmhd::FluxAndEigenvalues(Ul, Pl, Fl, &epl, &eml, 1);
+  fluid.AdiabaticIdealRmhd::FluxAndEigenvalues(Ur, Pr, Fr, &epr, &emr, 1);
 
   const double am = (eml<emr) ? eml : emr;
   const double ap = (epl>epr) ? epl : epr;
 
   double ml = (fabs(am)<fabs(ap)) ? fabs(ap) : fabs(am);
-  if (MaxLambda < ml) MaxLambda = ml;
+  UpdateMaxLambda(ml);
 
-  double *P_hll = PrimFromHllState;
-  double *U_hll = ConsFromHllState;
-  double *F_hll = FluxFromHllState;
+  double P_hll[8], U_hll[8], F_hll[8];
 
   for (i=0; i<8; ++i) {
     P_hll[i] = 0.5*(Pl[i] + Pr[i]);
     U_hll[i] = (ap*Ur[i] - am*Ul[i] +       (Fl[i] - Fr[i])) / (ap - am);
     F_hll[i] = (ap*Fl[i] - am*Fr[i] + ap*am*(Ur[i] - Ul[i])) / (ap - am);
   }
-  const int hll_c2p_failed = fluid.ConsToPrim(U_hll, P_hll);
+  const int hll_c2p_failed = fluid.AdiabaticIdealRmhd::ConsToPrim(U_hll, P_hll);
 
   double U[8], F[8];
-  HlldEquation48 eqn(Pl, Pr, Ul, Ur, Fl, Fr, ap, am);
+  HlldEquation48 eqn(Pl, Pr, Ul, Ur, Fl, Fr, P_hll, U_hll, F_hll, ap, am);
 
   NewtonRaphesonSolver solver1(15, 1e-12);
   SecantMethodSolver   solver2(15, 1e-12);
 
-  int Attempt=0, HlldSuccess=0;
+  int Attempt=0, HlldSuccess=0, Solving=0;
   double p_star;
 
   while (!hll_c2p_failed && Attempt < 3 && !HlldSuccess) {
@@ -231,7 +282,10 @@ int HlldRmhdRiemannSolver::IntercellFlux(const double *pl, const double *pr, dou
       }
       else {
         p_star = eqn.EstimateSolution(Attempt);
+        Solving = 1;
         solver1.Solve(eqn, &p_star);
+        Solving = 0;
+        CountStatistic(STAT_HLLD_ITERATIONS, solver1.GetIterations());
         eqn.ReconstructSolution(p_star, U, F, s);
       }
       HlldSuccess = true;
@@ -239,11 +293,14 @@ int HlldRmhdRiemannSolver::IntercellFlux(const double *pl, const double *pr, dou
     catch (const HlldEquation48::Failure &e) { }
     catch (const NewtonRaphesonSolver::Failure &e) { }
 
+    if (Solving) {
+      CountStatistic(STAT_HLLD_ITERATIONS, solver1.GetIterations());
+      Solving = 0;
+    }
     ++Attempt;
   }
 
   if (HlldSuccess) {
-    ++NumberOfSuccess;
 
     // Flux / Conserved states rotated back
     // ---------------------------------------------------------------------------
@@ -270,20 +327,22 @@ int HlldRmhdRiemannSolver::IntercellFlux(const double *pl, const double *pr, dou
     return 0;
   }
   else {
-    ++NumberOfFailure;
-    HllcRmhdRiemannSolver hllc;
-    return hllc.IntercellFlux(pl, pr, u, f, s, dim);
+    CountStatistic(STAT_HLLD_FAILED);
+    return hllc.HllcRmhdRiemannSolver::IntercellFlux(pl, pr, u, f, s, dim);
   }
 }
 
 HlldEquation48::HlldEquation48(const double *Pl, const double *Pr,
                                double *Ul, double *Ur,
                                double *Fl, double *Fr,
+                               const double *P_hll, double *U_hll,
+                               double *F_hll,
                                double ap, double am)
   : EquationSystemBaseClass(1),
     Pl(Pl), Pr(Pr),
     Ul(Ul), Ur(Ur),
     Fl(Fl), Fr(Fr),
+    P_hll(P_hll), U_hll(U_hll), F_hll(F_hll),
     ap(ap), am(am)
 {
   // Change the convention of total energy to be consistent with Mignone
@@ -542,7 +601,7 @@ double HlldEquation48::EstimateSolution(int attempt)
   // Try the HLL total pressure of the input states first
   // ---------------------------------------------------------------------------
   if (attempt == 0) {
-    const double *P   =   PrimFromHllState;
+    const double *P   =   P_hll;
     const double V2   =   P[vx]*P[vx] + P[vy]*P[vy] + P[vz]*P[vz];
     const double B2   =   P[Bx]*P[Bx] + P[By]*P[By] + P[Bz]*P[Bz];
     const double Bv   =   P[Bx]*P[vx] + P[By]*P[vy] + P[Bz]*P[vz];
@@ -556,9 +615,6 @@ double HlldEquation48::EstimateSolution(int attempt)
   // Next try equation (55)
   // ---------------------------------------------------------------------------
   else if (attempt == 1) {
-    double *F_hll = FluxFromHllState;
-    double *U_hll = ConsFromHllState;
-
     F_hll[tau] += F_hll[ddd];
     U_hll[tau] += U_hll[ddd];
 
@@ -17,17 +17,31 @@
 #define __HlldmhdRiemannSolver_HEADER__
 
 #include "rmhd.hpp"
+#include "riemann_hll.hpp"
+#include "riemann_hllc.hpp"
 
 class HlldRmhdRiemannSolver : public RiemannSolver
+// -----------------------------------------------------------------------------
+// Faces across which JumpIndicator is below smooth_hll are handed to the HLL
+// solver, and those below smooth_hllc to HLLC, keeping HLLD for the
+// discontinuities. Both thresholds are zero by default, so that every face is
+// solved with HLLD. The faces sent to each solver are counted in the
+// RiemannSolver statistics.
+// -----------------------------------------------------------------------------
 {
 public:
-  static int NumberOfSuccess;
-  static int NumberOfFailure;
+  static double smooth_hll;
+  static double smooth_hllc;
+
+  static double JumpIndicator(const double *pl, const double *pr, int dim);
 
 private:
   enum { ddd, tau, Sx, Sy, Sz, Bx, By, Bz }; // Conserved
   enum { rho, pre, vx, vy, vz };             // Primitive
 
+  HllRiemannSolver hll;
+  HllcRmhdRiemannSolver hllc;
+
 public:
   int IntercellFlux(const double *Pl, const double *Pr, double *U,
                     double *F, double s, int dim);
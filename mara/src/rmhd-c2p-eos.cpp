@@ -41,9 +41,10 @@
 enum { ddd, tau, Sx, Sy, Sz, Bx, By, Bz }; // Conserved
 enum { rho, pre, vx, vy, vz };             // Primitive
 
-static int WsolveWKT(double *W , double *gamma, double *T,
+static int WsolveWKT(rmhd_c2p_context *c, double *W , double *gamma, double *T,
                      double qdotn, double qdotb, double Q2, double B2, double D);
-static void fghWKT(double W, double K, double T,
+static void fghWKT(const EquationOfState *eos,
+                   double W, double K, double T,
                    double *deltaW, double *deltaK, double *deltaT,
                    double qdotn, double qdotb,
                    double Q2, double B2, double D,
@@ -57,8 +58,6 @@ static const double smlZ =  0.0;
 static const double bigT = +10.0;
 static const double smlT = -10.0;
 
-static int Iterations = 0;
-
 
 #define NR_ERROR (fabs(deltax/x) + deltay*deltay/y/y + deltaz*deltaz/z/z)
 #define YMAX 1e14
@@ -68,50 +67,45 @@ using std::isinf;
 
 static const int verbose = 0;
 static const double NR_TOL = 1e-14;
-static const EquationOfState *eos = NULL;
 
-static double D,Tau;
-static double S2,B2,BS,BS2;
-static double Cons[8];
-static double Z_start, W_start, T_start;
+static rmhd_c2p_context DefaultContext = { 1.4 };
 
+static inline const EquationOfState *context_eos(const rmhd_c2p_context *c)
+{
+  return static_cast<const EquationOfState*>(c->eos);
+}
 
-void rmhd_c2p_eos_set_eos(const void *eos_)
+
+void rmhd_c2p_eos_set_eos_r(rmhd_c2p_context *c, const void *eos_)
 {
-  eos = static_cast<const EquationOfState*>(eos_);
+  c->eos = eos_;
 }
-void rmhd_c2p_eos_new_state(const double *U)
+void rmhd_c2p_eos_new_state_r(rmhd_c2p_context *c, const double *U)
 {
-  D    = U[ddd];
-  Tau  = U[tau];
-  S2   = U[Sx]*U[Sx] + U[Sy]*U[Sy] + U[Sz]*U[Sz];
-  B2   = U[Bx]*U[Bx] + U[By]*U[By] + U[Bz]*U[Bz];
-  BS   = U[Bx]*U[Sx] + U[By]*U[Sy] + U[Bz]*U[Sz];
-  BS2  = BS*BS;
-
-  memcpy(Cons, U, 8*sizeof(double));
+  rmhd_c2p_new_state_r(c, U);
 }
-int rmhd_c2p_eos_get_iterations()
+int rmhd_c2p_eos_get_iterations_r(const rmhd_c2p_context *c)
 {
-  return Iterations;
+  return c->Iterations;
 }
 
 // This estimate becomes exact for no magnetic field in the NR limit.
 // -----------------------------------------------------------------------------
-void rmhd_c2p_eos_estimate_from_cons()
+void rmhd_c2p_eos_estimate_from_cons_r(rmhd_c2p_context *c)
 {
-  W_start = 1.0;
-  Z_start = sqrt(S2 + D*D);
-  T_start = eos->Temperature_u(D, Tau - 0.5*B2);
+  c->W_start = 1.0;
+  c->Z_start = sqrt(c->S2 + c->D*c->D);
+  c->T_start = context_eos(c)->Temperature_u(c->D, c->Tau - 0.5*c->B2);
 }
-void rmhd_c2p_eos_set_starting_prim(const double *P)
+void rmhd_c2p_eos_set_starting_prim_r(rmhd_c2p_context *c, const double *P)
 {
+  const EquationOfState *eos = context_eos(c);
   const double V2 = P[vx]*P[vx] + P[vy]*P[vy] + P[vz]*P[vz];
   const double W2 = 1.0 / (1.0 - V2);
 
-  W_start = sqrt(W2);
-  T_start = eos->Temperature_p(P[rho], P[pre]);
-  Z_start = (P[rho] + eos->Internal(P[rho], T_start) + P[pre])*W2;
+  c->W_start = sqrt(W2);
+  c->T_start = eos->Temperature_p(P[rho], P[pre]);
+  c->Z_start = (P[rho] + eos->Internal(P[rho], c->T_start) + P[pre])*W2;
 }
 
 
@@ -120,20 +114,24 @@ void rmhd_c2p_eos_set_starting_prim(const double *P)
 // Solution based on Noble et. al. (2006), using Z = rho h W^2 and T as the
 // unkowns.
 // -----------------------------------------------------------------------------
-int rmhd_c2p_eos_solve_noble2dzt(double *Pout)
+int rmhd_c2p_eos_solve_noble2dzt_r(rmhd_c2p_context *c, double *Pout)
 {
-  int bad_input = rmhd_c2p_check_cons(Cons);
+  const EquationOfState *eos = context_eos(c);
+  const double D = c->D, Tau = c->Tau;
+  const double S2 = c->S2, B2 = c->B2, BS = c->BS, BS2 = c->BS2;
+
+  int bad_input = rmhd_c2p_check_cons(c->Cons);
   if (bad_input) {
     return bad_input;
   }
 
   // Starting values
   // ---------------------------------------------------------------------------
-  Iterations = 0;
+  int Iterations = 0;
 
   double error = 1.0;
-  double Z = Z_start;
-  double T = T_start;
+  double Z = c->Z_start;
+  double T = c->T_start;
 
   while (error > Tolerance) {
     double Jp[2], Ju[2];
@@ -154,8 +152,8 @@ int rmhd_c2p_eos_solve_noble2dzt(double *Pout)
       //      printf("internal superluminal: %e %e %e %e %e %e\n", Z, T, W2, V2, a, b);
     }
 
-    const double p = eos->Derivatives_p(D/W, T, Jp);
-    const double u = eos->Derivatives_u(D/W, T, Ju);
+    double p, u;
+    eos->Derivatives_pu(D/W, T, &p, &u, Jp, Ju);
 
     const double dpdRho = Jp[0];
     const double dudRho = Ju[0];
@@ -211,7 +209,7 @@ int rmhd_c2p_eos_solve_noble2dzt(double *Pout)
 
     // -------------------------------------------------------------------------
     error = fabs(dZ/Z) + fabs(dT/T);
-    ++Iterations;
+    c->Iterations = ++Iterations;
 
     if (Iterations == MaxIteration) {
       return RMHD_C2P_MAXITER;
@@ -230,7 +228,7 @@ int rmhd_c2p_eos_solve_noble2dzt(double *Pout)
   const double b0  = BS * W / Z;
 
   double P[8];
-  const double *U = Cons;
+  const double *U = c->Cons;
 
   P[rho] =  Rho;
   P[pre] =  eos->Pressure(Rho, T);
@@ -254,13 +252,17 @@ int rmhd_c2p_eos_solve_noble2dzt(double *Pout)
 
 
 
-int rmhd_c2p_eos_solve_duffell3d(double *Pout)
+int rmhd_c2p_eos_solve_duffell3d_r(rmhd_c2p_context *c, double *Pout)
 {
-  double Z = Z_start;
-  double T = T_start;
-  double W = W_start;
+  const EquationOfState *eos = context_eos(c);
+  const double D = c->D, Tau = c->Tau;
+  const double S2 = c->S2, B2 = c->B2, BS = c->BS;
 
-  if (WsolveWKT(&Z, &W, &T, -(D+Tau), BS, S2, B2, D)) {
+  double Z = c->Z_start;
+  double T = c->T_start;
+  double W = c->W_start;
+
+  if (WsolveWKT(c, &Z, &W, &T, -(D+Tau), BS, S2, B2, D)) {
     return RMHD_C2P_MAXITER;
   }
 
@@ -268,7 +270,7 @@ int rmhd_c2p_eos_solve_duffell3d(double *Pout)
   const double b0 = BS * W / Z;
 
   double P[8];
-  const double *U = Cons;
+  const double *U = c->Cons;
 
   P[rho] =  Rho;
   P[pre] =  eos->Pressure(Rho, T);
@@ -292,7 +294,8 @@ int rmhd_c2p_eos_solve_duffell3d(double *Pout)
 
 
 
-void fghWKT(double W, double K, double T,
+void fghWKT(const EquationOfState *eos,
+            double W, double K, double T,
             double *deltaW, double *deltaK, double *deltaT,
             double qdotn, double qdotb,
             double Q2, double B2, double D,
@@ -302,9 +305,9 @@ void fghWKT(double W, double K, double T,
   double v2 = K/(K+1.0);
   double Rho = D/gamm;
   double Ju[2], Jp[2];
+  double u, P;
 
-  double u = eos->Derivatives_u(Rho, T, Ju);
-  double P = eos->Derivatives_p(Rho, T, Jp);
+  eos->Derivatives_pu(Rho, T, &P, &u, Jp, Ju);
 
   double dudrho = Ju[0];
   double dudT   = Ju[1];
@@ -352,9 +355,11 @@ void fghWKT(double W, double K, double T,
   *herr = h/W;
 }
 
-int WsolveWKT(double *W, double *gamma, double *T,
+int WsolveWKT(rmhd_c2p_context *c, double *W, double *gamma, double *T,
               double qdotn, double qdotb, double Q2, double B2, double D)
 {
+  const EquationOfState *eos = context_eos(c);
+  int &Iterations = c->Iterations;
   Iterations = 0;
 
   int fail   = 0;
@@ -375,7 +380,7 @@ int WsolveWKT(double *W, double *gamma, double *T,
 
   while (error>NR_TOL && fail==0) {
 
-    fghWKT(x,y,z,&deltax,&deltay,&deltaz,qdotn,qdotb,Q2,B2,D,&err1,&err2,&err3);
+    fghWKT(eos,x,y,z,&deltax,&deltay,&deltaz,qdotn,qdotb,Q2,B2,D,&err1,&err2,&err3);
     count++;
     error = NR_ERROR;
 
@@ -416,7 +421,7 @@ int WsolveWKT(double *W, double *gamma, double *T,
 
     while (error>NR_TOL && fail==0) {
 
-      fghWKT(x,y,z,&deltax,&deltay,&deltaz,qdotn,qdotb,Q2,B2,D,&err1,&err2,&err3);
+      fghWKT(eos,x,y,z,&deltax,&deltay,&deltaz,qdotn,qdotb,Q2,B2,D,&err1,&err2,&err3);
       count++;
       error = NR_ERROR;
 
@@ -458,7 +463,7 @@ int WsolveWKT(double *W, double *gamma, double *T,
 
     while (error>NR_TOL && fail==0) {
 
-      fghWKT(x,y,z,&deltax,&deltay,&deltaz,qdotn,qdotb,Q2,B2,D,&err1,&err2,&err3);
+      fghWKT(eos,x,y,z,&deltax,&deltay,&deltaz,qdotn,qdotb,Q2,B2,D,&err1,&err2,&err3);
       count++;
       error = NR_ERROR;
 
@@ -486,7 +491,7 @@ int WsolveWKT(double *W, double *gamma, double *T,
 
   for (count=0; count<Nextra; count++) {
 
-    fghWKT(x,y,z,&deltax,&deltay,&deltaz,qdotn,qdotb,Q2,B2,D,&err1,&err2,&err3);
+    fghWKT(eos,x,y,z,&deltax,&deltay,&deltaz,qdotn,qdotb,Q2,B2,D,&err1,&err2,&err3);
     double test = deltax + deltay + deltaz;
 
     if (isnan(test) || isinf(test)) {
@@ -523,3 +528,36 @@ int WsolveWKT(double *W, double *gamma, double *T,
 
   return 0;
 }
+
+
+
+// Stateful interface, operating on DefaultContext
+// -----------------------------------------------------------------------------
+void rmhd_c2p_eos_set_eos(const void *eos_)
+{
+  rmhd_c2p_eos_set_eos_r(&DefaultContext, eos_);
+}
+void rmhd_c2p_eos_new_state(const double *U)
+{
+  rmhd_c2p_eos_new_state_r(&DefaultContext, U);
+}
+int rmhd_c2p_eos_get_iterations()
+{
+  return rmhd_c2p_eos_get_iterations_r(&DefaultContext);
+}
+void rmhd_c2p_eos_estimate_from_cons()
+{
+  rmhd_c2p_eos_estimate_from_cons_r(&DefaultContext);
+}
+void rmhd_c2p_eos_set_starting_prim(const double *P)
+{
+  rmhd_c2p_eos_set_starting_prim_r(&DefaultContext, P);
+}
+int rmhd_c2p_eos_solve_noble2dzt(double *P)
+{
+  return rmhd_c2p_eos_solve_noble2dzt_r(&DefaultContext, P);
+}
+int rmhd_c2p_eos_solve_duffell3d(double *P)
+{
+  return rmhd_c2p_eos_solve_duffell3d_r(&DefaultContext, P);
+}
@@ -22,6 +22,10 @@
  * promise not to modify the pointer to result primitives unless the execution
  * is successful.
  *
+ * Each function ending in _r operates on the rmhd_c2p_context it is passed, and
+ * touches no other mutable state. The functions without the suffix operate on
+ * a context private to this file.
+ *
  * ------------------------------------------------------------------------------
  */
 
@@ -44,77 +48,82 @@ static const double bigW = 1e12;
 static const double smlZ = 0.0;
 static const double smlW = 1.0;
 
-static int Iterations = 0;
-static double AdiabaticGamma = 1.4;
-static double gamf;
-static double D,Tau;
-static double S2,B2,BS,BS2;
-static double Cons[8];
-static double Z_start, W_start;
+static rmhd_c2p_context DefaultContext = { 1.4 };
 
 
 
 
-// Set method for the adiabatic index (defaults to 1.4)
+// Initialize a context, with the adiabatic index defaulting to 1.4
 // -----------------------------------------------------------------------------
-void rmhd_c2p_set_gamma(double adiabatic_gamma)
+void rmhd_c2p_context_init(rmhd_c2p_context *c)
+{
+  memset(c, 0, sizeof(rmhd_c2p_context));
+  rmhd_c2p_set_gamma_r(c, 1.4);
+}
+
+// Set method for the adiabatic index
+// -----------------------------------------------------------------------------
+void rmhd_c2p_set_gamma_r(rmhd_c2p_context *c, double adiabatic_gamma)
 {
-  AdiabaticGamma = adiabatic_gamma;
-  gamf = (AdiabaticGamma - 1.0) / AdiabaticGamma;
+  c->AdiabaticGamma = adiabatic_gamma;
+  c->gamf = (c->AdiabaticGamma - 1.0) / c->AdiabaticGamma;
 }
 
 // Get method for the iterations on the last execution
 // -----------------------------------------------------------------------------
-int rmhd_c2p_get_iterations()
+int rmhd_c2p_get_iterations_r(const rmhd_c2p_context *c)
 {
-  return Iterations;
+  return c->Iterations;
 }
 
 // Provide a new conserved state in memory. Before the solver is executed, the
 // user must provide a guess for the initial primitive state, by calling either
 // estimate_from_cons() or set_starting_prim(P).
 // -----------------------------------------------------------------------------
-void rmhd_c2p_new_state(const double *U)
+void rmhd_c2p_new_state_r(rmhd_c2p_context *c, const double *U)
 {
-  D    = U[ddd];
-  Tau  = U[tau];
-  S2   = U[Sx]*U[Sx] + U[Sy]*U[Sy] + U[Sz]*U[Sz];
-  B2   = U[Bx]*U[Bx] + U[By]*U[By] + U[Bz]*U[Bz];
-  BS   = U[Bx]*U[Sx] + U[By]*U[Sy] + U[Bz]*U[Sz];
-  BS2  = BS*BS;
-
-  memcpy(Cons, U, 8*sizeof(double));
+  c->D    = U[ddd];
+  c->Tau  = U[tau];
+  c->S2   = U[Sx]*U[Sx] + U[Sy]*U[Sy] + U[Sz]*U[Sz];
+  c->B2   = U[Bx]*U[Bx] + U[By]*U[By] + U[Bz]*U[Bz];
+  c->BS   = U[Bx]*U[Sx] + U[By]*U[Sy] + U[Bz]*U[Sz];
+  c->BS2  = c->BS*c->BS;
+
+  memcpy(c->Cons, U, 8*sizeof(double));
 }
 
 // This estimate becomes exact for no magnetic field in the NR limit.
 // -----------------------------------------------------------------------------
-void rmhd_c2p_estimate_from_cons()
+void rmhd_c2p_estimate_from_cons_r(rmhd_c2p_context *c)
 {
-  Z_start = sqrt(S2 + D*D);
-  W_start = Z_start / D;
+  c->Z_start = sqrt(c->S2 + c->D*c->D);
+  c->W_start = c->Z_start / c->D;
 }
-void rmhd_c2p_get_starting_prim(double *P)
+void rmhd_c2p_get_starting_prim_r(rmhd_c2p_context *c, double *P)
 {
-  rmhd_c2p_reconstruct_prim(Z_start, W_start, P);
+  rmhd_c2p_reconstruct_prim_r(c, c->Z_start, c->W_start, P);
 }
 
 // Explicitly provide a guess to be used at the initial iteration.
 // -----------------------------------------------------------------------------
-void rmhd_c2p_set_starting_prim(const double *P)
+void rmhd_c2p_set_starting_prim_r(rmhd_c2p_context *c, const double *P)
 {
   const double V2 = P[vx]*P[vx] + P[vy]*P[vy] + P[vz]*P[vz];
   const double W2 = 1.0 / (1.0 - V2);
-  const double e = P[pre] / (P[rho] * (AdiabaticGamma - 1.0));
+  const double e = P[pre] / (P[rho] * (c->AdiabaticGamma - 1.0));
   const double h = 1.0 + e + P[pre] / P[rho];
 
-  Z_start = P[rho] * h * W2;
-  W_start = sqrt(W2);
+  c->Z_start = P[rho] * h * W2;
+  c->W_start = sqrt(W2);
 }
 
 // Using Z=rho*h*W^2, and W, get the primitive variables.
 // -----------------------------------------------------------------------------
-int rmhd_c2p_reconstruct_prim(double Z, double W, double *Pout)
+int rmhd_c2p_reconstruct_prim_r(rmhd_c2p_context *c, double Z, double W,
+                                double *Pout)
 {
+  const double D = c->D, B2 = c->B2, BS = c->BS, gamf = c->gamf;
+  const double *Cons = c->Cons;
   double P[8]; // Place result into temporary prim state for now.
   const double b0 = BS * W / Z;
 
@@ -142,10 +151,10 @@ int rmhd_c2p_reconstruct_prim(double Z, double W, double *Pout)
 int rmhd_c2p_check_cons(const double *U)
 {
   int i;
-  if (Cons[ddd] < 0.0) return RMHD_C2P_CONS_NEGATIVE_DENSITY;
-  if (Cons[tau] < 0.0) return RMHD_C2P_CONS_NEGATIVE_ENERGY;
+  if (U[ddd] < 0.0) return RMHD_C2P_CONS_NEGATIVE_DENSITY;
+  if (U[tau] < 0.0) return RMHD_C2P_CONS_NEGATIVE_ENERGY;
   for (i=0; i<8; ++i) {
-    if (isnan(Cons[i])) {
+    if (isnan(U[i])) {
       return RMHD_C2P_CONS_CONTAINS_NAN;
     }
   }
@@ -168,18 +177,21 @@ int rmhd_c2p_check_prim(const double *P)
 
 // Solution based on Anton & Zanotti (2006), equations 84 and 85.
 // -----------------------------------------------------------------------------
-int rmhd_c2p_solve_anton2dzw(double *P)
+int rmhd_c2p_solve_anton2dzw_r(rmhd_c2p_context *c, double *P)
 {
-  int bad_input = rmhd_c2p_check_cons(Cons);
+  const double D = c->D, Tau = c->Tau, gamf = c->gamf;
+  const double S2 = c->S2, B2 = c->B2, BS2 = c->BS2;
+
+  int bad_input = rmhd_c2p_check_cons(c->Cons);
   if (bad_input) {
     return bad_input;
   }
   // Starting values
   // ---------------------------------------------------------------------------
-  Iterations = 0;
+  int Iterations = 0;
   double error = 1.0;
-  double W = W_start;
-  double Z = Z_start;
+  double W = c->W_start;
+  double Z = c->Z_start;
 
   while (error > Tolerance) {
 
@@ -231,14 +243,14 @@ int rmhd_c2p_solve_anton2dzw(double *P)
 
     // -------------------------------------------------------------------------
     error = fabs(dZ/Z) + fabs(dW/W);
-    ++Iterations;
+    c->Iterations = ++Iterations;
 
     if (Iterations == MaxIteration) {
       return RMHD_C2P_MAXITER;
     }
   }
 
-  return rmhd_c2p_reconstruct_prim(Z, W, P);
+  return rmhd_c2p_reconstruct_prim_r(c, Z, W, P);
 }
 
 
@@ -247,17 +259,20 @@ int rmhd_c2p_solve_anton2dzw(double *P)
 // really be called '1dz', but I use this name to reflect the name of the
 // section in which it appears.
 // -----------------------------------------------------------------------------
-int rmhd_c2p_solve_noble1dw(double *P)
+int rmhd_c2p_solve_noble1dw_r(rmhd_c2p_context *c, double *P)
 {
-  int bad_input = rmhd_c2p_check_cons(Cons);
+  const double D = c->D, Tau = c->Tau, gamf = c->gamf;
+  const double S2 = c->S2, B2 = c->B2, BS2 = c->BS2;
+
+  int bad_input = rmhd_c2p_check_cons(c->Cons);
   if (bad_input) {
     return bad_input;
   }
   // Starting values
   // ---------------------------------------------------------------------------
-  Iterations = 0;
+  int Iterations = 0;
   double error = 1.0;
-  double Z = Z_start;
+  double Z = c->Z_start;
 
   double f, g;
 
@@ -295,7 +310,7 @@ int rmhd_c2p_solve_noble1dw(double *P)
     Z = Z_new;
 
     error = fabs(dZ/Z);
-    ++Iterations;
+    c->Iterations = ++Iterations;
 
     if (Iterations == MaxIteration) {
       return RMHD_C2P_MAXITER;
@@ -311,7 +326,7 @@ int rmhd_c2p_solve_noble1dw(double *P)
   const double W2  = 1.0 / (1.0 - V2);
   const double W   = sqrt(W2);
 
-  return rmhd_c2p_reconstruct_prim(Z, W, P);
+  return rmhd_c2p_reconstruct_prim_r(c, Z, W, P);
 }
 
 char *rmhd_c2p_get_error(int error)
@@ -339,3 +354,44 @@ char *rmhd_c2p_get_error(int error)
     return "Unkown error.";
   }
 }
+
+
+
+// Stateful interface, operating on DefaultContext
+// -----------------------------------------------------------------------------
+void rmhd_c2p_set_gamma(double adiabatic_gamma)
+{
+  rmhd_c2p_set_gamma_r(&DefaultContext, adiabatic_gamma);
+}
+int rmhd_c2p_get_iterations()
+{
+  return rmhd_c2p_get_iterations_r(&DefaultContext);
+}
+void rmhd_c2p_new_state(const double *U)
+{
+  rmhd_c2p_new_state_r(&DefaultContext, U);
+}
+void rmhd_c2p_estimate_from_cons()
+{
+  rmhd_c2p_estimate_from_cons_r(&DefaultContext);
+}
+void rmhd_c2p_get_starting_prim(double *P)
+{
+  rmhd_c2p_get_starting_prim_r(&DefaultContext, P);
+}
+void rmhd_c2p_set_starting_prim(const double *P)
+{
+  rmhd_c2p_set_starting_prim_r(&DefaultContext, P);
+}
+int rmhd_c2p_reconstruct_prim(double Z, double W, double *P)
+{
+  return rmhd_c2p_reconstruct_prim_r(&DefaultContext, Z, W, P);
+}
+int rmhd_c2p_solve_anton2dzw(double *P)
+{
+  return rmhd_c2p_solve_anton2dzw_r(&DefaultContext, P);
+}
+int rmhd_c2p_solve_noble1dw(double *P)
+{
+  return rmhd_c2p_solve_noble1dw_r(&DefaultContext, P);
+}
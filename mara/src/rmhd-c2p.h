@@ -19,6 +19,47 @@ extern "C" {
     RMHD_C2P_MAXITER
   } ;
 
+  // ---------------------------------------------------------------------------
+  // All of the solver state lives in a context, so that inversions may run
+  // concurrently on separate threads, each with a context of its own. A
+  // context must be initialized by rmhd_c2p_context_init before first use.
+  // ---------------------------------------------------------------------------
+  struct rmhd_c2p_context
+  {
+    double AdiabaticGamma, gamf;
+    double D, Tau;
+    double S2, B2, BS, BS2;
+    double Cons[8];
+    double Z_start, W_start, T_start;
+    int Iterations;
+    const void *eos;
+  } ;
+  typedef struct rmhd_c2p_context rmhd_c2p_context;
+
+  void rmhd_c2p_context_init(rmhd_c2p_context *c);
+  void rmhd_c2p_set_gamma_r(rmhd_c2p_context *c, double adiabatic_gamma);
+  void rmhd_c2p_new_state_r(rmhd_c2p_context *c, const double *U);
+  void rmhd_c2p_estimate_from_cons_r(rmhd_c2p_context *c);
+  void rmhd_c2p_set_starting_prim_r(rmhd_c2p_context *c, const double *P);
+  void rmhd_c2p_get_starting_prim_r(rmhd_c2p_context *c, double *P);
+  int rmhd_c2p_reconstruct_prim_r(rmhd_c2p_context *c, double Z, double W,
+                                  double *P);
+  int rmhd_c2p_solve_anton2dzw_r(rmhd_c2p_context *c, double *P);
+  int rmhd_c2p_solve_noble1dw_r(rmhd_c2p_context *c, double *P);
+  int rmhd_c2p_get_iterations_r(const rmhd_c2p_context *c);
+
+  void rmhd_c2p_eos_set_eos_r(rmhd_c2p_context *c, const void *eos_);
+  void rmhd_c2p_eos_new_state_r(rmhd_c2p_context *c, const double *U);
+  void rmhd_c2p_eos_estimate_from_cons_r(rmhd_c2p_context *c);
+  void rmhd_c2p_eos_set_starting_prim_r(rmhd_c2p_context *c, const double *P);
+  int rmhd_c2p_eos_solve_noble2dzt_r(rmhd_c2p_context *c, double *P);
+  int rmhd_c2p_eos_solve_duffell3d_r(rmhd_c2p_context *c, double *P);
+  int rmhd_c2p_eos_get_iterations_r(const rmhd_c2p_context *c);
+
+  // ---------------------------------------------------------------------------
+  // Stateful interface, operating on a context private to each module. These
+  // are not reentrant, and are retained for interactive testing.
+  // ---------------------------------------------------------------------------
   void rmhd_c2p_set_gamma(double adiabatic_gamma);
   void rmhd_c2p_new_state(const double *U);
   void rmhd_c2p_estimate_from_cons();
@@ -57,23 +57,29 @@ int Rmhd::ConsCheck(const double *U) const
 }
 
 int Rmhd::ConsToPrim(const double *U, double *P) const
+// -----------------------------------------------------------------------------
+// The inversion state is held in a context on the stack, so this function may
+// be called concurrently from any number of threads.
+// -----------------------------------------------------------------------------
 {
   int error = 1;
+  rmhd_c2p_context c2p;
+  rmhd_c2p_context_init(&c2p);
 
   // This piece of code drives cons to prim inversions for an arbitrary equation
   // of state.
   // ---------------------------------------------------------------------------
   if (typeid(*EOS) != typeid(AdiabaticEos)) {
 
-    rmhd_c2p_eos_set_eos(EOS);
-    rmhd_c2p_eos_new_state(U);
+    rmhd_c2p_eos_set_eos_r(&c2p, EOS);
+    rmhd_c2p_eos_new_state_r(&c2p, U);
 
     //    std::cout << PrintPrim(P) << std::endl;
     //    std::cout << PrintCons(U) << std::endl;
 
     if (error) {
-      rmhd_c2p_eos_set_starting_prim(P);
-      error = rmhd_c2p_eos_solve_duffell3d(P);
+      rmhd_c2p_eos_set_starting_prim_r(&c2p, P);
+      error = rmhd_c2p_eos_solve_duffell3d_r(&c2p, P);
     }
     if (error) {
 
@@ -81,12 +87,12 @@ int Rmhd::ConsToPrim(const double *U, double *P) const
       return error;
       // ------------------------------------------------------------
 
-      rmhd_c2p_eos_set_starting_prim(P);
-      error = rmhd_c2p_eos_solve_noble2dzt(P);
+      rmhd_c2p_eos_set_starting_prim_r(&c2p, P);
+      error = rmhd_c2p_eos_solve_noble2dzt_r(&c2p, P);
     }
     if (error) {
-      rmhd_c2p_eos_estimate_from_cons();
-      error = rmhd_c2p_eos_solve_noble2dzt(P);
+      rmhd_c2p_eos_estimate_from_cons_r(&c2p);
+      error = rmhd_c2p_eos_solve_noble2dzt_r(&c2p, P);
     }
 
     return error;
@@ -95,24 +101,24 @@ int Rmhd::ConsToPrim(const double *U, double *P) const
   // This piece of code drives cons to prim inversions for a gamma-law equation
   // of state.
   // ---------------------------------------------------------------------------
-  rmhd_c2p_set_gamma(Mara->GetEos<AdiabaticEos>().Gamma);
-  rmhd_c2p_new_state(U);
+  rmhd_c2p_set_gamma_r(&c2p, Mara->GetEos<AdiabaticEos>().Gamma);
+  rmhd_c2p_new_state_r(&c2p, U);
 
   if (error) {
-    rmhd_c2p_set_starting_prim(P);
-    error = rmhd_c2p_solve_anton2dzw(P);
+    rmhd_c2p_set_starting_prim_r(&c2p, P);
+    error = rmhd_c2p_solve_anton2dzw_r(&c2p, P);
   }
   if (error) {
-    rmhd_c2p_estimate_from_cons();
-    error = rmhd_c2p_solve_anton2dzw(P);
+    rmhd_c2p_estimate_from_cons_r(&c2p);
+    error = rmhd_c2p_solve_anton2dzw_r(&c2p, P);
   }
   if (error) {
-    rmhd_c2p_set_starting_prim(P);
-    error = rmhd_c2p_solve_noble1dw(P);
+    rmhd_c2p_set_starting_prim_r(&c2p, P);
+    error = rmhd_c2p_solve_noble1dw_r(&c2p, P);
   }
   if (error) {
-    rmhd_c2p_estimate_from_cons();
-    error = rmhd_c2p_solve_noble1dw(P);
+    rmhd_c2p_estimate_from_cons_r(&c2p);
+    error = rmhd_c2p_solve_noble1dw_r(&c2p, P);
   }
 
   return error;
@@ -31,6 +31,7 @@ public:
 
   void ConstrainedTransport2d(double *Fx, double *Fy,             int stride[4]) const;
   void ConstrainedTransport3d(double *Fx, double *Fy, double *Fz, int stride[4]) const;
+  bool UsesConstrainedTransport() const { return true; }
 
   int GetNq() const { return 8; }
   std::vector<std::string> GetPrimNames() const;
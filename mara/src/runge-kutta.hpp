@@ -4,53 +4,93 @@
 
 #include "hydro.hpp"
 
-class RungeKuttaSingleStep : public RungeKuttaIntegration
+// -----------------------------------------------------------------------------
+// The integrators below own their stage buffers, which are sized on the first
+// call to AdvanceState and re-used on every subsequent step. The Godunov
+// operator writes its time derivative into L in place, so a step performs no
+// heap allocations as long as the domain size is unchanged. The arithmetic of
+// each stage is written in the same order as the textbook form, so results are
+// bit-identical to evaluating the stages with temporaries.
+// -----------------------------------------------------------------------------
+class RungeKuttaStageBuffers : public RungeKuttaIntegration
 {
+protected:
+  static void size_stage(std::valarray<double> &A, size_t N)
+  {
+    if (A.size() != N) A.resize(N);
+  }
+} ;
+class RungeKuttaSingleStep : public RungeKuttaStageBuffers
+{
+private:
+  std::valarray<double> L;
+
 public:
-  void AdvanceState(std::valarray<double> &U, double dt) const
+  void AdvanceState(std::valarray<double> &U, double dt)
   {
+    size_stage(L, U.size());
     Mara->godunov->SetTimeStepDt(dt);
-    U += dt * Mara->godunov->dUdt(U);
+
+    Mara->godunov->dUdt(U, L);
+    U += dt * L;
   }
 } ;
-class RungeKuttaRk2Tvd : public RungeKuttaIntegration
+class RungeKuttaRk2Tvd : public RungeKuttaStageBuffers
 {
+private:
+  std::valarray<double> L, U1;
+
 public:
-  void AdvanceState(std::valarray<double> &U, double dt) const
+  void AdvanceState(std::valarray<double> &U, double dt)
   {
-    std::valarray<double> U1(U.size());
+    size_stage(L , U.size());
+    size_stage(U1, U.size());
     Mara->godunov->SetTimeStepDt(dt);
 
-    U1 =      U +      dt*Mara->godunov->dUdt(U);
-    U  = 0.5*(U + U1 + dt*Mara->godunov->dUdt(U1));
+    Mara->godunov->dUdt(U , L); U1 =      U +      dt*L;
+    Mara->godunov->dUdt(U1, L); U  = 0.5*(U + U1 + dt*L);
   }
 } ;
-class RungeKuttaShuOsherRk3 : public RungeKuttaIntegration
+class RungeKuttaShuOsherRk3 : public RungeKuttaStageBuffers
 {
+private:
+  std::valarray<double> L, U1;
+
 public:
-  void AdvanceState(std::valarray<double> &U, double dt) const
+  void AdvanceState(std::valarray<double> &U, double dt)
   {
-    std::valarray<double> U1(U.size());
+    size_stage(L , U.size());
+    size_stage(U1, U.size());
     Mara->godunov->SetTimeStepDt(dt);
 
-    U1 =      U +                  dt * Mara->godunov->dUdt(U );
-    U1 = 3./4*U + 1./4*U1 + 1./4 * dt * Mara->godunov->dUdt(U1);
-    U  = 1./3*U + 2./3*U1 + 2./3 * dt * Mara->godunov->dUdt(U1);
+    Mara->godunov->dUdt(U , L); U1 =      U +                  dt * L;
+    Mara->godunov->dUdt(U1, L); U1 = 3./4*U + 1./4*U1 + 1./4 * dt * L;
+    Mara->godunov->dUdt(U1, L); U  = 1./3*U + 2./3*U1 + 2./3 * dt * L;
   }
 } ;
-class RungeKuttaClassicRk4 : public RungeKuttaIntegration
+class RungeKuttaClassicRk4 : public RungeKuttaStageBuffers
+// -----------------------------------------------------------------------------
+// The weighted sum (L1 + 2 L2 + 2 L3 + L4) is accumulated into S as each stage
+// completes, so only one derivative buffer is needed rather than four.
+// -----------------------------------------------------------------------------
 {
+private:
+  std::valarray<double> L, S, Us;
+
 public:
-  void AdvanceState(std::valarray<double> &U, double dt) const
+  void AdvanceState(std::valarray<double> &U, double dt)
   {
+    size_stage(L , U.size());
+    size_stage(S , U.size());
+    size_stage(Us, U.size());
     Mara->godunov->SetTimeStepDt(dt);
 
-    std::valarray<double> L1 = dt * Mara->godunov->dUdt(U);
-    std::valarray<double> L2 = dt * Mara->godunov->dUdt(U + 0.5*L1);
-    std::valarray<double> L3 = dt * Mara->godunov->dUdt(U + 0.5*L2);
-    std::valarray<double> L4 = dt * Mara->godunov->dUdt(U + 1.0*L3);
+    Mara->godunov->dUdt(U , L); L *= dt; S  =     L; Us = U + 0.5*L;
+    Mara->godunov->dUdt(Us, L); L *= dt; S += 2.0*L; Us = U + 0.5*L;
+    Mara->godunov->dUdt(Us, L); L *= dt; S += 2.0*L; Us = U + 1.0*L;
+    Mara->godunov->dUdt(Us, L); L *= dt; S +=     L;
 
-    U += (1.0/6.0) * (L1 + 2.0*L2 + 2.0*L3 + L4);
+    U += (1.0/6.0) * S;
   }
 } ;
 
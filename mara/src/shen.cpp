@@ -46,6 +46,11 @@
 #include <cmath>
 #include <cstring>
 #include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "eos.hpp"
 
 
@@ -61,46 +66,190 @@
 bool ShenTabulatedNuclearEos::verbose = false;
 
 
+// Binary tables written by WriteBinaryTable begin with this header, followed by
+// the arrays logD and logT and then the interleaved table, as native doubles
+// laid out just as they are in memory. The header is a multiple of 8 bytes so
+// that the arrays are aligned in the mapped file.
+struct ShenBinaryHeader
+{
+  char magic[8];
+  int version;
+  int ND, NT;
+  int unused;
+} ;
+static const char ShenBinaryMagic[8] = { 'M','A','R','A','S','H','E','N' };
+static const int ShenBinaryVersion = 2; // 1 had the quantities in separate arrays
+
+
 
 
 double ShenTabulatedNuclearEos::DensLower() const
 {
-  return pow(10.0, logD_values.front()) * units.GramsPerCubicCentimeter();
+  return pow(10.0, logD_values[0]) * units.GramsPerCubicCentimeter();
 }
 double ShenTabulatedNuclearEos::DensUpper() const
 {
-  return pow(10.0, logD_values.back()) * units.GramsPerCubicCentimeter();
+  return pow(10.0, logD_values[ND-1]) * units.GramsPerCubicCentimeter();
 }
 double ShenTabulatedNuclearEos::TempLower() const
 {
-  return logT_values.front();
+  return logT_values[0];
 }
 double ShenTabulatedNuclearEos::TempUpper() const
 {
-  return logT_values.back();
+  return logT_values[NT-1];
+}
+
+
+
+ShenTabulatedNuclearEos::ShenTabulatedNuclearEos(const TabulatedEos &tab,
+                                                 bool node_shared)
+  : ND(tab.logD_values.size()),
+    NT(tab.logT_values.size()),
+    mapping(NULL),
+    mapping_size(0)
+// -----------------------------------------------------------------------------
+// With node_shared, the ranks on a node hold a single copy of the table, which
+// the first of them fills; construction is then collective over the ranks.
+// -----------------------------------------------------------------------------
+{
+  double *x = Table.Allocate(ND + NT + NumSampled*ND*NT, node_shared);
+
+  if (Table.Writer()) {
+    x = std::copy(tab.logD_values.begin(), tab.logD_values.end(), x);
+    x = std::copy(tab.logT_values.begin(), tab.logT_values.end(), x);
+
+    for (int n=0; n<ND*NT; ++n) {
+      x[NumSampled*n + SampleP] = tab.EOS_p[n];
+      x[NumSampled*n + SampleS] = tab.EOS_s[n];
+      x[NumSampled*n + SampleU] = tab.EOS_u[n];
+    }
+  }
+
+  // The non-writing ranks only see the grids once the block is published
+  // ---------------------------------------------------------------------------
+  if (Table.Writer()) {
+    this->attach_arrays(Table.Data());
+    this->tabulate_derivatives(x);
+  }
+  Table.Publish();
+  this->attach_arrays(Table.Data());
 }
 
+ShenTabulatedNuclearEos::ShenTabulatedNuclearEos(const char *binary_fname)
+  : ND(0),
+    NT(0),
+    mapping(NULL),
+    mapping_size(0)
+// -----------------------------------------------------------------------------
+// Maps a table written by WriteBinaryTable read-only and samples it in place,
+// so that nothing is parsed or copied at startup, and the ranks on a node share
+// the table's pages through the page cache.
+// -----------------------------------------------------------------------------
+{
+  if (verbose) {
+    printf("mapping EOS table %s from disk...\n", binary_fname);
+  }
+
+  const int fd = open(binary_fname, O_RDONLY);
+  struct stat st;
+
+  if (fd < 0) {
+    throw UnableToLoadTable();
+  }
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(ShenBinaryHeader)) {
+    close(fd);
+    throw UnableToLoadTable();
+  }
+
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd); // the mapping holds its own reference to the file
+
+  if (map == MAP_FAILED) {
+    throw UnableToLoadTable();
+  }
+
+  const ShenBinaryHeader *head = static_cast<const ShenBinaryHeader*>(map);
+  const size_t expected = sizeof(ShenBinaryHeader) + sizeof(double) *
+    (head->ND + head->NT + NumSampled*size_t(head->ND)*head->NT);
+
+  if (memcmp(head->magic, ShenBinaryMagic, 8) != 0 ||
+      head->version != ShenBinaryVersion ||
+      head->ND < 2 || head->NT < 2 ||
+      size_t(st.st_size) != expected) {
+    munmap(map, st.st_size);
+    throw UnableToLoadTable();
+  }
+
+  mapping = map;
+  mapping_size = st.st_size;
+  ND = head->ND;
+  NT = head->NT;
+
+  this->attach_arrays(reinterpret_cast<const double*>(head + 1));
 
+  if (verbose) {
+    printf("mapped (%d x %d) entries of the table\n", ND, NT);
+  }
+}
+
+ShenTabulatedNuclearEos::~ShenTabulatedNuclearEos()
+{
+  if (mapping) {
+    munmap(mapping, mapping_size);
+  }
+}
 
-ShenTabulatedNuclearEos::ShenTabulatedNuclearEos(const TabulatedEos &tab)
-  : logD_values(tab.logD_values),
-    logT_values(tab.logT_values),
-    EOS_p(tab.EOS_p),
-    EOS_s(tab.EOS_s),
-    EOS_u(tab.EOS_u)
+void ShenTabulatedNuclearEos::attach_arrays(const double *base)
 {
-  this->tabulate_derivatives();
+  logD_values = base;
+  logT_values = logD_values + ND;
+  EOS_table   = logT_values + NT;
+  dlogD_inv   = 1.0 / (logD_values[1] - logD_values[0]);
+  dlogT_inv   = 1.0 / (logT_values[1] - logT_values[0]);
 }
 
-void ShenTabulatedNuclearEos::tabulate_derivatives()
+void ShenTabulatedNuclearEos::WriteBinaryTable(const char *fname,
+                                               const TabulatedEos &tab)
+// -----------------------------------------------------------------------------
+// Converts a table read by LoadTable into the binary format mapped by the
+// second constructor. The sound speed is tabulated here, once, and stored with
+// the other arrays.
+// -----------------------------------------------------------------------------
 {
-  const size_t ND = logD_values.size();
-  const size_t NT = logT_values.size();
+  ShenTabulatedNuclearEos eos(tab);
+  ShenBinaryHeader head;
+
+  memset(&head, 0, sizeof(ShenBinaryHeader));
+  memcpy(head.magic, ShenBinaryMagic, 8);
+  head.version = ShenBinaryVersion;
+  head.ND = eos.ND;
+  head.NT = eos.NT;
+
+  FILE *outf = fopen(fname, "wb");
+
+  if (outf == NULL) {
+    throw UnableToWriteTable();
+  }
+
+  const size_t N = eos.ND + eos.NT + NumSampled*size_t(eos.ND)*eos.NT;
+  const int failed =
+    (fwrite(&head, sizeof(ShenBinaryHeader), 1, outf) != 1) +
+    (fwrite(eos.Table.Data(), sizeof(double), N, outf) != N);
+
+  if (fclose(outf) != 0 || failed) {
+    throw UnableToWriteTable();
+  }
 
-  EOS_cs2.resize(ND*NT);
+  if (verbose) {
+    printf("wrote (%d x %d) entries to the table %s\n", eos.ND, eos.NT, fname);
+  }
+}
 
-  for (size_t i=0; i<ND; ++i) {
-    for (size_t j=0; j<NT; ++j) {
+void ShenTabulatedNuclearEos::tabulate_derivatives(double *table) const
+{
+  for (int i=0; i<ND; ++i) {
+    for (int j=0; j<NT; ++j) {
 
       const int im1 = (i !=    0) ? i-1 : 0;
       const int ip1 = (i != ND-1) ? i+1 : ND-1;
@@ -113,66 +262,59 @@ void ShenTabulatedNuclearEos::tabulate_derivatives()
 
       double Jp[2], Js[2];
 
-      Jp[0] = (EOS_p[ip1 + j*ND] - EOS_p[im1 + j*ND]) / dlogD;
-      Js[0] = (EOS_s[ip1 + j*ND] - EOS_s[im1 + j*ND]) / dlogD;
+      Jp[0] = (entry(SampleP, ip1, j) - entry(SampleP, im1, j)) / dlogD;
+      Js[0] = (entry(SampleS, ip1, j) - entry(SampleS, im1, j)) / dlogD;
 
-      Jp[1] = (EOS_p[i + jp1*ND] - EOS_p[i + jm1*ND]) / dlogT;
-      Js[1] = (EOS_s[i + jp1*ND] - EOS_s[i + jm1*ND]) / dlogT;
+      Jp[1] = (entry(SampleP, i, jp1) - entry(SampleP, i, jm1)) / dlogT;
+      Js[1] = (entry(SampleS, i, jp1) - entry(SampleS, i, jm1)) / dlogT;
 
       const double c2 = LIGHT_SPEED*LIGHT_SPEED;
       const double f  = MEV_TO_ERG / FM3_TO_CM3;
 
-      const double p = pow(10.0, EOS_p[i + j*ND])*f; // erg/cm^3
-      const double u = pow(10.0, EOS_u[i + j*ND])*f; // erg/cm^3
+      const double p = pow(10.0, entry(SampleP, i, j))*f; // erg/cm^3
+      const double u = pow(10.0, entry(SampleU, i, j))*f; // erg/cm^3
       const double D = pow(10.0, logD_values[i]);    // gm/cm^3
 
       const double Dh = D + u/c2 + p/c2;
       const double GammaEff = (Jp[0]*Js[1] - Jp[1]*Js[0])/Js[1];
       const double cs2 = GammaEff * p / Dh;
 
-      EOS_cs2[i + j*ND] = cs2/c2; // (cm/s)^2
+      table[NumSampled*(i + j*ND) + SampleCs2] = cs2/c2; // (cm/s)^2
     }
   }
 }
+// The index functions return the upper index of the cell holding the sample, or
+// zero if it is off the table.
+// -----------------------------------------------------------------------------
 #ifdef NOSEARCH_DT
 int ShenTabulatedNuclearEos::find_upper_index_D(double logD) const
 {
-  int n0=0, n1=logD_values.size()-1;
-
-  if (logD < logD_values[n0]) {
-    throw SampledOutOfRangeDensity();
-  }
-  if (logD > logD_values[n1]) {
-    throw SampledOutOfRangeDensity();
+  if (!(logD >= logD_values[0] && logD <= logD_values[ND-1])) {
+    return 0;
   }
 
-  return 1.0 + (logD - logD_values[0]) / (logD_values[1] - logD_values[0]);
+  // The upper edge itself would index one past the last sample
+  const int i = 1 + int((logD - logD_values[0]) * dlogD_inv);
+  return i < ND ? i : ND - 1;
 }
 
 int ShenTabulatedNuclearEos::find_upper_index_T(double logT) const
 {
-  int n0=0, n1=logT_values.size()-1;
-
-  if (logT < logT_values[n0]) {
-    throw SampledOutOfRangeTemperature();
-  }
-  if (logT > logT_values[n1]) {
-    throw SampledOutOfRangeTemperature();
+  if (!(logT >= logT_values[0] && logT <= logT_values[NT-1])) {
+    return 0;
   }
 
-  return 1.0 + (logT - logT_values[0]) / (logT_values[1] - logT_values[0]);
+  const int j = 1 + int((logT - logT_values[0]) * dlogT_inv);
+  return j < NT ? j : NT - 1;
 }
 #else
 
 int ShenTabulatedNuclearEos::find_upper_index_D(double logD) const
 {
-  int n0=0, n1=logD_values.size()-1;
+  int n0=0, n1=ND-1;
 
-  if (logD < logD_values[n0]) {
-    throw SampledOutOfRangeDensity();
-  }
-  if (logD > logD_values[n1]) {
-    throw SampledOutOfRangeDensity();
+  if (!(logD >= logD_values[n0] && logD <= logD_values[n1])) {
+    return 0;
   }
 
   while (n1 - n0 > 1) {
@@ -188,13 +330,10 @@ int ShenTabulatedNuclearEos::find_upper_index_D(double logD) const
 
 int ShenTabulatedNuclearEos::find_upper_index_T(double logT) const
 {
-  int n0=0, n1=logT_values.size()-1;
+  int n0=0, n1=NT-1;
 
-  if (logT < logT_values[n0]) {
-    throw SampledOutOfRangeTemperature();
-  }
-  if (logT > logT_values[n1]) {
-    throw SampledOutOfRangeTemperature();
+  if (!(logT >= logT_values[n0] && logT <= logT_values[n1])) {
+    return 0;
   }
 
   while (n1 - n0 > 1) {
@@ -209,44 +348,46 @@ int ShenTabulatedNuclearEos::find_upper_index_T(double logT) const
 }
 #endif
 
-double ShenTabulatedNuclearEos::sample_EOS(const std::vector<double> &EOS,
-                                           double logD, double logT, double *J) const
+double ShenTabulatedNuclearEos::sample_EOS(int q, double logD, double logT,
+                                           double *J) const
+// -----------------------------------------------------------------------------
+// Samples off the table use the approximate EOS, and are counted rather than
+// reported; see EquationOfState::CountOffTable.
+// -----------------------------------------------------------------------------
 {
-  try {
-    return this->tabled_EOS(EOS, logD, logT, J);
-  }
-  catch (const SampledOutOfRangeDensity &e) {
-    printf("[shen] warning: density out, using approximate. logD=%e\n", logD);
-    return this->approx_EOS(EOS, logD, logT, J);
+  const int Di = find_upper_index_D(logD);
+  const int Tj = find_upper_index_T(logT);
+
+  if (Di == 0) {
+    CountOffTable(OFF_TABLE_DENSITY);
+    return this->approx_EOS(q, logD, logT, J);
   }
-  catch (const SampledOutOfRangeTemperature &e) {
-    printf("[shen] warning: temperature out, using approximate logT=%e\n", logT);
-    return this->approx_EOS(EOS, logD, logT, J);
+  if (Tj == 0) {
+    CountOffTable(OFF_TABLE_TEMPERATURE);
+    return this->approx_EOS(q, logD, logT, J);
   }
+  return this->tabled_EOS(q, Di, Tj, logD, logT, J);
 }
-double ShenTabulatedNuclearEos::tabled_EOS(const std::vector<double> &EOS,
-                                           double logD, double logT, double *J) const
+double ShenTabulatedNuclearEos::tabled_EOS(int q, int Di, int Tj,
+                                           double logD, double logT,
+                                           double *J) const
 {
   // Receives one of the lookup tables for pressure, temperature, or internal
   // energy, and performs a bilinear interpolation on the nearest 4 samples in
   // order to construct the needed EOS variable. Sampling is done in log10-space
-  // for both the density and temperature.
+  // for both the density and temperature. Di and Tj are the upper indices of
+  // the cell holding the sample.
   // ---------------------------------------------------------------------------
 
-  const int Di = find_upper_index_D(logD);
-  const int Tj = find_upper_index_T(logT);
-
-  const int ND = logD_values.size();
-
   const double dlogD = logD_values[Di] - logD_values[Di-1];
   const double dlogT = logT_values[Tj] - logT_values[Tj-1];
 
   // http://en.wikipedia.org/wiki/Bilinear_interpolation
   // ---------------------------------------------------------------------------
-  const double f00 = EOS[(Di-1) + (Tj-1)*ND];
-  const double f01 = EOS[(Di-1) + (Tj-0)*ND];
-  const double f10 = EOS[(Di-0) + (Tj-1)*ND];
-  const double f11 = EOS[(Di-0) + (Tj-0)*ND];
+  const double f00 = entry(q, Di-1, Tj-1);
+  const double f01 = entry(q, Di-1, Tj-0);
+  const double f10 = entry(q, Di-0, Tj-1);
+  const double f11 = entry(q, Di-0, Tj-0);
 
   const double x = (logD - logD_values[Di-1]) / dlogD;
   const double y = (logT - logT_values[Tj-1]) / dlogT;
@@ -269,41 +410,81 @@ double ShenTabulatedNuclearEos::tabled_EOS(const std::vector<double> &EOS,
   return b1 + b2*x + b3*y + b4*x*y;
 }
 
-double ShenTabulatedNuclearEos::approx_EOS(const std::vector<double> &EOS,
-                                           double logD, double logT, double *J) const
+double ShenTabulatedNuclearEos::approx_EOS(int q, double logD, double logT,
+                                           double *J) const
 {
-  const int ND = logD_values.size();
-  const int NT = logT_values.size();
-
   const double dlogD = logD_values[ND-1] - logD_values[0];
   const double dlogT = logT_values[NT-1] - logT_values[0];
 
-  const double dfdlogD = (EOS[ND-1 + (NT/2)*ND] - EOS[0 + (NT/2)*ND]) / dlogD;
-  const double dfdlogT = (EOS[ND/2 + (NT-1)*ND] - EOS[ND/2 +   0*ND]) / dlogT;
+  const double dfdlogD = (entry(q, ND-1, NT/2) - entry(q,    0, NT/2)) / dlogD;
+  const double dfdlogT = (entry(q, ND/2, NT-1) - entry(q, ND/2,    0)) / dlogT;
 
   if (J != NULL) {
     J[0] = dfdlogD;
     J[1] = dfdlogT;
   }
 
-  const double fc = EOS[ND/2 + (NT/2)*ND];
+  const double fc = entry(q, ND/2, NT/2);
   const double xc = logD_values[ND/2];
   const double yc = logT_values[NT/2];
 
   return fc + (logD-xc)*dfdlogD + (logT-yc)*dfdlogT;
 }
 
-double ShenTabulatedNuclearEos::inverse_lookup_T(const std::vector<double> &EOS,
-                                                 double logD, double logF) const
+void ShenTabulatedNuclearEos::SampleAll(double logD, double logT,
+                                        double *out) const
+// -----------------------------------------------------------------------------
+// Interpolates every quantity in the table at once, as tabled_EOS does for one
+// of them. The indices and weights are found once, and the four samples of the
+// stencil are each NumSampled contiguous values.
+// -----------------------------------------------------------------------------
+{
+  const int Di = find_upper_index_D(logD);
+  const int Tj = find_upper_index_T(logT);
+
+  if (Di == 0 || Tj == 0) {
+    CountOffTable(Di == 0 ? OFF_TABLE_DENSITY : OFF_TABLE_TEMPERATURE);
+    for (int q=0; q<NumSampled; ++q) {
+      out[3*q] = this->approx_EOS(q, logD, logT, &out[3*q+1]);
+    }
+    return;
+  }
+
+  const double dlogD = logD_values[Di] - logD_values[Di-1];
+  const double dlogT = logT_values[Tj] - logT_values[Tj-1];
+
+  const double x = (logD - logD_values[Di-1]) / dlogD;
+  const double y = (logT - logT_values[Tj-1]) / dlogT;
+
+  const double *f00 = &EOS_table[NumSampled*((Di-1) + (Tj-1)*ND)];
+  const double *f10 = f00 + NumSampled;
+  const double *f01 = f00 + NumSampled*ND;
+  const double *f11 = f01 + NumSampled;
+
+  for (int q=0; q<NumSampled; ++q) {
+
+    const double b1 = f00[q];
+    const double b2 = f10[q] - f00[q];
+    const double b3 = f01[q] - f00[q];
+    const double b4 = f00[q] - f10[q] - f01[q] + f11[q];
+
+    out[3*q+0] = b1 + b2*x + b3*y + b4*x*y;
+    out[3*q+1] = (b2 + b4*y)/dlogD;
+    out[3*q+2] = (b3 + b4*x)/dlogT;
+  }
+}
+
+double ShenTabulatedNuclearEos::inverse_lookup_T(int q, double logD,
+                                                 double logF) const
 {
   // First do a bisection to identify the nearest tabulated temperature for the
   // density and variable (F := { p,s,u }) requested.
   // ---------------------------------------------------------------------------
-  int n0=0, n1=logT_values.size()-1;
+  int n0=0, n1=NT-1;
 
   while (n1 - n0 > 1) {
 
-    const double logF_mid = sample_EOS(EOS, logD, logT_values[(n0+n1)/2]);
+    const double logF_mid = sample_EOS(q, logD, logT_values[(n0+n1)/2]);
 
     if (logF > logF_mid) n0 = (n0+n1)/2;
     else                 n1 = (n0+n1)/2;
@@ -313,15 +494,15 @@ double ShenTabulatedNuclearEos::inverse_lookup_T(const std::vector<double> &EOS,
   // corresponding temperature is off the table. When this happens, we use an
   // safe/approximate evalutation instead of a table lookup.
   // ---------------------------------------------------------------------------
-  const double logF0 = sample_EOS(EOS, logD, logT_values[n0]);
-  const double logF1 = sample_EOS(EOS, logD, logT_values[n1]);
+  const double logF0 = sample_EOS(q, logD, logT_values[n0]);
+  const double logF1 = sample_EOS(q, logD, logT_values[n1]);
 
-  const double logD0 = logD_values.front();
-  const double logD1 = logD_values.back();
+  // A density off the table, or NaN, has no cell (Di == 0)
+  const int Di = find_upper_index_D(logD);
 
   const int off_table =
     (logF < logF0 || logF1 < logF) +
-    (logD < logD0 || logD1 < logD);
+    (Di == 0);
 
   double logT = 0.5*(logT_values[n0] + logT_values[n1]);
 
@@ -330,30 +511,88 @@ double ShenTabulatedNuclearEos::inverse_lookup_T(const std::vector<double> &EOS,
   // ---------------------------------------------------------------------------
   double J[2];
   double f = (off_table ?
-              approx_EOS(EOS, logD, logT, J) :
-              tabled_EOS(EOS, logD, logT, J)) - logF;
+              approx_EOS(q, logD, logT, J) :
+              tabled_EOS(q, Di, n1, logD, logT, J)) - logF;
   double g = fabs(J[1]) > EFFECTIVELY_ZERO ? J[1] : EFFECTIVELY_ZERO;
 
   logT -= f/g;
 
   if (off_table) {
-    printf("[shen] warning: inverse lookup used approximate. logT=%e\n", logT);
+    CountOffTable(OFF_TABLE_INVERSE);
   }
 
   return logT;
 }
 
 
+double ShenTabulatedNuclearEos::inverse_lookup_T_near(int q, double logD,
+                                                      double logF,
+                                                      double logT_guess) const
+// -----------------------------------------------------------------------------
+// Same as inverse_lookup_T, but starting from the cell holding logT_guess and
+// stepping one cell at a time until one brackets F, which takes no steps when
+// the guess is the temperature of the same zone on the last step. The density
+// is located once, which leaves F linear in logT within each cell, so that the
+// root is found directly. A guess off the table (or NaN) starts from a
+// bisection instead, and an F which no cell brackets is left to
+// inverse_lookup_T.
+// -----------------------------------------------------------------------------
+{
+  const int Di = find_upper_index_D(logD);
+
+  if (Di == 0) {
+    return this->inverse_lookup_T(q, logD, logF);
+  }
+
+  const double x = (logD - logD_values[Di-1]) / (logD_values[Di] - logD_values[Di-1]);
+  const int S = NumSampled;
+  const double *F0 = &EOS_table[S*(Di-1) + q]; // F at (Di-1, j) is F0[S*ND*j]
+  const double *F1 = F0 + S;
+
+#define COLUMN(j) ((1.0 - x)*F0[S*ND*(j)] + x*F1[S*ND*(j)])
+
+  int j = find_upper_index_T(logT_guess);
+
+  if (j == 0) {
+    int n0=0, n1=NT-1;
+
+    while (n1 - n0 > 1) {
+      if (logF > COLUMN((n0+n1)/2)) n0 = (n0+n1)/2;
+      else                          n1 = (n0+n1)/2;
+    }
+    j = n1;
+  }
+
+  for (int steps=0; steps<NT; ++steps) {
+
+    const double f0 = COLUMN(j-1);
+    const double f1 = COLUMN(j);
+
+    if      (logF < f0 && j > 1   ) --j;
+    else if (logF > f1 && j < NT-1) ++j;
+    else if (logF < f0 || logF > f1) break;
+    else {
+      const double y = (f1 != f0) ? (logF - f0) / (f1 - f0) : 0.5;
+      return logT_values[j-1] + y*(logT_values[j] - logT_values[j-1]);
+    }
+  }
+
+#undef COLUMN
+
+  return this->inverse_lookup_T(q, logD, logF);
+}
+
+
 double ShenTabulatedNuclearEos::Pressure(double D, double logT) const
 {
   D /= units.GramsPerCubicCentimeter();
-  const double p = pow(10.0, sample_EOS(EOS_p, log10(D), logT));
+  const double p = pow(10.0, sample_EOS(SampleP, log10(D), logT));
   return p * units.MeVPerCubicFemtometer();
 }
 double ShenTabulatedNuclearEos::Internal(double D, double logT) const
 {
   D /= units.GramsPerCubicCentimeter();
-  const double u = pow(10.0, sample_EOS(EOS_u, log10(D), logT));
+  const double u = pow(10.0, sample_EOS(SampleU, log10(D), logT));
   return u * units.MeVPerCubicFemtometer();
 }
 double ShenTabulatedNuclearEos::Entropy(double D, double logT) const
@@ -362,7 +601,7 @@ double ShenTabulatedNuclearEos::Entropy(double D, double logT) const
 // -----------------------------------------------------------------------------
 {
   D /= units.GramsPerCubicCentimeter();
-  const double s = pow(10.0, sample_EOS(EOS_s, log10(D), logT));
+  const double s = pow(10.0, sample_EOS(SampleS, log10(D), logT));
   return s * units.BoltzmannConstant();
 }
 
@@ -373,7 +612,7 @@ double ShenTabulatedNuclearEos::SoundSpeed2Nr(double D, double logT) const
 double ShenTabulatedNuclearEos::SoundSpeed2Sr(double D, double logT) const
 {
   D /= units.GramsPerCubicCentimeter();
-  const double cs2 = sample_EOS(EOS_cs2, log10(D), logT); // in units of light speed
+  const double cs2 = sample_EOS(SampleCs2, log10(D), logT); // in units of light speed
   return cs2 * pow(units.LightSpeed(), 2.0); // in code units
 }
 
@@ -382,26 +621,59 @@ double ShenTabulatedNuclearEos::Temperature_u(double D, double u) const
   const double logD = log10(D/units.GramsPerCubicCentimeter());
   const double logu = log10(u/units.MeVPerCubicFemtometer());
 
-  return this->inverse_lookup_T(EOS_u, logD, logu);
+  return this->inverse_lookup_T(SampleU, logD, logu);
 }
 double ShenTabulatedNuclearEos::Temperature_p(double D, double p) const
 {
   const double logD = log10(D/units.GramsPerCubicCentimeter());
   const double logp = log10(p/units.MeVPerCubicFemtometer());
 
-  return this->inverse_lookup_T(EOS_p, logD, logp);
+  return this->inverse_lookup_T(SampleP, logD, logp);
 }
 double ShenTabulatedNuclearEos::TemperatureMeV(double D, double p) const
 {
   const double logD = log10(D/units.GramsPerCubicCentimeter());
   const double logp = log10(p/units.MeVPerCubicFemtometer());
-  const double logT = this->inverse_lookup_T(EOS_p, logD, logp);
+  const double logT = this->inverse_lookup_T(SampleP, logD, logp);
   return pow(10.0, logT);
 }
 double ShenTabulatedNuclearEos::TemperatureArb(double D, double T_MeV) const
 {
   return log10(T_MeV);
 }
+double ShenTabulatedNuclearEos::TemperatureArbToMeV(double D, double logT) const
+{
+  return pow(10.0, logT);
+}
+
+void ShenTabulatedNuclearEos::TemperatureBatch_p(const double *D,
+                                                 const double *p, double *T,
+                                                 int n, int stride,
+                                                 bool warm) const
+{
+  const double Dunit = units.GramsPerCubicCentimeter();
+  const double Funit = units.MeVPerCubicFemtometer();
+
+  for (int i=0; i<n; ++i) {
+    const double logD = log10(D[i*stride]/Dunit);
+    const double logp = log10(p[i*stride]/Funit);
+    T[i] = this->inverse_lookup_T_near(SampleP, logD, logp, warm ? T[i] : NAN);
+  }
+}
+void ShenTabulatedNuclearEos::TemperatureBatch_u(const double *D,
+                                                 const double *u, double *T,
+                                                 int n, int stride,
+                                                 bool warm) const
+{
+  const double Dunit = units.GramsPerCubicCentimeter();
+  const double Funit = units.MeVPerCubicFemtometer();
+
+  for (int i=0; i<n; ++i) {
+    const double logD = log10(D[i*stride]/Dunit);
+    const double logu = log10(u[i*stride]/Funit);
+    T[i] = this->inverse_lookup_T_near(SampleU, logD, logu, warm ? T[i] : NAN);
+  }
+}
 
 double ShenTabulatedNuclearEos::Derivatives_u(double D, double logT, double *J) const
 {
@@ -409,7 +681,7 @@ double ShenTabulatedNuclearEos::Derivatives_u(double D, double logT, double *J)
 
   // J will first hold dlogu / dlogx = (x/u) (du/dx)
   // ---------------------------------------------------------------------------
-  const double u = pow(10.0, sample_EOS(EOS_u, logD, logT, J));
+  const double u = pow(10.0, sample_EOS(SampleU, logD, logT, J));
 
   J[0] *= u/D * units.MeVPerCubicFemtometer();
   J[1] *= u   * units.MeVPerCubicFemtometer() * log(10);
@@ -422,13 +694,36 @@ double ShenTabulatedNuclearEos::Derivatives_p(double D, double logT, double *J)
 
   // J will first hold dlogp / dlogx = (x/u) (du/dx)
   // ---------------------------------------------------------------------------
-  const double p = pow(10.0, sample_EOS(EOS_p, logD, logT, J));
+  const double p = pow(10.0, sample_EOS(SampleP, logD, logT, J));
 
   J[0] *= p/D * units.MeVPerCubicFemtometer();
   J[1] *= p   * units.MeVPerCubicFemtometer() * log(10);
 
   return p * units.MeVPerCubicFemtometer();
 }
+void ShenTabulatedNuclearEos::Derivatives_pu(double D, double logT,
+                                             double *p, double *u,
+                                             double *Jp, double *Ju) const
+// -----------------------------------------------------------------------------
+// Same as Derivatives_p and Derivatives_u, but with a single table lookup
+// -----------------------------------------------------------------------------
+{
+  const double logD = log10(D/units.GramsPerCubicCentimeter());
+  double S[3*NumSampled];
+
+  this->SampleAll(logD, logT, S);
+
+  const double p0 = pow(10.0, S[3*SampleP]);
+  const double u0 = pow(10.0, S[3*SampleU]);
+
+  Jp[0] = S[3*SampleP+1] * p0/D * units.MeVPerCubicFemtometer();
+  Jp[1] = S[3*SampleP+2] * p0   * units.MeVPerCubicFemtometer() * log(10);
+  Ju[0] = S[3*SampleU+1] * u0/D * units.MeVPerCubicFemtometer();
+  Ju[1] = S[3*SampleU+2] * u0   * units.MeVPerCubicFemtometer() * log(10);
+
+  *p = p0 * units.MeVPerCubicFemtometer();
+  *u = u0 * units.MeVPerCubicFemtometer();
+}
 
 
 
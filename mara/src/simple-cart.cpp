@@ -3,6 +3,7 @@
 #include <iostream>
 #include "valman.hpp"
 #include "simple-cart.hpp"
+#include "profile.hpp"
 
 typedef SimpleCartesianDomain Domain;
 
@@ -80,6 +81,7 @@ Domain::~SimpleCartesianDomain()
 
 void Domain::Synchronize(std::valarray<double> &A) const
 {
+  Profile::Scope timer(Profile::TIMER_SYNCHRONIZE);
   const int &Nx = loc_shape[0];
   const int &Ny = loc_shape[1];
   const int &Nz = loc_shape[2];
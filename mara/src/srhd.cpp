@@ -58,7 +58,11 @@ int Srhd::ConsCheck(const double *U_) const
   return rmhd_c2p_check_cons(U);
 }
 
-int Srhd::ConsToPrim(const double *U_, double *P_) const
+static int invert_srhd(rmhd_c2p_context &c2p, const double *U_, double *P_)
+// -----------------------------------------------------------------------------
+// Drives the cons to prim inversion of a single zone with a context whose
+// adiabatic index has already been set.
+// -----------------------------------------------------------------------------
 {
   double U[8] = { 0,0,0,0,0,0,0,0 };
   double P[8] = { 0,0,0,0,0,0,0,0 };
@@ -66,34 +70,61 @@ int Srhd::ConsToPrim(const double *U_, double *P_) const
   memcpy(U, U_, 5*sizeof(double));
   memcpy(P, P_, 5*sizeof(double));
 
-  // This piece of code drives cons to prim inversions for a gamma-law equation
-  // of state.
-  // ---------------------------------------------------------------------------
-  rmhd_c2p_set_gamma(Mara->GetEos<AdiabaticEos>().Gamma);
-  rmhd_c2p_new_state(U);
+  rmhd_c2p_new_state_r(&c2p, U);
 
   int error = 1;
 
   if (error) {
-    rmhd_c2p_set_starting_prim(P);
-    error = rmhd_c2p_solve_anton2dzw(P);
+    rmhd_c2p_set_starting_prim_r(&c2p, P);
+    error = rmhd_c2p_solve_anton2dzw_r(&c2p, P);
   }
   if (error) {
-    rmhd_c2p_estimate_from_cons();
-    error = rmhd_c2p_solve_anton2dzw(P);
+    rmhd_c2p_estimate_from_cons_r(&c2p);
+    error = rmhd_c2p_solve_anton2dzw_r(&c2p, P);
   }
   if (error) {
-    rmhd_c2p_set_starting_prim(P);
-    error = rmhd_c2p_solve_noble1dw(P);
+    rmhd_c2p_set_starting_prim_r(&c2p, P);
+    error = rmhd_c2p_solve_noble1dw_r(&c2p, P);
   }
   if (error) {
-    rmhd_c2p_estimate_from_cons();
-    error = rmhd_c2p_solve_noble1dw(P);
+    rmhd_c2p_estimate_from_cons_r(&c2p);
+    error = rmhd_c2p_solve_noble1dw_r(&c2p, P);
   }
 
   memcpy(P_, P, 5*sizeof(double));
   return error;
 }
+int Srhd::ConsToPrim(const double *U, double *P) const
+{
+  // This piece of code drives cons to prim inversions for a gamma-law equation
+  // of state.
+  // ---------------------------------------------------------------------------
+  rmhd_c2p_context c2p;
+  rmhd_c2p_context_init(&c2p);
+  rmhd_c2p_set_gamma_r(&c2p, Mara->GetEos<AdiabaticEos>().Gamma);
+
+  return invert_srhd(c2p, U, P);
+}
+int Srhd::ConsToPrimBatch(const double *U, double *P, int nzones,
+                          int *fail) const
+// -----------------------------------------------------------------------------
+// The inversion is iterative, so it is not vectorized. One context is set up
+// for the whole batch, rather than once for every zone.
+// -----------------------------------------------------------------------------
+{
+  rmhd_c2p_context c2p;
+  rmhd_c2p_context_init(&c2p);
+  rmhd_c2p_set_gamma_r(&c2p, Mara->GetEos<AdiabaticEos>().Gamma);
+
+  int ttl_error = 0;
+
+  for (int n=0; n<nzones; ++n) {
+    const int error = (invert_srhd(c2p, &U[5*n], &P[5*n]) != 0);
+    if (fail) fail[n] = error;
+    ttl_error += error;
+  }
+  return ttl_error;
+}
 int Srhd::PrimToCons(const double *P, double *U) const
 {
   const double gm   =   Mara->GetEos<AdiabaticEos>().Gamma;
@@ -115,6 +146,42 @@ int Srhd::PrimToCons(const double *P, double *U) const
 
   return 0;
 }
+int Srhd::PrimToConsBatch(const double *P, double *U, int nzones,
+                          int *fail) const
+// -----------------------------------------------------------------------------
+// Same arithmetic as PrimToCons, over nzones zones, with the superluminal check
+// made in a second pass so that the first loop may be vectorized.
+// -----------------------------------------------------------------------------
+{
+  const double gm = Mara->GetEos<AdiabaticEos>().Gamma;
+  int ttl_error = 0;
+
+  for (int n=0; n<nzones; ++n) {
+    const double *p = &P[5*n];
+    double *u = &U[5*n];
+    const double Rho = p[rho], Pre = p[pre];
+    const double Vx = p[vx], Vy = p[vy], Vz = p[vz];
+    const double V2   =   Vx*Vx + Vy*Vy + Vz*Vz;
+    const double W2   =   1.0 / (1.0 - V2);
+    const double W    =   sqrt(W2);
+    const double e    =   Pre / (Rho * (gm - 1.0));
+    const double h    =   1.0 + e + Pre/Rho;
+
+    u[ddd] = Rho*W;
+    u[tau] = Rho*h*W2 - Pre - u[ddd];
+    u[Sx]  = Rho*h*W2*Vx;
+    u[Sy]  = Rho*h*W2*Vy;
+    u[Sz]  = Rho*h*W2*Vz;
+  }
+
+  for (int n=0; n<nzones; ++n) {
+    const double *p = &P[5*n];
+    const int error = (p[vx]*p[vx] + p[vy]*p[vy] + p[vz]*p[vz] >= 1.0);
+    if (fail) fail[n] = error;
+    ttl_error += error;
+  }
+  return ttl_error;
+}
 void Srhd::FluxAndEigenvalues(const double *U,
                               const double *P, double *F,
                               double *ap, double *am, int dimension) const
@@ -175,6 +242,59 @@ void Srhd::FluxAndEigenvalues(const double *U,
   }
 }
 
+void Srhd::FluxAndEigenvaluesBatch(const double *U,
+                                   const double *P, double *F,
+                                   double *ap, double *am, int nzones,
+                                   int dimension) const
+// -----------------------------------------------------------------------------
+// Same arithmetic as FluxAndEigenvalues, over nzones zones. The axis is chosen
+// once, outside the loops, and the causality limit on the eigenvalues is
+// applied as a select, so that the loops may be vectorized.
+// -----------------------------------------------------------------------------
+{
+  const double gm = Mara->GetEos<AdiabaticEos>().Gamma;
+
+  int S1=Sx, S2=Sy, S3=Sz; // Conserved momenta, and the velocity along the axis
+  switch (dimension) {
+  case 1: S1=Sx; S2=Sy; S3=Sz; break;
+  case 2: S1=Sy; S2=Sz; S3=Sx; break;
+  case 3: S1=Sz; S2=Sx; S3=Sy; break;
+  }
+  const int v1 = S1 - Sx + vx;
+
+  for (int n=0; n<nzones; ++n) {
+    const double *u = &U[5*n];
+    const double *p = &P[5*n];
+    double *f = &F[5*n];
+    const double v = p[v1], pg = p[pre];
+
+    f[ddd] = u[ddd] * v;
+    f[tau] = u[tau] * v + pg*v;
+    f[S1 ] = u[S1 ] * v + pg;
+    f[S2 ] = u[S2 ] * v;
+    f[S3 ] = u[S3 ] * v;
+  }
+
+  if (ap == NULL || am == NULL) return; // User may skip eigenvalue calculation
+
+  for (int n=0; n<nzones; ++n) {
+    const double *p = &P[5*n];
+    const double vx2 = p[vx]*p[vx];
+    const double vy2 = p[vy]*p[vy];
+    const double vz2 = p[vz]*p[vz];
+    const double v12 = p[v1]*p[v1];
+    const double   e = p[pre] / (p[rho] * (gm - 1.0));
+    const double cs2 = gm * p[pre] / (p[pre] + p[rho] + p[rho]*e);
+    const double v2  = vx2 + vy2 + vz2;
+
+    const double a = (p[v1]*(1-cs2) + sqrt(cs2*(1-v2)*(1-v2*cs2-v12*(1-cs2))))/(1-v2*cs2);
+    const double b = (p[v1]*(1-cs2) - sqrt(cs2*(1-v2)*(1-v2*cs2-v12*(1-cs2))))/(1-v2*cs2);
+    const bool acausal = (fabs(a)>1.0 || fabs(b)>1.0);
+
+    ap[n] = acausal ?  1.0 : a;
+    am[n] = acausal ? -1.0 : b;
+  }
+}
 
 void Srhd::Eigensystem(const double *U, const double *P_,
                        double *L, double *R, double *lam, int dim) const
@@ -328,3 +448,21 @@ void Srhd::Eigensystem(const double *U, const double *P_,
   lam[3] = u;
   lam[4] = u;
 }
+void Srhd::EigensystemBatch(const double *U, const double *P,
+                            double *L, double *R, double *lam, int nzones,
+                            int dim) const
+// The generic loop, with the call to Eigensystem bound statically
+{
+  double Lf[25], Rf[25], lamf[5];
+
+  for (int n=0; n<nzones; ++n) {
+    this->Srhd::Eigensystem(&U[n*5], &P[n*5], Lf, Rf, lamf, dim);
+    for (int m=0; m<25; ++m) {
+      L[m*nzones + n] = Lf[m];
+      R[m*nzones + n] = Rf[m];
+    }
+    for (int q=0; q<5; ++q) {
+      lam[q*nzones + n] = lamf[q];
+    }
+  }
+}
@@ -24,12 +24,23 @@ public:
   virtual ~AdiabaticIdealSrhd() { }
   virtual int ConsToPrim(const double *U, double *P) const;
   virtual int PrimToCons(const double *P, double *U) const;
+  virtual int ConsToPrimBatch(const double *U, double *P, int nzones,
+                              int *fail) const;
+  virtual int PrimToConsBatch(const double *P, double *U, int nzones,
+                              int *fail) const;
 
   void FluxAndEigenvalues(const double *U,
 			  const double *P, double *F,
 			  double *ap, double *am, int dimension) const;
+  virtual void FluxAndEigenvaluesBatch(const double *U,
+                                       const double *P, double *F,
+                                       double *ap, double *am, int nzones,
+                                       int dimension) const;
   void Eigensystem(const double *U, const double *P,
 		   double *L, double *R, double *lam, int dim) const;
+  void EigensystemBatch(const double *U, const double *P,
+                        double *L, double *R, double *lam, int nzones,
+                        int dim) const;
 
   int GetNq() const { return 5; }
   std::vector<std::string> GetPrimNames() const;
@@ -40,4 +51,20 @@ public:
   int ConsCheck(const double *U) const;
 } ;
 
+template <> struct FluidBatchCalls<AdiabaticIdealSrhd>
+{
+  static int PrimToCons(const AdiabaticIdealSrhd &f, const double *P, double *U,
+                        int nzones, int nq, int *fail)
+  {
+    return f.AdiabaticIdealSrhd::PrimToConsBatch(P, U, nzones, fail);
+  }
+  static void FluxAndEigenvalues(const AdiabaticIdealSrhd &f, const double *U,
+                                 const double *P, double *F,
+                                 double *ap, double *am, int nzones, int nq,
+                                 int dim)
+  {
+    f.AdiabaticIdealSrhd::FluxAndEigenvaluesBatch(U, P, F, ap, am, nzones, dim);
+  }
+} ;
+
 #endif // __AdiabaticIdealSrhd_HEADER__
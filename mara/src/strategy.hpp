@@ -137,7 +137,7 @@ public:
     const AdiabaticIdealEulers &fluid =
       dynamic_cast<const AdiabaticIdealEulers&>(problem.GetFluid());
 
-    riemann = new ExactEulersRiemannSolver(fluid);
+    riemann = new ExactEulersRiemannSolver;
     deriv   = new PlmMethodOfLinesSplit(domain, boundary, fluid, *riemann);
     RK      = new RungeKuttaShuOsherRk3;
   }
@@ -156,7 +156,7 @@ public:
     const AdiabaticIdealEulers &fluid =
       dynamic_cast<const AdiabaticIdealEulers&>(problem.GetFluid());
 
-    riemann = new ExactEulersRiemannSolver(fluid);
+    riemann = new ExactEulersRiemannSolver;
     deriv   = new PlmCtuHancockOperator(domain, boundary, fluid, *riemann);
     RK      = new RungeKuttaSingleStep;
   }
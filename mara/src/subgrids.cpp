@@ -2,8 +2,10 @@
 #include "config.h"
 #if (__MARA_USE_MPI)
 
+#include <cstring>
 #include "subgrids.hpp"
 #include "valman.hpp"
+#include "profile.hpp"
 
 typedef DecomposedCartesianDomain Domain;
 
@@ -114,11 +116,22 @@ Domain::DecomposedCartesianDomain(const double *x0, const double *x1, const int
     create_cart_3d();
     break;
   }
+  create_faces();
 }
 Domain::~DecomposedCartesianDomain()
 {
-  for (size_t i=0; i<send_type.size(); ++i) MPI_Type_free(&send_type[i]);
-  for (size_t i=0; i<recv_type.size(); ++i) MPI_Type_free(&recv_type[i]);
+  for (int p=0; p<NUM_PATTERNS; ++p) {
+    for (size_t i=0; i<messages[p].size(); ++i) {
+      MPI_Type_free(&messages[p][i].send_type);
+      MPI_Type_free(&messages[p][i].recv_type);
+    }
+  }
+  for (size_t c=0; c<channels.size(); ++c) {
+    for (size_t i=0; i<channels[c]->requests.size(); ++i) {
+      MPI_Request_free(&channels[c]->requests[i]);
+    }
+    delete channels[c];
+  }
   MPI_Type_free(&mpi_type);
   MPI_Comm_free(&mpi_cart);
 
@@ -129,20 +142,254 @@ Domain::~DecomposedCartesianDomain()
   free(Specs.G_strt);
 }
 
+bool Domain::corners_needed() const
+{
+  return Mara->godunov == NULL || Mara->godunov->NeedsCornerGuards();
+}
 void Domain::Synchronize(std::valarray<double> &A) const
+// -----------------------------------------------------------------------------
+// Fills the guard zones from the neighboring subgrids. If the Godunov operator
+// needs the edges and corners, the faces are exchanged one axis after another,
+// which takes 2 messages per axis rather than one to each of the 3^D-1
+// neighbors. Otherwise all the faces are exchanged at once, and the edges and
+// corners are filled locally by extending the face guard zones.
+// -----------------------------------------------------------------------------
+{
+  Profile::Scope timer(Profile::TIMER_SYNCHRONIZE);
+
+  if (in_flight.count(&A[0])) {
+    EndSynchronize(A); // the last exchange of A was never ended
+  }
+  if (Ng == 0) return;
+
+  if (corners_needed()) {
+    for (int d=0; d<num_dims; ++d) {
+      Exchange ex;
+      post(A, FACES_SEQUENTIAL, 2*d, 2*d+2, ex);
+      complete(A, ex);
+    }
+  }
+  else {
+    Exchange ex;
+    post(A, FACES_ONLY, 0, 2*num_dims, ex);
+    complete(A, ex);
+    fill_corners(A);
+  }
+}
+void Domain::BeginSynchronize(std::valarray<double> &A) const
+// -----------------------------------------------------------------------------
+// Posts the sends of the interior layers and the receives into the guard zones,
+// without waiting for either. Messages between two subgrids with the same tag
+// are matched in the order they were posted, so several arrays may be in flight
+// at once as long as every subgrid begins them in the same order. Since the
+// axes cannot be exchanged one after another here, the edges and corners are
+// exchanged with each of the 3^D-1 neighbors when the operator needs them.
+// -----------------------------------------------------------------------------
+{
+  Profile::Scope timer(Profile::TIMER_SYNCHRONIZE);
+
+  if (in_flight.count(&A[0])) {
+    EndSynchronize(A); // the last exchange of A was never ended
+  }
+  Exchange &ex = in_flight[&A[0]];
+  ex.faces_only = !corners_needed();
+
+  if (Ng == 0) return;
+
+  if (ex.faces_only) {
+    post(A, FACES_ONLY, 0, 2*num_dims, ex);
+  }
+  else {
+    post(A, ALL_NEIGHBORS, 0, messages[ALL_NEIGHBORS].size(), ex);
+  }
+}
+void Domain::EndSynchronize(std::valarray<double> &A) const
+// -----------------------------------------------------------------------------
+// Waits for the exchange begun on A, if there is one.
+// -----------------------------------------------------------------------------
+{
+  std::map<const double*, Exchange>::iterator it = in_flight.find(&A[0]);
+  if (it == in_flight.end()) return;
+
+  Profile::Scope timer(Profile::TIMER_SYNCHRONIZE);
+
+  complete(A, it->second);
+  if (it->second.faces_only && Ng != 0) {
+    fill_corners(A);
+  }
+  in_flight.erase(it);
+}
+void Domain::post(std::valarray<double> &A, int pattern, int m0, int m1,
+                  Exchange &ex) const
+// -----------------------------------------------------------------------------
+// Starts the messages [m0, m1) of the given pattern. With the datatype method,
+// MPI reads and writes A through the subarray types. With the persistent
+// method, the zones to send are packed into the buffers of a channel here, and
+// those received are unpacked from it by complete.
+// -----------------------------------------------------------------------------
+{
+  const std::vector<Message> &M = messages[pattern];
+  Profile::Count(Profile::COUNT_MESSAGES, 2*(m1-m0));
+
+  if (exchange_method == EXCHANGE_PERSISTENT) {
+    Channel *ch = acquire_channel(pattern, m0, m1);
+    for (int m=m0; m<m1; ++m) {
+      pack(&A[0], M[m].send_start, M[m].subsize, &ch->send_buf[ch->offset[m-m0]]);
+    }
+    MPI_Startall(ch->requests.size(), &ch->requests[0]);
+    ex.channel = ch;
+  }
+  else {
+    for (int m=m0; m<m1; ++m) {
+      MPI_Request req1, req2;
+      MPI_Isend(&A[0], 1, M[m].send_type, M[m].neighbor, M[m].send_tag, mpi_cart, &req1);
+      MPI_Irecv(&A[0], 1, M[m].recv_type, M[m].neighbor, M[m].recv_tag, mpi_cart, &req2);
+      ex.requests.push_back(req1);
+      ex.requests.push_back(req2);
+    }
+  }
+}
+void Domain::complete(std::valarray<double> &A, Exchange &ex) const
 {
-  std::vector<MPI_Request> requests;
-  std::vector<MPI_Status> statuses;
-  for (size_t i=0; i < neighbors.size(); ++i) {
-    MPI_Request req1, req2;
-
-    MPI_Isend(&A[0], 1, send_type[i], neighbors[i], send_tags[i], mpi_cart, &req1);
-    MPI_Irecv(&A[0], 1, recv_type[i], neighbors[i], recv_tags[i], mpi_cart, &req2);
-    requests.push_back(req1);
-    requests.push_back(req2);
-  }
-  statuses.resize(requests.size());
-  MPI_Waitall(requests.size(), &requests[0], &statuses[0]);
+  if (ex.channel) {
+    Channel *ch = ex.channel;
+    const std::vector<Message> &M = messages[ch->pattern];
+
+    MPI_Waitall(ch->requests.size(), &ch->requests[0], MPI_STATUSES_IGNORE);
+    for (int m=ch->m0; m<ch->m1; ++m) {
+      unpack(&A[0], M[m].recv_start, M[m].subsize, &ch->recv_buf[ch->offset[m-ch->m0]]);
+    }
+    ch->busy = false;
+    ex.channel = NULL;
+  }
+  else if (!ex.requests.empty()) {
+    MPI_Waitall(ex.requests.size(), &ex.requests[0], MPI_STATUSES_IGNORE);
+    ex.requests.clear();
+  }
+}
+Domain::Channel *Domain::acquire_channel(int pattern, int m0, int m1) const
+// -----------------------------------------------------------------------------
+// Returns an idle channel for the messages [m0, m1) of the given pattern,
+// creating one the first time it is needed.
+// -----------------------------------------------------------------------------
+{
+  for (size_t c=0; c<channels.size(); ++c) {
+    Channel *ch = channels[c];
+    if (!ch->busy && ch->pattern == pattern && ch->m0 == m0 && ch->m1 == m1) {
+      ch->busy = true;
+      return ch;
+    }
+  }
+
+  const std::vector<Message> &M = messages[pattern];
+  Channel *ch = new Channel;
+  ch->pattern = pattern;
+  ch->m0 = m0;
+  ch->m1 = m1;
+  ch->busy = true;
+
+  ch->offset.push_back(0);
+  for (int m=m0; m<m1; ++m) {
+    const int *n = M[m].subsize;
+    ch->offset.push_back(ch->offset.back() + n[0]*n[1]*n[2]*Nq);
+  }
+  ch->send_buf.resize(ch->offset.back());
+  ch->recv_buf.resize(ch->offset.back());
+  ch->requests.resize(2*(m1-m0));
+
+  for (int m=m0; m<m1; ++m) {
+    const int k = m - m0;
+    const int count = ch->offset[k+1] - ch->offset[k];
+    MPI_Send_init(&ch->send_buf[ch->offset[k]], count, MPI_DOUBLE, M[m].neighbor,
+		  M[m].send_tag, mpi_cart, &ch->requests[2*k+0]);
+    MPI_Recv_init(&ch->recv_buf[ch->offset[k]], count, MPI_DOUBLE, M[m].neighbor,
+		  M[m].recv_tag, mpi_cart, &ch->requests[2*k+1]);
+  }
+  channels.push_back(ch);
+  return ch;
+}
+void Domain::pack(const double *A, const int *start, const int *subsize,
+                  double *buf) const
+// -----------------------------------------------------------------------------
+// Copies the box of zones at start with shape subsize into buf, in the order of
+// MPI_ORDER_C. The last axis is contiguous in A, so it is copied a row at once.
+// -----------------------------------------------------------------------------
+{
+  const int nj = (num_dims > 1) ? loc_shape[1] + 2*Ng : 1;
+  const int nk = (num_dims > 2) ? loc_shape[2] + 2*Ng : 1;
+  const int sj = nk*Nq;
+  const int si = nj*sj;
+  const int row = subsize[2]*Nq;
+
+  for (int i=0; i<subsize[0]; ++i) {
+    for (int j=0; j<subsize[1]; ++j) {
+      const double *a = A + (start[0]+i)*si + (start[1]+j)*sj + start[2]*Nq;
+      std::memcpy(buf, a, row*sizeof(double));
+      buf += row;
+    }
+  }
+}
+void Domain::unpack(double *A, const int *start, const int *subsize,
+                    const double *buf) const
+{
+  const int nj = (num_dims > 1) ? loc_shape[1] + 2*Ng : 1;
+  const int nk = (num_dims > 2) ? loc_shape[2] + 2*Ng : 1;
+  const int sj = nk*Nq;
+  const int si = nj*sj;
+  const int row = subsize[2]*Nq;
+
+  for (int i=0; i<subsize[0]; ++i) {
+    for (int j=0; j<subsize[1]; ++j) {
+      double *a = A + (start[0]+i)*si + (start[1]+j)*sj + start[2]*Nq;
+      std::memcpy(a, buf, row*sizeof(double));
+      buf += row;
+    }
+  }
+}
+void Domain::fill_corners(std::valarray<double> &A) const
+// -----------------------------------------------------------------------------
+// Sets each guard zone lying outside the interior along more than one axis to
+// the face guard zone found by moving it into the interior along all but the
+// first of those axes. The values are plausible, so that the zones may be
+// inverted without failing, but are not those of the neighboring subgrids.
+// -----------------------------------------------------------------------------
+{
+  int n[3] = { 1, 1, 1 };
+  int lo[3] = { 0, 0, 0 };
+  int hi[3] = { 0, 0, 0 };
+  for (int d=0; d<num_dims; ++d) {
+    n [d] = loc_shape[d] + 2*Ng;
+    lo[d] = Ng;
+    hi[d] = loc_shape[d] + Ng - 1;
+  }
+  const int sk = Nq;
+  const int sj = n[2]*sk;
+  const int si = n[1]*sj;
+
+  for (int i=0; i<n[0]; ++i) {
+    for (int j=0; j<n[1]; ++j) {
+      const int gi = (num_dims > 0) && (i < lo[0] || i > hi[0]);
+      const int gj = (num_dims > 1) && (j < lo[1] || j > hi[1]);
+      if (!gi && !gj) continue; // only face guard zones in this row
+
+      for (int k=0; k<n[2]; ++k) {
+        const int gk = (num_dims > 2) && (k < lo[2] || k > hi[2]);
+        if (gi + gj + gk < 2) continue;
+
+        int src[3] = { i, j, k };
+        int first = gi ? 0 : 1;
+        for (int d=first+1; d<num_dims; ++d) {
+          if (src[d] < lo[d]) src[d] = lo[d];
+          if (src[d] > hi[d]) src[d] = hi[d];
+        }
+        const int m0 = i*si + j*sj + k*sk;
+        const int m1 = src[0]*si + src[1]*sj + src[2]*sk;
+        for (int q=0; q<Nq; ++q) {
+          A[m0+q] = A[m1+q];
+        }
+      }
+    }
+  }
 }
 int Domain::SubgridRank() const
 {
@@ -167,7 +414,6 @@ void Domain::create_cart_1d()
     if (!i) continue; // if neighbor is me, don't do anything
 
     int nint[1] = { loc_shape[0]      };
-    int size[1] = { loc_shape[0]+2*Ng };
 
     int Plx[3] = { Ng,Ng,nint[0] };
 
@@ -178,24 +424,8 @@ void Domain::create_cart_1d()
     int start_recv[1] = { Qlx[i+1] };
 
     int subsize[1] = { (1-abs(i))*nint[0] + abs(i)*Ng };
-    int index[1];
-    for (int d=0; d<1; ++d) {
-      index[d] = mpi_index[d] + rel_index[d];
-    }
-    int their_rank;
-    MPI_Cart_rank(mpi_cart, index, &their_rank);
-    neighbors.push_back(their_rank);
-    send_tags.push_back(1*(+i+5));
-    recv_tags.push_back(1*(-i+5));
-
-    MPI_Datatype send, recv;
-    MPI_Type_create_subarray(1, size, subsize, start_send, MPI_ORDER_C, mpi_type, &send);
-    MPI_Type_create_subarray(1, size, subsize, start_recv, MPI_ORDER_C, mpi_type, &recv);
-    MPI_Type_commit(&send);
-    MPI_Type_commit(&recv);
 
-    send_type.push_back(send);
-    recv_type.push_back(recv);
+    add_message(ALL_NEIGHBORS, rel_index, start_send, start_recv, subsize, 0);
   }
 }
 void Domain::create_cart_2d()
@@ -205,7 +435,6 @@ void Domain::create_cart_2d()
       if (!i && !j) continue; // if neighbor is me, don't do anything
 
       int nint[2] = { loc_shape[0]     , loc_shape[1]      };
-      int size[2] = { loc_shape[0]+2*Ng, loc_shape[1]+2*Ng };
 
       int Plx[3] = { Ng,Ng,nint[0] };
       int Ply[3] = { Ng,Ng,nint[1] };
@@ -219,24 +448,8 @@ void Domain::create_cart_2d()
 
       int subsize[2] = { (1-abs(i))*nint[0] + abs(i)*Ng,
                          (1-abs(j))*nint[1] + abs(j)*Ng };
-      int index[2];
-      for (int d=0; d<2; ++d) {
-        index[d] = mpi_index[d] + rel_index[d];
-      }
-      int their_rank;
-      MPI_Cart_rank(mpi_cart, index, &their_rank);
-      neighbors.push_back(their_rank);
-      send_tags.push_back(10*(+i+5) + 1*(+j+5));
-      recv_tags.push_back(10*(-i+5) + 1*(-j+5));
-
-      MPI_Datatype send, recv;
-      MPI_Type_create_subarray(2, size, subsize, start_send, MPI_ORDER_C, mpi_type, &send);
-      MPI_Type_create_subarray(2, size, subsize, start_recv, MPI_ORDER_C, mpi_type, &recv);
-      MPI_Type_commit(&send);
-      MPI_Type_commit(&recv);
-
-      send_type.push_back(send);
-      recv_type.push_back(recv);
+
+      add_message(ALL_NEIGHBORS, rel_index, start_send, start_recv, subsize, 0);
     }
   }
 }
@@ -248,7 +461,6 @@ void Domain::create_cart_3d()
         if (!i && !j && !k) continue; // if neighbor is me, don't do anything
 
         int nint[3] = { loc_shape[0]     , loc_shape[1]     , loc_shape[2]      };
-        int size[3] = { loc_shape[0]+2*Ng, loc_shape[1]+2*Ng, loc_shape[2]+2*Ng };
 
         int Plx[3] = { Ng,Ng,nint[0] };
         int Ply[3] = { Ng,Ng,nint[1] };
@@ -265,29 +477,87 @@ void Domain::create_cart_3d()
         int subsize[3] = { (1-abs(i))*nint[0] + abs(i)*Ng,
                            (1-abs(j))*nint[1] + abs(j)*Ng,
                            (1-abs(k))*nint[2] + abs(k)*Ng };
-        int index[3];
-        for (int d=0; d<3; ++d) {
-          index[d] = mpi_index[d] + rel_index[d];
-        }
 
-        int their_rank;
-        MPI_Cart_rank(mpi_cart, index, &their_rank);
-        neighbors.push_back(their_rank);
-        send_tags.push_back(100*(+i+5) + 10*(+j+5) + 1*(+k+5));
-        recv_tags.push_back(100*(-i+5) + 10*(-j+5) + 1*(-k+5));
+        add_message(ALL_NEIGHBORS, rel_index, start_send, start_recv, subsize, 0);
+      }
+    }
+  }
+}
+void Domain::create_faces()
+{
+  for (int d=0; d<num_dims; ++d) {
+    for (int s=-1; s<=1; s+=2) {
+
+      int rel_index[3] = { 0, 0, 0 };
+      rel_index[d] = s;
+
+      for (int p=FACES_ONLY; p<=FACES_SEQUENTIAL; ++p) {
+        int start_send[3], start_recv[3], subsize[3];
+
+        for (int e=0; e<num_dims; ++e) {
+          const int nint = loc_shape[e];
+
+          if (e == d) {
+            start_send[e] = (s < 0) ? Ng : nint;
+            start_recv[e] = (s < 0) ? 0  : nint + Ng;
+            subsize   [e] = Ng;
+          }
+          else if (p == FACES_SEQUENTIAL && e < d) {
+            start_send[e] = 0;
+            start_recv[e] = 0;
+            subsize   [e] = nint + 2*Ng;
+          }
+          else {
+            start_send[e] = Ng;
+            start_recv[e] = Ng;
+            subsize   [e] = nint;
+          }
+        }
+        add_message(p, rel_index, start_send, start_recv, subsize, 1000);
+      }
+    }
+  }
+}
+void Domain::add_message(int pattern, const int *rel_index, const int *start_send,
+                         const int *start_recv, const int *subsize, int tag_base)
+// -----------------------------------------------------------------------------
+// Appends a message to the neighbor at rel_index, whose entries are in
+// {-1,0,1}, to the given pattern. The arrays have one entry per dimension. The
+// tag of the message identifies the direction in which it travels.
+// -----------------------------------------------------------------------------
+{
+  int size[3], index[3];
+  for (int d=0; d<num_dims; ++d) {
+    size [d] = loc_shape[d] + 2*Ng;
+    index[d] = mpi_index[d] + rel_index[d];
+  }
 
+  Message M;
+  MPI_Cart_rank(mpi_cart, index, &M.neighbor);
 
-        MPI_Datatype send, recv;
-        MPI_Type_create_subarray(3, size, subsize, start_send, MPI_ORDER_C, mpi_type, &send);
-        MPI_Type_create_subarray(3, size, subsize, start_recv, MPI_ORDER_C, mpi_type, &recv);
-        MPI_Type_commit(&send);
-        MPI_Type_commit(&recv);
+  M.send_tag = tag_base;
+  M.recv_tag = tag_base;
+  for (int d=0, w=1; d<num_dims; ++d, w*=10) {
+    M.send_tag += w*(+rel_index[num_dims-1-d]+5);
+    M.recv_tag += w*(-rel_index[num_dims-1-d]+5);
+  }
 
-        send_type.push_back(send);
-        recv_type.push_back(recv);
-      }
-    }
+  for (int d=0; d<3; ++d) {
+    M.send_start[d] = (d < num_dims) ? start_send[d] : 0;
+    M.recv_start[d] = (d < num_dims) ? start_recv[d] : 0;
+    M.subsize   [d] = (d < num_dims) ? subsize   [d] : 1;
   }
+
+  MPI_Type_create_subarray(num_dims, size, const_cast<int*>(subsize),
+			   const_cast<int*>(start_send), MPI_ORDER_C, mpi_type,
+			   &M.send_type);
+  MPI_Type_create_subarray(num_dims, size, const_cast<int*>(subsize),
+			   const_cast<int*>(start_recv), MPI_ORDER_C, mpi_type,
+			   &M.recv_type);
+  MPI_Type_commit(&M.send_type);
+  MPI_Type_commit(&M.recv_type);
+
+  messages[pattern].push_back(M);
 }
 int Domain::SubgridAtPosition(const double *r) const
 {
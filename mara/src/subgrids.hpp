@@ -5,22 +5,82 @@
 #ifndef __DecomposedCartesianDomain_HEADER__
 #define __DecomposedCartesianDomain_HEADER__
 
+#include <map>
 #include <mpi.h>
 #include "hydro.hpp"
 
 class DecomposedCartesianDomain : public PhysicalDomain
 {
 protected:
+  // ---------------------------------------------------------------------------
+  // A message to one neighbor. The zones sent from and received into the local
+  // array are given both as MPI datatypes and as boxes of zones, the latter
+  // for the pack and unpack kernels.
+  // ---------------------------------------------------------------------------
+  struct Message
+  {
+    int neighbor, send_tag, recv_tag;
+    MPI_Datatype send_type, recv_type;
+    int send_start[3], recv_start[3], subsize[3];
+  } ;
+
+  // ---------------------------------------------------------------------------
+  // Exchange patterns. ALL_NEIGHBORS has a message to each of the 3^D-1
+  // neighbors. The others have messages to the two face neighbors along each
+  // axis, in the order x0, x1, y0, ... Those of FACES_ONLY span the interior in
+  // the transverse directions. Those of FACES_SEQUENTIAL also span the guard
+  // zones of the axes before their own, so exchanging one axis after another
+  // fills the edges and corners.
+  // ---------------------------------------------------------------------------
+  enum { ALL_NEIGHBORS, FACES_ONLY, FACES_SEQUENTIAL, NUM_PATTERNS };
+  std::vector<Message> messages[NUM_PATTERNS];
+
+  // ---------------------------------------------------------------------------
+  // Used by the persistent exchange method: contiguous buffers for the
+  // messages [m0, m1) of one pattern, with persistent requests bound to them. A
+  // channel is busy while an exchange through it is in flight, so there are as
+  // many channels as arrays which have been in flight at once.
+  // ---------------------------------------------------------------------------
+  struct Channel
+  {
+    int pattern, m0, m1;
+    std::vector<double> send_buf, recv_buf;
+    std::vector<int> offset; // of each message in the buffers, and the total
+    std::vector<MPI_Request> requests;
+    bool busy;
+  } ;
+  mutable std::vector<Channel*> channels;
+
+  // An exchange begun but not yet ended
+  struct Exchange
+  {
+    std::vector<MPI_Request> requests; // datatype method
+    Channel *channel;                  // persistent method
+    bool faces_only;
+    Exchange() : channel(NULL), faces_only(false) { }
+  } ;
+  mutable std::map<const double*, Exchange> in_flight;
+
   void create_cart_1d();
   void create_cart_2d();
   void create_cart_3d();
+  void create_faces();
+  void add_message(int pattern, const int *rel_index, const int *start_send,
+                   const int *start_recv, const int *subsize, int tag_base);
+  Channel *acquire_channel(int pattern, int m0, int m1) const;
+  void pack(const double *A, const int *start, const int *subsize,
+            double *buf) const;
+  void unpack(double *A, const int *start, const int *subsize,
+              const double *buf) const;
+  void post(std::valarray<double> &A, int pattern, int m0, int m1,
+            Exchange &ex) const;
+  void complete(std::valarray<double> &A, Exchange &ex) const;
+  void fill_corners(std::valarray<double> &A) const;
+  bool corners_needed() const;
 
   std::string BaseName;
-  std::vector<int> neighbors, send_tags, recv_tags;
   MPI_Comm mpi_cart;
   MPI_Datatype mpi_type;
-  std::vector<MPI_Datatype> send_type;
-  std::vector<MPI_Datatype> recv_type;
 
   int mpi_size, old_rank, crt_rank;
   int mpi_index[3], mpi_sizes[3];
@@ -40,6 +100,8 @@ public:
 			    int Nd, int Nq, int Ng);
   ~DecomposedCartesianDomain();
   void Synchronize(std::valarray<double> &A) const;
+  void BeginSynchronize(std::valarray<double> &A) const;
+  void EndSynchronize(std::valarray<double> &A) const;
   int SubgridRank() const;
   int SubgridSize() const;
   int GetNumberOfZones() const { return ttl_zones; }
@@ -25,6 +25,7 @@
 #include <cmath>
 #include <cstring>
 #include <vector>
+#include <algorithm>
 #include "eos.hpp"
 
 
@@ -33,91 +34,115 @@ bool GenericTabulatedEos::verbose = false;
 
 
 
-GenericTabulatedEos::GenericTabulatedEos(std::vector<double> &D_values,
-					 std::vector<double> &T_values,
+GenericTabulatedEos::GenericTabulatedEos(std::vector<double> &D,
+					 std::vector<double> &T,
 					 std::vector<double> &p,
 					 std::vector<double> &u,
-					 std::vector<double> &c)
-  : D_values(D_values),
-    T_values(T_values),
-    EOS_p(p),
-    EOS_u(u),
-    EOS_c(c)
+					 std::vector<double> &c,
+					 bool node_shared)
+  : ND(D.size()),
+    NT(T.size())
+// -----------------------------------------------------------------------------
+// With node_shared, the ranks on a node hold a single copy of the table, which
+// the first of them fills; construction is then collective over the ranks.
+// -----------------------------------------------------------------------------
 {
   printf("[eos] building new GenericTabulatedEos\n");
-  printf("[eos] density points: %ld\n", D_values.size());
-  printf("[eos] temperature points: %ld\n", T_values.size());
+  printf("[eos] density points: %d\n", ND);
+  printf("[eos] temperature points: %d\n", NT);
 
-  size_t npts = D_values.size() * T_values.size();
+  const size_t npts = size_t(ND) * NT;
 
-  if (npts != EOS_p.size()) {
+  if (npts != p.size()) {
     printf("[eos] warning: pressure array has %ld points, expected %ld\n",
-	   EOS_p.size(), npts);
+	   p.size(), npts);
   }
-  if (npts != EOS_u.size()) {
+  if (npts != u.size()) {
     printf("[eos] warning: internal energy array has %ld points, expected %ld\n",
-	   EOS_u.size(), npts);
+	   u.size(), npts);
   }
-  if (npts != EOS_c.size()) {
+  if (npts != c.size()) {
     printf("[eos] warning: sound speed array has %ld points, expected %ld\n",
-	   EOS_c.size(), npts);
+	   c.size(), npts);
+  }
+
+  double *x = Table.Allocate(ND + NT + 3*npts, node_shared);
+
+  D_values = x;
+  T_values = D_values + ND;
+  EOS_p    = T_values + NT;
+  EOS_u    = EOS_p + npts;
+  EOS_c    = EOS_u + npts;
+
+  // Short arrays, which were warned about above, are padded with zeros
+  // ---------------------------------------------------------------------------
+  if (Table.Writer()) {
+    std::fill(x, x + ND + NT + 3*npts, 0.0);
+    std::copy(D.begin(), D.end(), x);
+    std::copy(T.begin(), T.end(), x + ND);
+    std::copy(p.begin(), p.begin() + std::min(npts, p.size()), x + ND + NT);
+    std::copy(u.begin(), u.begin() + std::min(npts, u.size()), x + ND + NT + npts);
+    std::copy(c.begin(), c.begin() + std::min(npts, c.size()), x + ND + NT + 2*npts);
   }
+
+  Table.Publish();
 }
 
 int GenericTabulatedEos::find_upper_index_D(double D) const
+// -----------------------------------------------------------------------------
+// Returns the upper index of the cell holding D, or zero if D is off the table
+// -----------------------------------------------------------------------------
 {
-  int n0=0, n1=D_values.size()-1;
-
-  if (D < D_values[n0]) {
-    throw SampledOutOfRangeDensity();
-  }
-  if (D > D_values[n1]) {
-    throw SampledOutOfRangeDensity();
+  if (!(D >= D_values[0] && D <= D_values[ND-1])) {
+    return 0;
   }
 
-  return 1.0 + (D - D_values[0]) / (D_values[1] - D_values[0]);
+  // The upper edge itself would index one past the last sample
+  const int i = 1 + int((D - D_values[0]) / (D_values[1] - D_values[0]));
+  return i < ND ? i : ND - 1;
 }
 
 int GenericTabulatedEos::find_upper_index_T(double T) const
 {
-  int n0=0, n1=T_values.size()-1;
-
-  if (T < T_values[n0]) {
-    throw SampledOutOfRangeTemperature();
-  }
-  if (T > T_values[n1]) {
-    throw SampledOutOfRangeTemperature();
+  if (!(T >= T_values[0] && T <= T_values[NT-1])) {
+    return 0;
   }
 
-  return 1.0 + (T - T_values[0]) / (T_values[1] - T_values[0]);
+  const int j = 1 + int((T - T_values[0]) / (T_values[1] - T_values[0]));
+  return j < NT ? j : NT - 1;
 }
 
-double GenericTabulatedEos::sample_EOS(const std::vector<double> &EOS,
+double GenericTabulatedEos::sample_EOS(const double *EOS,
                                        double D, double T, double *J) const
+// -----------------------------------------------------------------------------
+// Samples off the table use the approximate EOS, and are counted rather than
+// thrown; see EquationOfState::CountOffTable.
+// -----------------------------------------------------------------------------
 {
-  try {
-    return this->tabled_EOS(EOS, D, T, J);
-  }
-  catch (const SampledOutOfRangeDensity &e) {
+  const int Di = find_upper_index_D(D);
+  const int Tj = find_upper_index_T(T);
+
+  if (Di == 0) {
+    CountOffTable(OFF_TABLE_DENSITY);
     if (verbose) printf("[eos] warning: density out, using approximate. D=%e\n", D);
     return this->approx_EOS(EOS, D, T, J);
   }
-  catch (const SampledOutOfRangeTemperature &e) {
+  if (Tj == 0) {
+    CountOffTable(OFF_TABLE_TEMPERATURE);
     if (verbose) printf("[eos] warning: temperature out, using approximate T=%e\n", T);
     return this->approx_EOS(EOS, D, T, J);
   }
+  return this->tabled_EOS(EOS, Di, Tj, D, T, J);
 }
-double GenericTabulatedEos::tabled_EOS(const std::vector<double> &EOS,
+double GenericTabulatedEos::tabled_EOS(const double *EOS, int Di, int Tj,
                                        double D, double T, double *J) const
 // -----------------------------------------------------------------------------
 // Receives one of the lookup tables for pressure, temperature, or internal
 // energy, and performs a bilinear interpolation on the nearest 4 samples in
-// order to construct the needed EOS variable.
+// order to construct the needed EOS variable. Di and Tj are the upper indices
+// of the cell holding the sample.
 // -----------------------------------------------------------------------------
 {
-  const int Di = find_upper_index_D(D);
-  const int Tj = find_upper_index_T(T);
-  const int NT = T_values.size();
   const double dD = D_values[Di] - D_values[Di-1];
   const double dT = T_values[Tj] - T_values[Tj-1];
 
@@ -149,12 +174,9 @@ double GenericTabulatedEos::tabled_EOS(const std::vector<double> &EOS,
   return b1 + b2*x + b3*y + b4*x*y;
 }
 
-double GenericTabulatedEos::approx_EOS(const std::vector<double> &EOS,
+double GenericTabulatedEos::approx_EOS(const double *EOS,
                                        double D, double T, double *J) const
 {
-  const int ND = D_values.size();
-  const int NT = T_values.size();
-
   const double dD = D_values[ND-1] - D_values[0];
   const double dT = T_values[NT-1] - T_values[0];
 
@@ -173,13 +195,13 @@ double GenericTabulatedEos::approx_EOS(const std::vector<double> &EOS,
   return fc + (D-xc) * dfdD + (T-yc) * dfdT;
 }
 
-double GenericTabulatedEos::inverse_lookup_T(const std::vector<double> &EOS,
+double GenericTabulatedEos::inverse_lookup_T(const double *EOS,
                                              double D, double F) const
 {
   // First do a bisection to identify the nearest tabulated temperature for the
   // density and variable (F := { p,u }) requested.
   // ---------------------------------------------------------------------------
-  int n0=0, n1=T_values.size()-1;
+  int n0=0, n1=NT-1;
 
   while (n1 - n0 > 1) {
 
@@ -196,12 +218,12 @@ double GenericTabulatedEos::inverse_lookup_T(const std::vector<double> &EOS,
   const double F0 = sample_EOS(EOS, D, T_values[n0]);
   const double F1 = sample_EOS(EOS, D, T_values[n1]);
 
-  const double D0 = D_values.front();
-  const double D1 = D_values.back();
+  // A density off the table, or NaN, has no cell (Di == 0)
+  const int Di = find_upper_index_D(D);
 
   const int off_table =
     (F < F0 || F1 < F) +
-    (D < D0 || D1 < D);
+    (Di == 0);
 
   double T = 0.5*(T_values[n0] + T_values[n1]);
 
@@ -211,11 +233,14 @@ double GenericTabulatedEos::inverse_lookup_T(const std::vector<double> &EOS,
   double J[2];
   double f = (off_table ?
               approx_EOS(EOS, D, T, J) :
-              tabled_EOS(EOS, D, T, J)) - F;
+              tabled_EOS(EOS, Di, n1, D, T, J)) - F;
   double g = fabs(J[1]) > EFFECTIVELY_ZERO ? J[1] : EFFECTIVELY_ZERO;
 
   T -= f/g;
 
+  if (off_table) {
+    CountOffTable(OFF_TABLE_INVERSE);
+  }
   if (off_table && verbose) {
     printf("[eos] warning: inverse lookup on (D,F) = (%f,%f) used approximate. "
     	   "T=%e\n", D, F, T);
@@ -224,6 +249,60 @@ double GenericTabulatedEos::inverse_lookup_T(const std::vector<double> &EOS,
   return T;
 }
 
+double GenericTabulatedEos::inverse_lookup_T_near(const double *EOS,
+                                                  double D, double F,
+                                                  double T_guess) const
+// -----------------------------------------------------------------------------
+// Same as inverse_lookup_T, but starting from the cell holding T_guess and
+// stepping one cell at a time until one brackets F; see
+// ShenTabulatedNuclearEos::inverse_lookup_T_near. A guess off the table (or
+// NaN) starts from a bisection instead, and an F which no cell brackets is left
+// to inverse_lookup_T.
+// -----------------------------------------------------------------------------
+{
+  const int Di = find_upper_index_D(D);
+
+  if (Di == 0) {
+    return this->inverse_lookup_T(EOS, D, F);
+  }
+
+  const double x = (D - D_values[Di-1]) / (D_values[Di] - D_values[Di-1]);
+  const double *F0 = &EOS[(Di-1)*NT]; // F at (Di-1, j) is F0[j]
+  const double *F1 = &EOS[(Di-0)*NT];
+
+#define COLUMN(j) ((1.0 - x)*F0[j] + x*F1[j])
+
+  int j = find_upper_index_T(T_guess);
+
+  if (j == 0) {
+    int n0=0, n1=NT-1;
+
+    while (n1 - n0 > 1) {
+      if (F > COLUMN((n0+n1)/2)) n0 = (n0+n1)/2;
+      else                       n1 = (n0+n1)/2;
+    }
+    j = n1;
+  }
+
+  for (int steps=0; steps<NT; ++steps) {
+
+    const double f0 = COLUMN(j-1);
+    const double f1 = COLUMN(j);
+
+    if      (F < f0 && j > 1   ) --j;
+    else if (F > f1 && j < NT-1) ++j;
+    else if (F < f0 || F > f1) break;
+    else {
+      const double y = (f1 != f0) ? (F - f0) / (f1 - f0) : 0.5;
+      return T_values[j-1] + y*(T_values[j] - T_values[j-1]);
+    }
+  }
+
+#undef COLUMN
+
+  return this->inverse_lookup_T(EOS, D, F);
+}
+
 
 double GenericTabulatedEos::Pressure(double D, double T) const
 {
@@ -268,7 +347,29 @@ double GenericTabulatedEos::TemperatureMeV(double D, double p) const
 {
   return this->inverse_lookup_T(EOS_p, D, p);
 }
+void GenericTabulatedEos::TemperatureBatch_p(const double *D, const double *p,
+                                             double *T, int n, int stride,
+                                             bool warm) const
+{
+  for (int i=0; i<n; ++i) {
+    T[i] = this->inverse_lookup_T_near(EOS_p, D[i*stride], p[i*stride],
+                                       warm ? T[i] : NAN);
+  }
+}
+void GenericTabulatedEos::TemperatureBatch_u(const double *D, const double *u,
+                                             double *T, int n, int stride,
+                                             bool warm) const
+{
+  for (int i=0; i<n; ++i) {
+    T[i] = this->inverse_lookup_T_near(EOS_u, D[i*stride], u[i*stride],
+                                       warm ? T[i] : NAN);
+  }
+}
 double GenericTabulatedEos::TemperatureArb(double D, double T_MeV) const
 {
   return T_MeV;
 }
+double GenericTabulatedEos::TemperatureArbToMeV(double D, double T) const
+{
+  return T;
+}
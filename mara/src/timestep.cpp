@@ -0,0 +1,126 @@
+
+
+#include <cmath>
+#include "timestep.hpp"
+#include "mara_mpi.h"
+
+double TimestepController::max_growth = 0.0;
+double TimestepController::shrink = 0.5;
+double TimestepController::reject_cfl = 0.0;
+int TimestepController::max_retries = 0;
+int TimestepController::history_length = 1024;
+
+
+TimestepController::TimestepController()
+  : cfl(0.0), dt_attempt(0.0), dt_accepted(0.0), steps(0),
+    history_next(0), rejected(0) { }
+
+void TimestepController::BeginStep(double dt)
+{
+  dt_attempt = dt;
+  RiemannSolver::ResetMaxLambda();
+}
+
+bool TimestepController::EndStep(int errors)
+// -----------------------------------------------------------------------------
+// Must be called on all ranks at once, with errors already summed over them.
+// -----------------------------------------------------------------------------
+{
+  Attempt A;
+  A.dt = dt_attempt;
+  A.lambda_dx = reduce_lambda_dx();
+  A.errors = errors;
+  A.accepted = (errors == 0);
+
+  if (A.accepted && reject_cfl > 0.0 && cfl > 0.0) {
+    A.accepted = A.dt * A.lambda_dx <= reject_cfl * cfl;
+  }
+  if (A.accepted) {
+    dt_accepted = A.dt;
+  }
+  last = A;
+  ++steps;
+  if (!A.accepted) ++rejected;
+
+  const size_t N = history_length;
+  if (history.size() != N && history_next != 0) {
+    GetHistory(history); // history_length changed after the ring wrapped
+    history_next = 0;
+  }
+  if (history.size() > N) {
+    history.erase(history.begin(), history.end() - N);
+  }
+  if (history.size() < N) {
+    history.push_back(A);
+  }
+  else if (N > 0) {
+    history[history_next] = A;
+    history_next = (history_next + 1) % N;
+  }
+  return A.accepted;
+}
+
+double TimestepController::NextTimestep(double cfl)
+// -----------------------------------------------------------------------------
+// Before the first step there are no speeds from a step, and those last set by
+// the solvers are reduced here instead, so that this must then be called on
+// all ranks at once.
+// -----------------------------------------------------------------------------
+{
+  this->cfl = cfl;
+
+  if (steps == 0) {
+    return cfl / reduce_lambda_dx();
+  }
+  const Attempt &A = last;
+  double dt = cfl / A.lambda_dx;
+
+  if (!A.accepted && max_retries > 0) {
+    if (dt > shrink * A.dt) dt = shrink * A.dt;
+  }
+  else if (max_growth > 0.0 && dt_accepted > 0.0) {
+    if (dt > max_growth * dt_accepted) dt = max_growth * dt_accepted;
+  }
+  return dt;
+}
+
+void TimestepController::ResetHistory()
+{
+  history.clear();
+  history_next = 0;
+  rejected = 0;
+}
+
+void TimestepController::GetHistory(std::vector<Attempt> &H) const
+// -----------------------------------------------------------------------------
+// Fills H with the attempts kept, oldest first.
+// -----------------------------------------------------------------------------
+{
+  std::vector<Attempt> ordered(history.begin() + history_next, history.end());
+  ordered.insert(ordered.end(), history.begin(), history.begin() + history_next);
+  H.swap(ordered);
+}
+
+double TimestepController::reduce_lambda_dx() const
+{
+  const double dx = Mara->domain->get_min_dx();
+  return Mara_mpi_dbl_max(RiemannSolver::GetMaxLambda() / dx);
+}
+
+
+
+void StateBuffers::Save()
+{
+  std::valarray<double> &P = Mara->PrimitiveArray;
+
+  Saved.swap(P);
+  if (P.size() != Saved.size()) P.resize(Saved.size());
+  if (U.size() != Saved.size()) U.resize(Saved.size());
+  seeding = true;
+}
+
+void StateBuffers::Restore()
+{
+  Mara->PrimitiveArray.swap(Saved);
+  seeding = false;
+}
@@ -0,0 +1,89 @@
+
+
+#ifndef __TimestepController_HEADER__
+#define __TimestepController_HEADER__
+
+#include <vector>
+#include "hydro.hpp"
+
+class TimestepController : public HydroModule
+// -----------------------------------------------------------------------------
+// Chooses the time step from the largest wavespeed the Riemann solvers saw over
+// the last step. The sweeps keep a maximum on each thread, which EndStep takes
+// over the threads and then over the ranks in a single reduction, so that
+// NextTimestep needs no communication.
+//
+// A step is rejected if it had failed zones, or if reject_cfl is positive and
+// its dt was more than reject_cfl times the CFL bound from the speeds it saw.
+// With retries enabled, the step after a rejection is at most shrink times the
+// rejected one; otherwise it is the CFL step, as get_timestep always gave. The
+// step after an accepted one is at most max_growth times it. A max_growth of
+// zero leaves the step to the CFL condition alone, which is the default.
+//
+// The last history_length attempts are kept for GetHistory, in a ring which
+// overwrites the oldest, and none if it is zero.
+// -----------------------------------------------------------------------------
+{
+public:
+  struct Attempt
+  {
+    double dt;        // step size tried
+    double lambda_dx; // largest wavespeed over zone width seen on any rank
+    int errors;       // failed zones, summed over the ranks
+    bool accepted;
+  } ;
+
+  static double max_growth;
+  static double shrink;
+  static double reject_cfl;
+  static int max_retries; // rejected steps advance retries at shrink times dt
+  static int history_length;
+
+  TimestepController();
+  void BeginStep(double dt);
+  bool EndStep(int errors);
+  double NextTimestep(double cfl);
+  void ResetHistory();
+  void GetHistory(std::vector<Attempt> &H) const;
+  int GetRejected() const { return rejected; }
+
+private:
+  double cfl;         // CFL number of the last call to NextTimestep
+  double dt_attempt;  // step begun by BeginStep
+  double dt_accepted; // last accepted step, zero if none
+  int steps;          // attempts ended since construction
+  Attempt last;
+  double reduce_lambda_dx() const;
+  std::vector<Attempt> history; // ring of the last history_length attempts
+  size_t history_next;          // where the next attempt goes in history
+  int rejected;                 // attempts rejected since ResetHistory
+} ;
+
+class StateBuffers : public HydroModule
+// -----------------------------------------------------------------------------
+// Holds the primitives at the start of a step, so that a rejected step may be
+// rolled back. Save swaps them out of PrimitiveArray into the front buffer,
+// leaving the back buffer in PrimitiveArray for the step to write. Until the
+// step has inverted into all of PrimitiveArray, Seed returns the front buffer,
+// and the Godunov operators start their inversions from it block by block;
+// see GodunovOperator::ConsToPrim. An accepted step is left where it was
+// computed, and Restore swaps the front buffer back in for a rejected one, so
+// that neither copies the state.
+// -----------------------------------------------------------------------------
+{
+public:
+  StateBuffers() : seeding(false) { }
+  void Save();
+  void Restore();
+  const std::valarray<double> &Front() const { return Saved; }
+  const std::valarray<double> *Seed() const { return seeding ? &Saved : NULL; }
+  void Seeded() { seeding = false; }
+  std::valarray<double> &Conserved() { return U; }
+
+private:
+  std::valarray<double> Saved;
+  std::valarray<double> U;
+  bool seeding;
+} ;
+
+#endif // __TimestepController_HEADER__
@@ -62,10 +62,9 @@ function util.run_simulation(pinit, configure_mara, runargs)
       end
       attempt = attempt + 1
 
-      local dt = Status.Timestep
-      local kzps, errors = advance(dt)
+      local kzps, errors, accepted, dt = advance(Status.Timestep)
 
-      if errors == 0 then
+      if accepted then
          driving.Advance(dt)
          driving.Resample()
          if not runargs.quiet then
@@ -76,13 +75,15 @@ function util.run_simulation(pinit, configure_mara, runargs)
          end
 
          attempt = 0
-         Status.CurrentTime = Status.CurrentTime + Status.Timestep
+         Status.CurrentTime = Status.CurrentTime + dt
          Status.Iteration = Status.Iteration + 1
 	 if runargs.fixdt < 0.0 then
 	    Status.Timestep = get_timestep(runargs.CFL)
 	 else
 	    Status.Timestep = runargs.fixdt
 	 end
+      elseif runargs.fixdt < 0.0 then
+	 Status.Timestep = get_timestep(runargs.CFL)
       end
    end
    return Status
@@ -0,0 +1,147 @@
+/*------------------------------------------------------------------------------
+ * FILE: weno-kernels.h
+ *
+ * PURPOSE: Stencil coefficients and point kernels of the PLM and WENO5
+ *   reconstructions, defined static inline so that callers which know the
+ *   operation at compile time (the specialized flux sweeps) compile them into
+ *   their own loops. The parameters held by weno.c are passed explicitly, see
+ *   reconstruct_get_params. weno.c is built on the same kernels, so the results
+ *   are identical to those of reconstruct.
+ *
+ *------------------------------------------------------------------------------
+ */
+
+#ifndef __MaraWenoKernels_HEADER__
+#define __MaraWenoKernels_HEADER__
+
+#include <math.h>
+#include "weno.h"
+
+static const double CeesA2C_FV[3][3] = { {23./24.,  1./12.,  -1./24.},
+                                         {-1./24., 13./12.,  -1./24.},
+                                         {-1./24.,  1./12.,  23./24.} };
+static const double CeesC2A_FV[3][3] = { {25./24., -1./12.,   1./24.},
+                                         { 1./24., 11./12.,   1./24.},
+                                         { 1./24., -1./12.,  25./24.} };
+static const double CeesC2L_FV[3][3] = { {15./8., -5./4.,  3./8.},
+                                         { 3./8.,  3./4., -1./8.},
+                                         {-1./8.,  3./4.,  3./8.} };
+static const double CeesC2R_FV[3][3] = { { 3./8., 3./4.,  -1./8.},
+                                         {-1./8., 3./4.,   3./8.},
+                                         { 3./8.,-5./4.,  15./8.} };
+static const double DeesC2L_FV[3] = {   1./ 16.,   5./  8.,   5./ 16. };
+static const double DeesC2R_FV[3] = {   5./ 16.,   5./  8.,   1./ 16. };
+static const double DeesA2C_FV[3] = {  -9./ 80.,  49./ 40.,  -9./ 80. };
+static const double DeesC2A_FV[3] = { -17./240., 137./120., -17./240. };
+
+
+
+static const double CeesC2R_FD[3][3] = { { 1./3.,  5./6., -1./6. },
+                                         {-1./6.,  5./6.,  1./3. },
+                                         { 1./3., -7./6., 11./6. } };
+static const double CeesC2L_FD[3][3] = { {11./6., -7./6.,  1./3. },
+                                         { 1./3.,  5./6., -1./6. },
+                                         {-1./6.,  5./6.,  1./3. } };
+static const double DeesC2L_FD[3] = { 0.1, 0.6, 0.3 };
+static const double DeesC2R_FD[3] = { 0.3, 0.6, 0.1 };
+
+
+static inline double weno_squ(double x)
+{
+  return x*x;
+}
+static inline int weno_sgn(double x)
+{
+  return (x>0)-(x<0);
+}
+static inline double weno_min3(const double *x)
+{
+  double x01 = x[0] < x[1] ? x[0] : x[1];
+  return x01 < x[2] ? x01 : x[2];
+}
+static inline double weno_max3(const double *x)
+{
+  double x01 = x[0] > x[1] ? x[0] : x[1];
+  return x01 > x[2] ? x01 : x[2];
+}
+
+static inline double weno_plm_minmod(double ul, double u0, double ur,
+                                     double theta)
+{
+  const double a = theta * (u0 - ul);
+  const double b =  0.5  * (ur - ul);
+  const double c = theta * (ur - u0);
+  const double fabc[3] = { fabs(a), fabs(b), fabs(c) };
+  return 0.25*fabs(weno_sgn(a)+weno_sgn(b))*(weno_sgn(a)+weno_sgn(c))*
+    weno_min3(fabc);
+}
+static inline double weno_plm(const double *v, int s, double sgn, double theta)
+// -----------------------------------------------------------------------------
+// Limited linear extrapolation of v[0] to its right (sgn=+1) or left (sgn=-1)
+// face, from the stencil { v[-s], v[0], v[s] }.
+// -----------------------------------------------------------------------------
+{
+  return v[0] + sgn*0.5*weno_plm_minmod(v[-s], v[0], v[s], theta);
+}
+static inline double weno_weno5(const double *v, int s,
+                                const double c[3][3], const double d[3],
+                                enum SmoothnessIndicator IS, double A)
+// -----------------------------------------------------------------------------
+// Fifth order WENO interpolation with the candidate coefficients c and the
+// optimal weights d, over the stencil { v[-2s], ..., v[2s] }. A is the
+// parameter of the Shen & Zha (2010) indicator, unused by the others.
+// -----------------------------------------------------------------------------
+{
+  double eps = 1e-6;
+  double eps_prime = 1e-6;
+
+  const double vm2 = v[-2*s], vm1 = v[-s], v0 = v[0], vp1 = v[s], vp2 = v[2*s];
+  const double vs[3] = {
+    c[0][0]*v0  + c[0][1]*vp1 + c[0][2]*vp2,
+    c[1][0]*vm1 + c[1][1]*v0  + c[1][2]*vp1,
+    c[2][0]*vm2 + c[2][1]*vm1 + c[2][2]*v0,
+  };
+  double B[3] = { // smoothness indicators
+    (13./12.)*weno_squ(1*v0  - 2*vp1 + 1*vp2) +
+    ( 1./ 4.)*weno_squ(3*v0  - 4*vp1 + 1*vp2),
+    (13./12.)*weno_squ(1*vm1 - 2*v0  + 1*vp1) +
+    ( 1./ 4.)*weno_squ(1*vm1 - 0*v0  - 1*vp1),
+    (13./12.)*weno_squ(1*vm2 - 2*vm1 + 1*v0 ) +
+    ( 1./ 4.)*weno_squ(1*vm2 - 4*vm1 + 3*v0 )
+  };
+
+  double w[3];
+  if (IS == ImprovedBorges08) {
+    eps = eps_prime = 1e-14; // Borges uses 1e-40, but has Matlab
+    const double tau5 = fabs(B[0] - B[2]);
+
+    // Calculate my weights with new smoothness indicators accoding to Borges
+    w[0] = d[0] * (1.0 + (tau5 / (B[0] + eps)));
+    w[1] = d[1] * (1.0 + (tau5 / (B[1] + eps)));
+    w[2] = d[2] * (1.0 + (tau5 / (B[2] + eps)));
+  }
+  else if (IS == ImprovedShenZha10) {
+    eps = 1e-6;
+    eps_prime = 1e-10;
+    // A: [0 (less aggressive) -> ~100 (more aggressive)]
+    const double minB = weno_min3(B), maxB = weno_max3(B);
+    const double R0 = minB / (maxB + eps_prime);
+    B[0] = R0*A*minB + B[0];
+    B[1] = R0*A*minB + B[1];
+    B[2] = R0*A*minB + B[2];
+    w[0] = d[0] / weno_squ(eps_prime + B[0]);
+    w[1] = d[1] / weno_squ(eps_prime + B[1]);
+    w[2] = d[2] / weno_squ(eps_prime + B[2]);
+  }
+  else { // Use OriginalJiangShu96
+    eps = eps_prime = 1e-6; // recommended value by Jiang and Shu
+    w[0] = d[0] / weno_squ(eps_prime + B[0]);
+    w[1] = d[1] / weno_squ(eps_prime + B[1]);
+    w[2] = d[2] / weno_squ(eps_prime + B[2]);
+  }
+
+  const double wtot = w[0] + w[1] + w[2];
+  return (w[0]*vs[0] + w[1]*vs[1] + w[2]*vs[2])/wtot;
+}
+
+#endif // __MaraWenoKernels_HEADER__
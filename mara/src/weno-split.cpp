@@ -6,219 +6,326 @@
 #include "eulers.hpp"
 #include "weno-split.hpp"
 #include "riemann_hll.hpp"
+#include "mara_mpi.h"
 #include "matrix.h"
 #include "weno.h"
+#include "profile.hpp"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 typedef WenoSplit Deriv;
 
-std::valarray<double> Deriv::dUdt(const std::valarray<double> &Uin)
+void Deriv::dUdt(std::valarray<double> &Uin, std::valarray<double> &L)
 {
   this->prepare_integration();
   Mara->FailureMask = 0;
 
-  Uglb.resize(stride[0]);
-  Pglb.resize(stride[0]);
-  Lglb.resize(stride[0]);
+  if (Pglb.size() != size_t(stride[0])) Pglb.resize(stride[0]);
+  if (Fiph.size() != size_t(stride[0]*(ND>=1))) Fiph.resize(stride[0]*(ND>=1));
+  if (Giph.size() != size_t(stride[0]*(ND>=2))) Giph.resize(stride[0]*(ND>=2));
+  if (Hiph.size() != size_t(stride[0]*(ND>=3))) Hiph.resize(stride[0]*(ND>=3));
 
-  Fiph.resize(stride[0]*(ND>=1));
-  Giph.resize(stride[0]*(ND>=2));
-  Hiph.resize(stride[0]*(ND>=3));
+  std::vector<int> N = Mara->domain->aug_shape();
+  const int Nmax = *std::max_element(N.begin(), N.end());
+  workspaces.resize(num_threads);
+  for (int n=0; n<num_threads; ++n) {
+    workspaces[n].resize(Nmax, NQ);
+  }
 
-  Uglb = Uin;
-  Pglb = Mara->PrimitiveArray;
-  int err = ConsToPrim(Uglb, Pglb);
+  int err = ConsToPrim(Uin, Pglb); // seeded from PrimitiveArray or the step's start
 
+  if (err != 0 && repair_failures) {
+    err = Mara_mpi_int_sum(RepairFailures(Uin, Pglb));
+  }
   if (err != 0) {
     printf("c2p failed on %d zones\n", err);
     throw IntermediateFailure();
   }
 
+  Profile::Scope timer(Profile::TIMER_FLUX_SWEEP);
+  Profile::Count(Profile::COUNT_FACES_SWEPT, ND*stride[0]/NQ);
+
   switch (ND) {
-  case 1: drive_sweeps_1d(); break;
-  case 2: drive_sweeps_2d(); break;
-  case 3: drive_sweeps_3d(); break;
+  case 1: drive_sweeps_1d(&Uin[0], &L[0]); break;
+  case 2: drive_sweeps_2d(&Uin[0], &L[0]); break;
+  case 3: drive_sweeps_3d(&Uin[0], &L[0]); break;
+  }
+}
+
+bool Deriv::NeedsCornerGuards() const
+{
+  return Mara->fluid == NULL || Mara->fluid->UsesConstrainedTransport();
+}
+
+
+void Deriv::Workspace::resize(int N, int NQ)
+// -----------------------------------------------------------------------------
+// Sizes the scratch arrays for pencils of up to N zones with NQ components. All
+// of them are carved out of one block, which is only reallocated when N or NQ
+// have changed.
+// -----------------------------------------------------------------------------
+{
+  if (N == this->N && NQ == this->NQ) return;
+  this->N = N;
+  this->NQ = NQ;
+
+  const int M = NQ*NQ;
+  mem.assign(2*N + 28*N*NQ + 4*N*M, 0.0);
+
+  double *p = &mem[0];
+  U = p; p += N*NQ;
+  P = p; p += N*NQ;
+  F = p; p += N*NQ;
+  A = p; p += N;
+  Fiph = p; p += N*NQ;
+
+  Us = p; p += N*NQ;
+  Fs = p; p += N*NQ;
+  for (int s=0; s<2; ++s) {
+    Lt [s] = p; p += N*M;
+    Rt [s] = p; p += N*M;
+    lam[s] = p; p += N*NQ;
+    g  [s] = p; p += N*NQ;
+    G  [s] = p; p += N*NQ;
+  }
+  ml = p; p += N;
+  fp = p; p += 6*N*NQ;
+  fm = p; p += 6*N*NQ;
+  for (int n=0; n<4; ++n) {
+    tmp[n] = p; p += N*NQ;
   }
+}
+Deriv::Workspace &Deriv::workspace()
+{
+#ifdef _OPENMP
+  return workspaces[omp_get_thread_num()];
+#else
+  return workspaces[0];
+#endif
+}
+
 
-  return Lglb;
+// -----------------------------------------------------------------------------
+// Kernels over the faces of a pencil. Matrices are stored one plane per entry,
+// A[(r*nq + c)*nf + k] being entry (r,c) of face k, and vectors one plane per
+// component. The innermost loops run over faces with unit stride. Each product
+// is summed in the same order as matrix_vector_product, so the result for each
+// face is the same as if it had been computed alone.
+// -----------------------------------------------------------------------------
+static void batch_matvec(const double *A, const double *x, double *b,
+                         int nq, int nf, int sx)
+// -----------------------------------------------------------------------------
+// b[r*nf + k] = Sum_c{ A[(r*nq + c)*nf + k] * x[c*sx + k] }
+// -----------------------------------------------------------------------------
+{
+  for (int r=0; r<nq; ++r) {
+    double *br = b + r*nf;
+    for (int k=0; k<nf; ++k) {
+      br[k] = 0.0;
+    }
+    for (int c=0; c<nq; ++c) {
+      const double *a = A + (r*nq + c)*nf;
+      const double *xc = x + c*sx;
+      for (int k=0; k<nf; ++k) {
+        br[k] += a[k] * xc[k];
+      }
+    }
+  }
+}
+static void batch_weno(const double *f, double *g, int nq, int nf, int off,
+                       enum ReconstructOperation op)
+// -----------------------------------------------------------------------------
+// Reconstructs g[q*nf + k] from the six split fluxes f[(j*nq + q)*nf + k] of
+// face k, j=0..5, with the stencil centered on j=off.
+// -----------------------------------------------------------------------------
+{
+  for (int q=0; q<nq; ++q) {
+    for (int k=0; k<nf; ++k) {
+      double v[6];
+      for (int j=0; j<6; ++j) {
+        v[j] = f[(j*nq + q)*nf + k];
+      }
+      g[q*nf + k] = reconstruct(v+off, op);
+    }
+  }
 }
 
 
 void Deriv::intercell_flux_sweep(const double *U, const double *P,
                                  const double *F, const double *A,
                                  double *Fiph, int dim)
+// -----------------------------------------------------------------------------
+// Computes the characteristic WENO fluxes through the faces of one pencil. The
+// work is done a stage at a time over all of the faces: first the eigensystem
+// of every face, then the projections of the stencils onto the characteristic
+// fields, their reconstruction, and the projection back.
+// -----------------------------------------------------------------------------
 {
   const int Nx = Mara->domain->get_N(dim);
   const int Ng = Mara->domain->get_Ng();
+  const int N = stride[dim-1] / stride[dim];
+  Workspace &W = workspace();
 
-  // Local memory requirements for WENO flux calculation
-  // ---------------------------------------------------------------------------
-  double *lam = new double[NQ];       // Characteristic eigenvalues
-  double *Piph = new double[NQ];      // Primitive variables at i+1/2 (averaged)
-  double *Uiph = new double[NQ];      // Conserved " " (taken from prim)
-  double *Liph = new double[NQ*NQ];   // Left eigenvectors at i+1/2
-  double *Riph = new double[NQ*NQ];   // Right eigenvectors at i+1/2
-  double *fp = new double[6*NQ];      // Characteristic split fluxes on local stencil
-  double *fm = new double[6*NQ];      // " " Left going
-  double *Fp = new double[NQ];        // Component-wise split fluxes on local cell
-  double *Fm = new double[NQ];        // " " Left going
-
-  double *f = new double[NQ];         // WENO characteristic flux
-  double *fpT = new double[NQ*6];     // Transposed split flux to [wave, zone]
-  double *fmT = new double[NQ*6];     // " " Left going
+  // The pencil's conserved variables and fluxes, one plane per component. The
+  // planes are spaced by the longest pencil.
   // ---------------------------------------------------------------------------
+  for (int i=0; i<N; ++i) {
+    for (int q=0; q<NQ; ++q) {
+      W.Us[q*W.N + i] = U[i*NQ + q];
+      W.Fs[q*W.N + i] = F[i*NQ + q];
+    }
+  }
 
-  for (int i=Ng-1; i<Nx+Ng; ++i) {
-
-    if (fluxsplit_method == FLUXSPLIT_MARQUINA) {
-
-      // Hard-codes NQ=5 for now
-      // -----------------------
-      double laml[5], lamr[5];
-      double Ll[5][5], Rl[5][5];
-      double Lr[5][5], Rr[5][5];
-      double ul[6][5], ur[6][5];
-      double fl[6][5], fr[6][5];
-      double fweno_p[5], fweno_m[5];
-      double Fweno_p[5], Fweno_m[5];
-      double Pl[5], Pr[5];
-      double Ul[5], Ur[5];
-
-      for (int q=0; q<NQ; ++q) {
-	const int m = i*NQ + q;
-	double v[6] = { P[m-2*NQ], P[m-NQ], P[m], P[m+NQ], P[m+2*NQ], P[m+3*NQ] };
-	
-	switch (GodunovOperator::reconstruct_method) {
-	case RECONSTRUCT_PCM:
-	  Pl[q] = v[2];
-	  Pr[q] = v[3];
-	  break;
-	case RECONSTRUCT_PLM:
-	  Pl[q] = reconstruct(&v[2], PLM_C2R);
-	  Pr[q] = reconstruct(&v[3], PLM_C2L);
-	  break;
-	case RECONSTRUCT_WENO5:
-	  Pl[q] = reconstruct(&v[2], WENO5_FV_C2R);
-	  Pr[q] = reconstruct(&v[3], WENO5_FV_C2L);
-	  break;
-	}
-      }
-      Mara->fluid->PrimToCons(Pl, Ul);
-      Mara->fluid->PrimToCons(Pr, Ur);
-      Mara->fluid->Eigensystem(Ul, Pl, Ll[0], Rl[0], laml, dim);
-      Mara->fluid->Eigensystem(Ur, Pr, Lr[0], Rr[0], lamr, dim);
-
+  if (fluxsplit_method == FLUXSPLIT_MARQUINA) {
+    flux_split_marquina(P, Fiph, Ng-1, Nx+1, dim);
+  }
+  else if (fluxsplit_method == FLUXSPLIT_LOCAL_LAX_FRIEDRICHS) {
+    flux_split_llf(P, A, Fiph, Ng-1, Nx+1, dim);
+  }
+}
+void Deriv::flux_split_llf(const double *P, const double *A, double *Fiph,
+                           int i0, int nf, int dim)
+// -----------------------------------------------------------------------------
+// Local Lax-Friedrichs splitting in the eigenbasis of the averaged primitive
+// state at each of the nf faces i0, i0+1, ...
+// -----------------------------------------------------------------------------
+{
+  Workspace &W = workspace();
+  const int N = W.N;
+  double *Piph = W.tmp[0]; // zone-major over the faces
+  double *Uiph = W.tmp[1];
 
-      for (int j=0; j<6; ++j) {
-        matrix_vector_product(Ll[0], &U[(i+j-2)*NQ], ul[j], NQ, NQ);
-        matrix_vector_product(Lr[0], &U[(i+j-2)*NQ], ur[j], NQ, NQ);
-        matrix_vector_product(Ll[0], &F[(i+j-2)*NQ], fl[j], NQ, NQ);
-        matrix_vector_product(Lr[0], &F[(i+j-2)*NQ], fr[j], NQ, NQ);
-      }
+  for (int k=0; k<nf; ++k) {
+    const int i = i0 + k;
 
-      for (int q=0; q<NQ; ++q) {
-        if (laml[q] > 0.0 && lamr[q] > 0.0) {
-          // No sign change, right-going waves only: set fm to zero and fp to f
-          for (int j=0; j<6; ++j) {
-            fp[j*NQ + q] = fl[j][q];
-            fm[j*NQ + q] = 0.0;
-          }
-        }
-        else if (laml[q] < 0.0 && lamr[q] < 0.0) {
-          // No sign change, left-going waves only: set fp to zero and fm to f
-          for (int j=0; j<6; ++j) {
-            fp[j*NQ + q] = 0.0;
-            fm[j*NQ + q] = fr[j][q];
-          }
-        }
-        else {
-          // There is a sign change in the speed of this characteristic field
-          const double a = fabs(laml[q]) > fabs(lamr[q]) ? laml[q] : lamr[q];
-          for (int j=0; j<6; ++j) {
-            fp[j*NQ + q] = 0.5*(fl[j][q] + fabs(a)*ul[j][q]);
-            fm[j*NQ + q] = 0.5*(fr[j][q] - fabs(a)*ur[j][q]);
-          }
-        }
-      }
+    for (int q=0; q<NQ; ++q) {
+      Piph[k*NQ + q] = 0.5*(P[i*NQ + q] + P[(i+1)*NQ + q]);
+    }
 
-      for (int q=0; q<NQ; ++q) {
-        for (int j=0; j<6; ++j) {
-          fpT[q*6 + j] = fp[j*NQ + q];
-          fmT[q*6 + j] = fm[j*NQ + q];
-        }
+    // Select the maximum wavespeed on the local stencil
+    // -------------------------------------------------------------------------
+    W.ml[k] = *std::max_element(A+i-2, A+i+4);
+  }
+  Mara->fluid->PrimToConsBatch(Piph, Uiph, nf, NULL);
+  Mara->fluid->EigensystemBatch(Uiph, Piph, W.Lt[0], W.Rt[0], W.lam[0], nf, dim);
+
+  for (int j=0; j<6; ++j) {
+    const double *Uj = W.Us + i0+j-2;
+    const double *Fj = W.Fs + i0+j-2;
+    double *Fp = W.tmp[0];
+    double *Fm = W.tmp[1];
+
+    for (int q=0; q<NQ; ++q) {
+      for (int k=0; k<nf; ++k) {
+        Fp[q*nf + k] = 0.5*(Fj[q*N + k] + W.ml[k]*Uj[q*N + k]);
+        Fm[q*nf + k] = 0.5*(Fj[q*N + k] - W.ml[k]*Uj[q*N + k]);
       }
+    }
+    batch_matvec(W.Lt[0], Fp, W.fp + j*NQ*nf, NQ, nf, nf);
+    batch_matvec(W.Lt[0], Fm, W.fm + j*NQ*nf, NQ, nf, nf);
+  }
 
-      for (int q=0; q<NQ; ++q) {
-        fweno_p[q] = reconstruct(fpT+q*6+2, WENO5_FD_C2R);
-        fweno_m[q] = reconstruct(fmT+q*6+3, WENO5_FD_C2L);
-      }
+  batch_weno(W.fp, W.g[0], NQ, nf, 2, WENO5_FD_C2R);
+  batch_weno(W.fm, W.g[1], NQ, nf, 3, WENO5_FD_C2L);
 
-      matrix_vector_product(Rl[0], fweno_p, Fweno_p, NQ, NQ);
-      matrix_vector_product(Rr[0], fweno_m, Fweno_m, NQ, NQ);
+  for (int n=0; n<NQ*nf; ++n) {
+    W.g[0][n] += W.g[1][n];
+  }
+  batch_matvec(W.Rt[0], W.g[0], W.G[0], NQ, nf, nf);
 
-      for (int q=0; q<NQ; ++q) {
-	Fiph[i*NQ + q] = Fweno_p[q] + Fweno_m[q];
+  for (int k=0; k<nf; ++k) {
+    for (int q=0; q<NQ; ++q) {
+      Fiph[(i0+k)*NQ + q] = W.G[0][q*nf + k];
+    }
+  }
+}
+void Deriv::flux_split_marquina(const double *P, double *Fiph,
+                                int i0, int nf, int dim)
+// -----------------------------------------------------------------------------
+// Marquina's splitting, in the eigenbases of the states reconstructed on either
+// side of each of the nf faces i0, i0+1, ...
+// -----------------------------------------------------------------------------
+{
+  Workspace &W = workspace();
+  const int N = W.N;
+  double *Pl = W.tmp[0], *Pr = W.tmp[1]; // zone-major over the faces
+  double *Ul = W.tmp[2], *Ur = W.tmp[3];
+
+  for (int k=0; k<nf; ++k) {
+    const int i = i0 + k;
+
+    for (int q=0; q<NQ; ++q) {
+      const int m = i*NQ + q;
+      double v[6] = { P[m-2*NQ], P[m-NQ], P[m], P[m+NQ], P[m+2*NQ], P[m+3*NQ] };
+
+      switch (GodunovOperator::reconstruct_method) {
+      case RECONSTRUCT_PCM:
+	Pl[k*NQ + q] = v[2];
+	Pr[k*NQ + q] = v[3];
+	break;
+      case RECONSTRUCT_PLM:
+	Pl[k*NQ + q] = reconstruct(&v[2], PLM_C2R);
+	Pr[k*NQ + q] = reconstruct(&v[3], PLM_C2L);
+	break;
+      case RECONSTRUCT_WENO5:
+	Pl[k*NQ + q] = reconstruct(&v[2], WENO5_FV_C2R);
+	Pr[k*NQ + q] = reconstruct(&v[3], WENO5_FV_C2L);
+	break;
       }
     }
-
-    else if (fluxsplit_method == FLUXSPLIT_LOCAL_LAX_FRIEDRICHS) {
-
-      for (int q=0; q<NQ; ++q) {
-        Piph[q] = 0.5*(P[i*NQ + q] + P[(i+1)*NQ + q]);
+  }
+  Mara->fluid->PrimToConsBatch(Pl, Ul, nf, NULL);
+  Mara->fluid->PrimToConsBatch(Pr, Ur, nf, NULL);
+  Mara->fluid->EigensystemBatch(Ul, Pl, W.Lt[0], W.Rt[0], W.lam[0], nf, dim);
+  Mara->fluid->EigensystemBatch(Ur, Pr, W.Lt[1], W.Rt[1], W.lam[1], nf, dim);
+
+  for (int j=0; j<6; ++j) {
+    const double *Uj = W.Us + i0+j-2;
+    const double *Fj = W.Fs + i0+j-2;
+    double *ul = W.tmp[0], *ur = W.tmp[1];
+    double *fl = W.tmp[2], *fr = W.tmp[3];
+    double *fp = W.fp + j*NQ*nf;
+    double *fm = W.fm + j*NQ*nf;
+
+    batch_matvec(W.Lt[0], Uj, ul, NQ, nf, N);
+    batch_matvec(W.Lt[1], Uj, ur, NQ, nf, N);
+    batch_matvec(W.Lt[0], Fj, fl, NQ, nf, N);
+    batch_matvec(W.Lt[1], Fj, fr, NQ, nf, N);
+
+    for (int n=0; n<NQ*nf; ++n) {
+      const double laml = W.lam[0][n];
+      const double lamr = W.lam[1][n];
+
+      if (laml > 0.0 && lamr > 0.0) {
+        // No sign change, right-going waves only: set fm to zero and fp to f
+        fp[n] = fl[n];
+        fm[n] = 0.0;
       }
-
-      Mara->fluid->PrimToCons(Piph, Uiph);
-      Mara->fluid->Eigensystem(Uiph, Piph, Liph, Riph, lam, dim);
-
-      // Select the maximum wavespeed on the local stencil
-      // -------------------------------------------------------------------------
-      const double ml = *std::max_element(A+i-2, A+i+4);
-
-      for (int j=0; j<6; ++j) {
-        for (int q=0; q<NQ; ++q) {
-
-          // Local Lax-Friedrichs flux splitting
-          // ---------------------------------------------------------------------
-          const int m = (i+j-2)*NQ + q;
-          Fp[q] = 0.5*(F[m] + ml*U[m]);
-          Fm[q] = 0.5*(F[m] - ml*U[m]);
-        }
-        matrix_vector_product(Liph, Fp, fp+j*NQ, NQ, NQ);
-        matrix_vector_product(Liph, Fm, fm+j*NQ, NQ, NQ);
+      else if (laml < 0.0 && lamr < 0.0) {
+        // No sign change, left-going waves only: set fp to zero and fm to f
+        fp[n] = 0.0;
+        fm[n] = fr[n];
       }
-
-      for (int q=0; q<NQ; ++q) {
-        for (int j=0; j<6; ++j) {
-          fpT[q*6 + j] = fp[j*NQ + q];
-          fmT[q*6 + j] = fm[j*NQ + q];
-        }
+      else {
+        // There is a sign change in the speed of this characteristic field
+        const double a = fabs(laml) > fabs(lamr) ? laml : lamr;
+        fp[n] = 0.5*(fl[n] + fabs(a)*ul[n]);
+        fm[n] = 0.5*(fr[n] - fabs(a)*ur[n]);
       }
+    }
+  }
 
-      for (int q=0; q<NQ; ++q) {
-        f[q] =
-          reconstruct(fpT+q*6+2, WENO5_FD_C2R) +
-          reconstruct(fmT+q*6+3, WENO5_FD_C2L);
-      }
+  batch_weno(W.fp, W.g[0], NQ, nf, 2, WENO5_FD_C2R);
+  batch_weno(W.fm, W.g[1], NQ, nf, 3, WENO5_FD_C2L);
+  batch_matvec(W.Rt[0], W.g[0], W.G[0], NQ, nf, nf);
+  batch_matvec(W.Rt[1], W.g[1], W.G[1], NQ, nf, nf);
 
-      matrix_vector_product(Riph, f, Fiph+i*NQ, NQ, NQ);
+  for (int k=0; k<nf; ++k) {
+    for (int q=0; q<NQ; ++q) {
+      Fiph[(i0+k)*NQ + q] = W.G[0][q*nf + k] + W.G[1][q*nf + k];
     }
   }
-
-  // Clean up local memory requirements for WENO flux calculation
-  // ---------------------------------------------------------------------------
-  delete [] lam;
-  delete [] Piph;
-  delete [] Uiph;
-  delete [] Liph;
-  delete [] Riph;
-  delete [] fp;
-  delete [] fm;
-  delete [] Fp;
-  delete [] Fm;
-
-  delete [] f;
-  delete [] fpT;
-  delete [] fmT;
-  // ---------------------------------------------------------------------------
 }
 
 
@@ -230,13 +337,14 @@ void Deriv::drive_single_sweep(const double *Ug, const double *Pg,
 // dim  .... Direction along which to take the sweep (x=1, y=2, z=3)
 // -----------------------------------------------------------------------------
 {
-  const int N = Mara->domain->aug_shape()[dim-1];
+  const int N = stride[dim-1] / stride[dim];
   const int S = stride[dim];
 
-  double *U = (double*) malloc(N*NQ*sizeof(double)); // Conserved
-  double *P = (double*) malloc(N*NQ*sizeof(double)); // Primitive
-  double *F = (double*) malloc(N*NQ*sizeof(double)); // Fluxes in along dim-axis
-  double *A = (double*) malloc(N*   sizeof(double)); // Max wavespeed for dim
+  Workspace &W = workspace();
+  double *U = W.U; // Conserved
+  double *P = W.P; // Primitive
+  double *F = W.F; // Fluxes in along dim-axis
+  double *A = W.A; // Max wavespeed for dim
 
   for (int i=0; i<N; ++i) {
     // In this loop, i is the zone index, not the memory offset
@@ -249,9 +357,9 @@ void Deriv::drive_single_sweep(const double *Ug, const double *Pg,
     Mara->fluid->FluxAndEigenvalues(U+i*NQ, P+i*NQ, F+i*NQ, &ap, &am, dim);
 
     A[i] = (fabs(ap)>fabs(am)) ? fabs(ap) : fabs(am);
-    if (MaxLambda < A[i]) MaxLambda = A[i];
+    UpdateMaxLambda(A[i]);
   }
-  double *Fiph_l = (double*) malloc(N*NQ*sizeof(double));
+  double *Fiph_l = W.Fiph;
   intercell_flux_sweep(U, P, F, A, Fiph_l, dim);
 
   // Here we unload the local intercell fluxes, Fiph_l, into the global array,
@@ -260,21 +368,23 @@ void Deriv::drive_single_sweep(const double *Ug, const double *Pg,
   for (int i=0; i<N; ++i) {
     memcpy(Fiph_g+i*S, Fiph_l+i*NQ, NQ*sizeof(double));
   }
-  free(U); free(P); free(F); free(A); free(Fiph_l);
 }
 
 
-void Deriv::drive_sweeps_1d()
+void Deriv::drive_sweeps_1d(const double *U, double *L)
 {
   const int Sx = stride[1];
 
-  drive_single_sweep(&Uglb[0], &Pglb[0], &Fiph[0], 1);
+  drive_single_sweep(&U[0], &Pglb[0], &Fiph[0], 1);
 
+  for (int i=0; i<Sx; ++i) {
+    L[i] = 0.0;
+  }
   for (int i=Sx; i<stride[0]; ++i) {
-    Lglb[i] = -(Fiph[i]-Fiph[i-Sx])/dx;
+    L[i] = -(Fiph[i]-Fiph[i-Sx])/dx;
   }
 }
-void Deriv::drive_sweeps_2d()
+void Deriv::drive_sweeps_2d(const double *U, double *L)
 {
   const int Nx = Mara->domain->get_N(1);
   const int Ny = Mara->domain->get_N(2);
@@ -282,20 +392,28 @@ void Deriv::drive_sweeps_2d()
   const int Sx = stride[1];
   const int Sy = stride[2];
 
-  for (int i=0; i<Nx+2*Ng; ++i) {
-    drive_single_sweep(&Uglb[i*Sx], &Pglb[i*Sx], &Giph[i*Sx], 2);
-  }
-  for (int j=0; j<Ny+2*Ng; ++j) {
-    drive_single_sweep(&Uglb[j*Sy], &Pglb[j*Sy], &Fiph[j*Sy], 1);
+#pragma omp parallel num_threads(num_threads)
+  {
+#pragma omp for schedule(static)
+    for (int i=0; i<Nx+2*Ng; ++i) {
+      drive_single_sweep(&U[i*Sx], &Pglb[i*Sx], &Giph[i*Sx], 2);
+    }
+#pragma omp for schedule(static)
+    for (int j=0; j<Ny+2*Ng; ++j) {
+      drive_single_sweep(&U[j*Sy], &Pglb[j*Sy], &Fiph[j*Sy], 1);
+    }
   }
 
   Mara->fluid->ConstrainedTransport2d(&Fiph[0], &Giph[0], stride);
 
+  for (int i=0; i<Sx; ++i) {
+    L[i] = 0.0;
+  }
   for (int i=Sx; i<stride[0]; ++i) {
-    Lglb[i] = -(Fiph[i]-Fiph[i-Sx])/dx - (Giph[i]-Giph[i-Sy])/dy;
+    L[i] = -(Fiph[i]-Fiph[i-Sx])/dx - (Giph[i]-Giph[i-Sy])/dy;
   }
 }
-void Deriv::drive_sweeps_3d()
+void Deriv::drive_sweeps_3d(const double *U, double *L)
 {
   const int Nx = Mara->domain->get_N(1);
   const int Ny = Mara->domain->get_N(2);
@@ -305,28 +423,37 @@ void Deriv::drive_sweeps_3d()
   const int Sy = stride[2];
   const int Sz = stride[3];
 
-  for (int j=0; j<Ny+2*Ng; ++j) {
+#pragma omp parallel num_threads(num_threads)
+  {
+#pragma omp for schedule(static)
+    for (int j=0; j<Ny+2*Ng; ++j) {
+      for (int k=0; k<Nz+2*Ng; ++k) {
+        const int m = j*Sy + k*Sz;
+        drive_single_sweep(&U[m], &Pglb[m], &Fiph[m], 1);
+      }
+    }
+#pragma omp for schedule(static)
     for (int k=0; k<Nz+2*Ng; ++k) {
-      const int m = j*Sy + k*Sz;
-      drive_single_sweep(&Uglb[m], &Pglb[m], &Fiph[m], 1);
+      for (int i=0; i<Nx+2*Ng; ++i) {
+        const int m = k*Sz + i*Sx;
+        drive_single_sweep(&U[m], &Pglb[m], &Giph[m], 2);
+      }
     }
-  }
-  for (int k=0; k<Nz+2*Ng; ++k) {
+#pragma omp for schedule(static)
     for (int i=0; i<Nx+2*Ng; ++i) {
-      const int m = k*Sz + i*Sx;
-      drive_single_sweep(&Uglb[m], &Pglb[m], &Giph[m], 2);
-    }
-  }
-  for (int i=0; i<Nx+2*Ng; ++i) {
-    for (int j=0; j<Ny+2*Ng; ++j) {
-      const int m = i*Sx + j*Sy;
-      drive_single_sweep(&Uglb[m], &Pglb[m], &Hiph[m], 3);
+      for (int j=0; j<Ny+2*Ng; ++j) {
+        const int m = i*Sx + j*Sy;
+        drive_single_sweep(&U[m], &Pglb[m], &Hiph[m], 3);
+      }
     }
   }
   Mara->fluid->ConstrainedTransport3d(&Fiph[0], &Giph[0], &Hiph[0], stride);
 
+  for (int i=0; i<Sx; ++i) {
+    L[i] = 0.0;
+  }
   for (int i=Sx; i<stride[0]; ++i) {
-    Lglb[i] =
+    L[i] =
       -(Fiph[i]-Fiph[i-Sx])/dx +
       -(Giph[i]-Giph[i-Sy])/dy +
       -(Hiph[i]-Hiph[i-Sz])/dz;
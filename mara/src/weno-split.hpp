@@ -10,20 +10,53 @@
 class WenoSplit : public GodunovOperator, public RiemannSolver
 {
 private:
-  std::valarray<double> Uglb, Pglb, Lglb;
+  std::valarray<double> Pglb;
   std::valarray<double> Fiph, Giph, Hiph;
 
+  // ---------------------------------------------------------------------------
+  // Scratch arrays for the sweeps along one pencil, one set per thread. They
+  // are sized once for the longest pencil and the number of components, so the
+  // sweeps do no allocation. The arrays over faces hold one plane per
+  // component or matrix entry, so that the stages over faces vectorize.
+  // ---------------------------------------------------------------------------
+  struct Workspace
+  {
+    int N, NQ;
+    std::vector<double> mem;
+    double *U, *P, *F, *A, *Fiph; // one pencil, zone-major
+    double *Us, *Fs;              // U and F, one plane per component
+    double *Lt[2], *Rt[2];        // eigenvectors of each face, left and right
+    double *lam[2];               // eigenvalues of each face, left and right
+    double *ml;                   // largest wavespeed on each face's stencil
+    double *fp, *fm;              // split characteristic fluxes [6][NQ][face]
+    double *g[2], *G[2];          // reconstructed fluxes, before and after R
+    double *tmp[4];               // also the faces' states, zone-major
+    // The pointers refer into mem, so a copy starts empty and is carved out of
+    // its own block by resize.
+    Workspace() : N(0), NQ(0) { }
+    Workspace(const Workspace &W) : N(0), NQ(0) { }
+    Workspace &operator=(const Workspace &W) { N = NQ = 0; return *this; }
+    void resize(int N, int NQ);
+  } ;
+  std::vector<Workspace> workspaces;
+  Workspace &workspace();
+
   void intercell_flux_sweep(const double *U, const double *P,
 			    const double *F, const double *A,
 			    double *Fiph, int dim);
+  void flux_split_llf(const double *P, const double *A, double *Fiph,
+                      int i0, int nf, int dim);
+  void flux_split_marquina(const double *P, double *Fiph,
+                           int i0, int nf, int dim);
   void drive_single_sweep(const double *Ug, const double *Pg,
 			  double *Fiph_g, int dim);
-  void drive_sweeps_1d();
-  void drive_sweeps_2d();
-  void drive_sweeps_3d();
+  void drive_sweeps_1d(const double *U, double *L);
+  void drive_sweeps_2d(const double *U, double *L);
+  void drive_sweeps_3d(const double *U, double *L);
 
 public:
-  std::valarray<double> dUdt(const std::valarray<double> &Uin);
+  void dUdt(std::valarray<double> &Uin, std::valarray<double> &L);
+  bool NeedsCornerGuards() const;
   int IntercellFlux(const double *pl, const double *pr, double *U,
 		    double *F, double s, int dim) { return 0; }
 } ;
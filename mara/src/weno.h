@@ -15,10 +15,19 @@ extern "C" {
 			     ImprovedBorges08,
 			     ImprovedShenZha10 };
 
+  struct ReconstructParams {
+    double plm_theta;
+    enum SmoothnessIndicator IS;
+    double shenzha10_A;
+  } ;
+
   double reconstruct(const double *v, enum ReconstructOperation type);
+  void reconstruct_batch(const double *v, double *out, int n, int s,
+                         enum ReconstructOperation type);
   void reconstruct_set_smoothness_indicator(enum SmoothnessIndicator IS);
   void reconstruct_set_plm_theta(double theta);
   void reconstruct_set_shenzha10_A(double A);
+  void reconstruct_get_params(struct ReconstructParams *params);
 
 #endif // __MaraWenoLibrary_HEADER__
 
@@ -0,0 +1,223 @@
+
+--------------------------------------------------------------------------------
+-- Timing benchmarks for the hot paths of the solver. Usage:
+--
+-- $> mara bench.lua [N=32] [dim=3] [fluid=euler] [godunov=plm-split] ...
+--
+-- Each benchmark prints the cost per step and the number of minor page faults
+-- incurred per step, which is a proxy for heap allocations of large arrays.
+--------------------------------------------------------------------------------
+
+local util = require 'util'
+
+local RunArgs = {
+   N       = 32,
+   dim     = 3,
+   steps   = 10,
+   fluid   = "euler",
+   godunov = "plm-split",
+   riemann = "hll",
+   extrap  = "plm",
+   which   = "all",
+}
+util.parse_args(RunArgs)
+
+
+local function minor_faults()
+   -- Field 10 of /proc/self/stat, counted after the parenthesized command name
+   local f = io.open("/proc/self/stat", "r")
+   if not f then return 0 end
+   local stat = f:read("*a")
+   f:close()
+   local fields = { }
+   for w in stat:gsub("^.*%) ", ""):gmatch("%S+") do
+      table.insert(fields, w)
+   end
+   return tonumber(fields[8]) or 0
+end
+
+
+local function Explosion(x,y,z)
+   local r2 = (x-0.5)^2 + (y-0.5)^2 + (z-0.5)^2
+   if r2 < 0.01 then
+      return { 1.000, 1.0, 0, 0, 0, 1.0, 0, 0 }
+   else
+      return { 0.125, 0.1, 0, 0, 0, 1.0, 0, 0 }
+   end
+end
+
+
+local function ShockTube(x,y,z)
+   if x < 0.5 then
+      return { 1.000, 1.0, 0, 0, 0, 1.0, 0, 0 }
+   else
+      return { 0.125, 0.1, 0, 0, 0, 1.0, 0, 0 }
+   end
+end
+
+
+local ZonesWithGuards -- as counted by advance, set by setup
+
+local function setup(N, Ng, init)
+   local N = N or RunArgs.N
+   local dim = RunArgs.dim
+   local Nq = ({ euler=5, srhd=5, rmhd=8 })[RunArgs.fluid]
+   local x0, x1, Ns = { }, { }, { }
+   for d=1,dim do
+      x0[d], x1[d], Ns[d] = 0.0, 1.0, N
+   end
+   set_fluid(RunArgs.fluid)
+   set_eos("gamma-law", 1.4)
+   set_domain(x0, x1, Ns, Nq, Ng or 3)
+   ZonesWithGuards = (N + 2*(Ng or 3)) ^ dim
+   set_boundary("periodic")
+   set_riemann(RunArgs.riemann)
+   set_godunov(RunArgs.godunov)
+   config_solver({ extrap=RunArgs.extrap }, true)
+   init_prim(init or Explosion)
+end
+
+
+local function time_steps(label)
+   local dt = 0.0
+   advance(dt) -- first step sizes any persistent buffers
+   dt = get_timestep(0.4)
+
+   -- advance returns its wall-clock rate in kilozones per second, counting
+   -- the guard zones; os.clock would count the CPU time of every thread
+   local zones = RunArgs.N ^ RunArgs.dim
+   local faults0 = minor_faults()
+   local sec = 0.0
+   for n=1,RunArgs.steps do
+      local kzps = advance(dt)
+      sec = sec + 1e-3 * ZonesWithGuards / kzps
+   end
+   sec = sec / RunArgs.steps
+   local flt = (minor_faults() - faults0) / RunArgs.steps
+
+   print(string.format("%-24s %8.3f ms/step %10.3e z/s %10.1f faults/step",
+                       label, 1e3*sec, zones/sec, flt))
+end
+
+
+local benchmarks = { }
+
+function benchmarks.advance()
+   print("\nRunge-Kutta integrators:\n")
+   for _,rk in ipairs{ "single", "rk2", "rk3", "rk4" } do
+      setup()
+      set_advance(rk)
+      time_steps(RunArgs.godunov.."/"..rk)
+   end
+end
+
+function benchmarks.layout()
+   print("\nWork array layout in the plm-split sweeps:\n")
+   for _,layout in ipairs{ "aos", "soa" } do
+      setup()
+      set_advance("rk3")
+      config_solver({ layout=layout }, true)
+      time_steps(RunArgs.godunov.."/"..layout)
+   end
+   config_solver({ layout="aos" }, true)
+end
+
+function benchmarks.threads()
+   print("\nThreaded flux sweeps:\n")
+   for _,n in ipairs{ 1, 2, 4, 8 } do
+      setup()
+      set_advance("rk3")
+      config_solver({ threads=n }, true)
+      time_steps(RunArgs.godunov.."/threads="..n)
+   end
+   config_solver({ threads=1 }, true)
+end
+
+function benchmarks.weno()
+   print("\nCharacteristic WENO sweeps:\n")
+   for _,fsplit in ipairs{ "llf", "marq" } do
+      setup()
+      set_godunov("weno-split")
+      set_advance("rk3")
+      config_solver({ fsplit=fsplit, extrap="weno5" }, true)
+      time_steps("weno-split/"..fsplit)
+   end
+   config_solver({ fsplit="llf", extrap=RunArgs.extrap }, true)
+end
+
+function benchmarks.exchange()
+   -- Run under mpirun for the guard zones to be exchanged between processes
+   print("\nGuard zone exchange, per call to ApplyBoundaries:\n")
+   local calls = 10 * RunArgs.steps
+   for _,N in ipairs{ 16, 32, 64 } do
+      for _,Ng in ipairs{ 2, 3 } do
+         for _,method in ipairs{ "datatype", "persistent" } do
+            config_solver({ exchange=method }, true)
+            setup(N, Ng)
+            boundary.ApplyBoundaries() -- first call creates any channels
+            -- wall clock, so that time spent waiting on messages is counted
+            local start = profile.clock()
+            for n=1,calls do
+               boundary.ApplyBoundaries()
+            end
+            local sec = (profile.clock() - start) / calls
+            print(string.format("N=%-4d Ng=%d %-12s %10.3f us/call",
+                                N, Ng, method, 1e6*sec))
+         end
+      end
+   end
+   config_solver({ exchange="datatype" }, true)
+end
+
+function benchmarks.exact()
+   -- Newton-Raphson iterations per face of the exact Riemann solver, starting
+   -- from the usual estimate of p* or from the last p* found on each face
+   if RunArgs.fluid ~= "euler" then
+      print("\nExact Riemann solver: needs fluid=euler, skipped\n")
+      return
+   end
+   print("\nExact Riemann solver with cached star pressures:\n")
+   local riemann_method = RunArgs.riemann
+   RunArgs.riemann = "exact"
+   for name,init in pairs{ sod=ShockTube, blast=Explosion } do
+      for _,cache in ipairs{ false, true } do
+         setup(nil, nil, init)
+         set_advance("rk3")
+         config_solver({ exact_cache=cache }, true)
+         time_steps(name.."/cache="..tostring(cache))
+         local stats = riemann.stats(true)
+         print(string.format("%-24s %8.3f its/face %8.1f%% cached", "",
+                             stats.exact_iterations / stats.exact,
+                             100 * stats.exact_cached / stats.exact))
+      end
+   end
+   config_solver({ exact_cache=false }, true)
+   RunArgs.riemann = riemann_method
+end
+
+function benchmarks.lazy()
+   -- Fraction of the zones whose inversion was skipped because their conserved
+   -- state had not changed since the last one, in the blast wave
+   print("\nLazy primitive recovery:\n")
+   for _,tol in ipairs{ false, 0.0, 1e-12 } do
+      setup()
+      set_advance("rk3")
+      config_solver({ lazy_c2p=(tol and true or false),
+                      lazy_tolerance=(tol or 0.0) }, true)
+      profile.reset()
+      time_steps("lazy/tol="..tostring(tol))
+      local counts = profile.report(true).counters
+      local skipped = counts.zones_skipped.mean
+      local inverted = counts.zones_inverted.mean
+      print(string.format("%-24s %8.1f%% skipped", "",
+                          100 * skipped / (skipped + inverted)))
+   end
+   config_solver({ lazy_c2p=false, lazy_tolerance=0.0 }, true)
+end
+
+
+for k,v in pairs(benchmarks) do
+   if RunArgs.which == "all" or RunArgs.which == k then
+      v()
+   end
+end